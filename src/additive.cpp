@@ -0,0 +1,208 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "additive.h"
+#include <cmath>
+
+// harmonics worked on side by side, a multiple of the vector width
+static const unsigned int lanes = 8;
+
+double linear_cycle_series(breakpoint_list_t::const_iterator begin,
+		breakpoint_list_t::const_iterator end, float *real, float *imag,
+		unsigned int n, double &length) {
+	length = 0;
+	if(begin == end)
+		return 0;
+	// the area under the segments gives the mean
+	double area = 0;
+	breakpoint_list_t::const_iterator i;
+	for(i = begin; i != end; ++i) {
+		breakpoint_list_t::const_iterator next = i;
+		++next;
+		length += i->get_duration();
+		area += i->get_duration() *
+			(i->get_amplitude() + next->get_amplitude()) / 2;
+	}
+	if(n > max_series_harmonics)
+		n = max_series_harmonics;
+	for(unsigned int k = 0; k < n; ++k)
+		real[k] = imag[k] = 0;
+	if(length <= 0)
+		return 0;
+	double mean = area / length -
+		(begin->get_amplitude() + end->get_amplitude()) / 2;
+	if(n == 0)
+		return mean;
+
+	// sum of the slope changes, each turned by its position in the cycle,
+	// for every harmonic
+	unsigned int padded = (n + lanes - 1) / lanes * lanes;
+	float sum_real[max_series_harmonics];
+	float sum_imag[max_series_harmonics];
+	for(unsigned int k = 0; k < padded; ++k)
+		sum_real[k] = sum_imag[k] = 0;
+
+	double first_slope = 0;
+	double slope = 0;
+	double position = 0;
+	for(i = begin; i != end; ++i) {
+		breakpoint_list_t::const_iterator next = i;
+		++next;
+		double duration = i->get_duration();
+		double new_slope = duration > 0 ?
+			(next->get_amplitude() - i->get_amplitude()) / duration : slope;
+		if(i == begin) {
+			// the change at the start has to wait for the last slope
+			first_slope = new_slope;
+		}
+		else if(new_slope != slope) {
+			float change = new_slope - slope;
+			// e^(-j w t) for the first harmonics, and the turn that takes
+			// each lane to its next harmonic
+			double theta = 2 * M_PI * position / length;
+			double step_real = cos(theta);
+			double step_imag = -sin(theta);
+			double turn_real = 1;
+			double turn_imag = 0;
+			float lane_real[lanes];
+			float lane_imag[lanes];
+			for(unsigned int l = 0; l < lanes; ++l) {
+				double r = turn_real * step_real - turn_imag * step_imag;
+				turn_imag = turn_real * step_imag + turn_imag * step_real;
+				turn_real = r;
+				lane_real[l] = turn_real;
+				lane_imag[l] = turn_imag;
+			}
+			float jump_real = turn_real;
+			float jump_imag = turn_imag;
+			for(unsigned int k = 0; k < padded; k += lanes) {
+				for(unsigned int l = 0; l < lanes; ++l) {
+					sum_real[k + l] += change * lane_real[l];
+					sum_imag[k + l] += change * lane_imag[l];
+					float r = lane_real[l] * jump_real -
+						lane_imag[l] * jump_imag;
+					lane_imag[l] = lane_real[l] * jump_imag +
+						lane_imag[l] * jump_real;
+					lane_real[l] = r;
+				}
+			}
+		}
+		slope = new_slope;
+		position += duration;
+	}
+	// at the start e^(-j w t) is 1 for every harmonic
+	float change = first_slope - slope;
+	for(unsigned int k = 0; k < padded; ++k)
+		sum_real[k] += change;
+
+	for(unsigned int k = 0; k < n; ++k) {
+		double w = 2 * M_PI * (k + 1) / length;
+		double scale = -1 / (length * w * w);
+		real[k] = scale * sum_real[k];
+		imag[k] = scale * sum_imag[k];
+	}
+	return mean;
+}
+
+partial_bank::partial_bank() {
+	num_partials = 0;
+	num_lanes = 0;
+	start_amplitude = 0;
+	rise = 0;
+	mean = 0;
+	length = 0;
+	line = 0;
+	line_step = 0;
+	step = 1;
+}
+
+void partial_bank::set_cycle(breakpoint_list_t::const_iterator begin,
+		breakpoint_list_t::const_iterator end, gendydur_t step) {
+	this->step = step;
+	// harmonic k is k / length cycles a sample, which has to stay below
+	// half of 1 / step
+	double cycle_length = 0;
+	for(breakpoint_list_t::const_iterator i = begin; i != end; ++i)
+		cycle_length += i->get_duration();
+	double nyquist = cycle_length / (2 * step);
+	num_partials = nyquist > 1 ? (unsigned int)ceil(nyquist) - 1 : 0;
+	if(num_partials > max_partials)
+		num_partials = max_partials;
+	mean = linear_cycle_series(begin, end, coef_real, coef_imag, num_partials,
+			length);
+	num_lanes = (num_partials + lanes - 1) / lanes * lanes;
+	start_amplitude = begin == end ? 0 : begin->get_amplitude();
+	rise = begin == end ? 0 : end->get_amplitude() - start_amplitude;
+}
+
+void partial_bank::start(double position) {
+	if(length <= 0) {
+		line = start_amplitude;
+		line_step = 0;
+		return;
+	}
+	line = start_amplitude + rise * position / length + mean;
+	line_step = rise * step / length;
+	// e^(j w position) and e^(j w step) for each harmonic in turn
+	double theta = 2 * M_PI * position / length;
+	double delta = 2 * M_PI * step / length;
+	double base_real = cos(theta);
+	double base_imag = sin(theta);
+	double base_turn_real = cos(delta);
+	double base_turn_imag = sin(delta);
+	double phase_real = 1;
+	double phase_imag = 0;
+	double turn_r = 1;
+	double turn_i = 0;
+	for(unsigned int k = 0; k < num_partials; ++k) {
+		double r = phase_real * base_real - phase_imag * base_imag;
+		phase_imag = phase_real * base_imag + phase_imag * base_real;
+		phase_real = r;
+		r = turn_r * base_turn_real - turn_i * base_turn_imag;
+		turn_i = turn_r * base_turn_imag + turn_i * base_turn_real;
+		turn_r = r;
+		real[k] = 2 * (coef_real[k] * phase_real - coef_imag[k] * phase_imag);
+		imag[k] = 2 * (coef_real[k] * phase_imag + coef_imag[k] * phase_real);
+		turn_real[k] = turn_r;
+		turn_imag[k] = turn_i;
+	}
+	for(unsigned int k = num_partials; k < num_lanes; ++k) {
+		real[k] = imag[k] = 0;
+		turn_real[k] = 1;
+		turn_imag[k] = 0;
+	}
+}
+
+gendydur_t partial_bank::get_step() const {
+	return step;
+}
+
+unsigned int partial_bank::get_partials() const {
+	return num_partials;
+}
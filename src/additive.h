@@ -0,0 +1,144 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef ADDITIVE_H
+#define ADDITIVE_H
+
+#include "types.h"
+#include "pool.h"
+
+// Fourier series of a cycle with linear interpolation.
+//
+// A piecewise linear cycle's second derivative is a row of impulses at the
+// breakpoints, one per change of slope, so its Fourier series has a closed
+// form. The cycle usually doesn't end where it started, it ends where the
+// next one starts, and repeated it would have a jump at the ends whose
+// harmonics only fall off as 1/k. That part is the straight line from the
+// first breakpoint to the end point, which is taken out and kept apart.
+// What's left starts and ends at 0, and harmonic k of it is
+//
+//   c_k = -1 / (T w^2) * sum_i dm_i e^(-j w t_i),   w = 2 pi k / T
+//
+// with T the cycle length and t_i and dm_i the position and slope change of
+// breakpoint i. That's breakpoints times harmonics complex multiply-adds,
+// done harmonics innermost in independent lanes so the compiler can
+// vectorize them.
+
+// most harmonics worked out for a cycle
+const unsigned int max_series_harmonics = 256;
+
+// the series of the cycle from begin to end, end being the first breakpoint
+// of the next cycle, which the last segment runs to. real and imag get c_1
+// to c_n of the cycle less the line from its first breakpoint to end, and
+// the return value is its mean. length is set to the cycle's length in
+// samples
+double linear_cycle_series(breakpoint_list_t::const_iterator begin,
+		breakpoint_list_t::const_iterator end, float *real, float *imag,
+		unsigned int n, double &length);
+
+// Plays a cycle back from its series as a bank of oscillators, one per
+// harmonic below half the rate it runs at, plus the line. Each partial is
+// a complex phasor turned by a fixed amount every sample, so a sample
+// costs a complex multiply per partial and no sines. Like the series, the
+// partials are laid out in lanes so the loop vectorizes.
+//
+// Successive cycles meet where one's line ends and the next one's starts,
+// so the cycle boundaries are the only corners left in the output, and the
+// breakpoints inside a cycle don't alias however short its segments are.
+class partial_bank
+{
+	public:
+	static const unsigned int max_partials = max_series_harmonics;
+
+	private:
+	static const unsigned int lanes = 8;
+	// the cycle's series
+	float coef_real[max_partials];
+	float coef_imag[max_partials];
+	unsigned int num_partials;
+	// num_partials rounded up to lanes, the ones above it silent
+	unsigned int num_lanes;
+	// each partial's phasor, at twice its amplitude, and its turn per sample
+	float real[max_partials];
+	float imag[max_partials];
+	float turn_real[max_partials];
+	float turn_imag[max_partials];
+	// the line from the cycle's first breakpoint to the next cycle's
+	double start_amplitude;
+	double rise;
+	double mean;
+	double length;
+	// the line plus the mean at the current sample, and its change per
+	// sample
+	double line;
+	double line_step;
+	gendydur_t step;
+
+	public:
+	partial_bank();
+	// works out the series of the cycle from begin to end (see
+	// linear_cycle_series()), for a bank that moves step samples on
+	// through it every time
+	void set_cycle(breakpoint_list_t::const_iterator begin,
+			breakpoint_list_t::const_iterator end, gendydur_t step);
+	// puts the bank position samples into the cycle
+	void start(double position);
+	// the next sample of the cycle
+	gendysamp_t next();
+	gendydur_t get_step() const;
+	unsigned int get_partials() const;
+};
+
+// called for every sample, so it's defined here where the render loop can
+// inline it
+inline gendysamp_t partial_bank::next() {
+	float sums[lanes] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	// a fixed count of lanes at fixed offsets, which compilers vectorize
+	// without being asked to at -O2
+	for(unsigned int k = 0; k < num_lanes; k += lanes) {
+		float *lane_real = real + k;
+		float *lane_imag = imag + k;
+		const float *lane_turn_real = turn_real + k;
+		const float *lane_turn_imag = turn_imag + k;
+		for(unsigned int l = 0; l < lanes; ++l) {
+			float r = lane_real[l];
+			float i = lane_imag[l];
+			sums[l] += r;
+			lane_real[l] = r * lane_turn_real[l] - i * lane_turn_imag[l];
+			lane_imag[l] = r * lane_turn_imag[l] + i * lane_turn_real[l];
+		}
+	}
+	float sum = line;
+	line += line_step;
+	for(unsigned int l = 0; l < lanes; ++l)
+		sum += sums[l];
+	return sum;
+}
+
+#endif /* ADDITIVE_H */
@@ -0,0 +1,392 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#include "bptrace.h"
+#include "log.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+static const char trace_magic[4] = { 'G', 'D', 'Y', 'T' };
+static const uint16_t trace_version = 1;
+// resolution of the quantized durations (in samples) and amplitudes
+static const uint32_t duration_steps = 256;
+static const uint32_t amplitude_steps = 65536;
+// how long the helper threads sleep when there's nothing to do, in ms
+static const int helper_poll_interval = 5;
+
+// native byte order, like the snapshots. fields are only ever appended
+struct trace_file_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t header_size;
+	float samplerate;
+	uint32_t duration_steps;
+	uint32_t amplitude_steps;
+};
+
+static void put_varint(vector<unsigned char> &buffer, uint32_t value) {
+	while(value >= 0x80) {
+		buffer.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((unsigned char)value);
+}
+
+static bool get_varint(FILE *file, uint32_t &value) {
+	value = 0;
+	for(int shift = 0; shift < 35; shift += 7) {
+		int c = getc(file);
+		if(c == EOF)
+			return false;
+		value |= (uint32_t)(c & 0x7f) << shift;
+		if(!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// maps small differences of either sign to small unsigned numbers
+static uint32_t zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static void helper_sleep() {
+	this_thread::sleep_for(chrono::milliseconds(helper_poll_interval));
+}
+
+trace_recorder::trace_recorder(size_t capacity) : ring(capacity),
+		running(false), recording(false), write_failed(false),
+		dropped_cycles(0) {
+	file = NULL;
+}
+
+trace_recorder::~trace_recorder() {
+	stop();
+}
+
+bool trace_recorder::start(const char *path, float samplerate) {
+	stop();
+	if(samplerate <= 0) {
+		print_log("gendy~: can't record a trace without a samplerate", LOG_ERROR);
+		return false;
+	}
+	file = fopen(path, "wb");
+	if(!file) {
+		print_log("gendy~: can't create trace file", LOG_ERROR);
+		return false;
+	}
+	trace_file_header header;
+	memcpy(header.magic, trace_magic, sizeof(header.magic));
+	header.version = trace_version;
+	header.header_size = sizeof(header);
+	header.samplerate = samplerate;
+	header.duration_steps = duration_steps;
+	header.amplitude_steps = amplitude_steps;
+	if(fwrite(&header, sizeof(header), 1, file) != 1) {
+		print_log("gendy~: can't write trace file", LOG_ERROR);
+		fclose(file);
+		file = NULL;
+		return false;
+	}
+	write_failed = false;
+	dropped_cycles = 0;
+	running = true;
+	writer = thread(&trace_recorder::write_trace, this);
+	recording = true;
+	return true;
+}
+
+bool trace_recorder::stop() {
+	if(!running)
+		return true;
+	recording = false;
+	running = false;
+	writer.join();
+	bool ok = !write_failed && fclose(file) == 0;
+	file = NULL;
+	if(!ok)
+		print_log("gendy~: can't write trace file", LOG_ERROR);
+	return ok;
+}
+
+bool trace_recorder::is_recording() const {
+	return recording;
+}
+
+unsigned long long trace_recorder::get_dropped_cycles() const {
+	return dropped_cycles;
+}
+
+// rendering thread. the whole cycle goes into the ring or none of it does,
+// so the writer never waits for the rest of a cycle
+void trace_recorder::cycle_moved(gendy_waveform &waveform) {
+	if(!recording.load(memory_order_relaxed))
+		return;
+	breakpoint_list_t::const_iterator i;
+	unsigned int length = 0;
+	for(i = waveform.cycle_begin(); i != waveform.cycle_end(); ++i)
+		++length;
+	if(ring.space() < length + 1) {
+		++dropped_cycles;
+		return;
+	}
+	trace_entry entry;
+	entry.length = length;
+	entry.duration = 0;
+	entry.amplitude = 0;
+	ring.push(entry);
+	entry.length = 0;
+	for(i = waveform.cycle_begin(); i != waveform.cycle_end(); ++i) {
+		entry.duration = i->get_duration();
+		entry.amplitude = i->get_amplitude();
+		ring.push(entry);
+	}
+}
+
+// writer thread. keeps going until stop() and the ring is empty
+void trace_recorder::write_trace() {
+	vector<unsigned char> buffer;
+	vector<int32_t> previous_durations;
+	vector<int32_t> previous_amplitudes;
+	unsigned int index = 0;
+	unsigned int remaining = 0;
+	for(;;) {
+		// checked first, so whatever was pushed before stop() gets written
+		bool more = running.load(memory_order_acquire);
+		trace_entry entry;
+		bool idle = true;
+		while(ring.pop(entry)) {
+			idle = false;
+			if(remaining == 0) {
+				remaining = entry.length;
+				index = 0;
+				put_varint(buffer, entry.length);
+				if(previous_durations.size() < entry.length) {
+					previous_durations.resize(entry.length, 0);
+					previous_amplitudes.resize(entry.length, 0);
+				}
+				continue;
+			}
+			int32_t duration = (int32_t)lrint(entry.duration * duration_steps);
+			int32_t amplitude = (int32_t)lrint(entry.amplitude * amplitude_steps);
+			put_varint(buffer, zigzag(duration - previous_durations[index]));
+			put_varint(buffer, zigzag(amplitude - previous_amplitudes[index]));
+			previous_durations[index] = duration;
+			previous_amplitudes[index] = amplitude;
+			++index;
+			--remaining;
+		}
+		if(!buffer.empty()) {
+			if(fwrite(&buffer[0], buffer.size(), 1, file) != 1)
+				write_failed = true;
+			buffer.clear();
+		}
+		if(!more)
+			break;
+		if(idle)
+			helper_sleep();
+	}
+}
+
+trace_player::trace_player(size_t capacity, unsigned int max_length) :
+		ring(capacity), running(false), reader_done(false), underruns(0),
+		max_length(max_length) {
+	file = NULL;
+	duration_scale = 1;
+	// the current cycle plus a few breakpoints of the next ones
+	window.resize(2 * max_length + max_pending);
+	window_size = 0;
+	num_pending = 0;
+	current_length = 0;
+	// a whole cycle has to fit in the ring
+	if(this->max_length + 1 > ring.get_capacity())
+		this->max_length = ring.get_capacity() - 1;
+}
+
+trace_player::~trace_player() {
+	stop();
+}
+
+bool trace_player::start(const char *path, float samplerate) {
+	stop();
+	file = fopen(path, "rb");
+	if(!file) {
+		print_log("gendy~: can't open trace file", LOG_ERROR);
+		return false;
+	}
+	trace_file_header header;
+	memset(&header, 0, sizeof(header));
+	bool ok = fread(&header, 8, 1, file) == 1 &&
+		!memcmp(header.magic, trace_magic, sizeof(header.magic)) &&
+		header.version <= trace_version &&
+		header.header_size >= sizeof(header) &&
+		fread((char *)&header + 8, sizeof(header) - 8, 1, file) == 1 &&
+		fseek(file, header.header_size, SEEK_SET) == 0 &&
+		header.samplerate > 0 && header.duration_steps > 0 &&
+		header.amplitude_steps > 0;
+	if(!ok) {
+		print_log("gendy~: not a valid trace file", LOG_ERROR);
+		fclose(file);
+		file = NULL;
+		return false;
+	}
+	duration_scale = (samplerate > 0 ? samplerate / header.samplerate : 1) /
+		header.duration_steps;
+	amplitude_scale = 1.0 / header.amplitude_steps;
+
+	// whatever a previous trace left behind
+	trace_entry entry;
+	while(ring.pop(entry))
+		;
+	window_size = 0;
+	num_pending = 0;
+	current_length = 0;
+	underruns = 0;
+	reader_done = false;
+	running = true;
+	reader = thread(&trace_player::read_trace, this);
+	return true;
+}
+
+void trace_player::stop() {
+	if(!running)
+		return;
+	running = false;
+	reader.join();
+	fclose(file);
+	file = NULL;
+}
+
+unsigned long long trace_player::get_underruns() const {
+	return underruns;
+}
+
+// reader thread. decodes a whole cycle at a time, then waits for room in
+// the ring for it
+void trace_player::read_trace() {
+	vector<int32_t> durations(max_length, 0);
+	vector<int32_t> amplitudes(max_length, 0);
+	uint32_t length;
+	while(running.load(memory_order_relaxed) && get_varint(file, length)) {
+		if(length == 0 || length > max_length) {
+			print_log("gendy~: trace has a cycle that's too long", LOG_ERROR);
+			break;
+		}
+		unsigned int i;
+		for(i = 0; i < length; ++i) {
+			uint32_t duration, amplitude;
+			if(!get_varint(file, duration) || !get_varint(file, amplitude))
+				break;
+			durations[i] += unzigzag(duration);
+			amplitudes[i] += unzigzag(amplitude);
+		}
+		if(i < length)
+			break;
+		while(ring.space() < length + 1) {
+			if(!running.load(memory_order_relaxed))
+				break;
+			helper_sleep();
+		}
+		if(!running.load(memory_order_relaxed))
+			break;
+		trace_entry entry;
+		entry.length = length;
+		entry.duration = 0;
+		entry.amplitude = 0;
+		ring.push(entry);
+		entry.length = 0;
+		for(i = 0; i < length; ++i) {
+			entry.duration = durations[i] * duration_scale;
+			entry.amplitude = amplitudes[i] * amplitude_scale;
+			ring.push(entry);
+		}
+	}
+	reader_done.store(true, memory_order_release);
+}
+
+// rendering thread. takes entries from the ring until there are wanted
+// breakpoints past the start of the first pending cycle, or the ring is
+// empty. returns whether there are enough
+bool trace_player::fill_window(unsigned int wanted) {
+	trace_entry entry;
+	while(!num_pending || window_size < pending_lengths[0] + wanted) {
+		if(num_pending == max_pending || !ring.pop(entry))
+			return false;
+		if(entry.length)
+			pending_lengths[num_pending++] = entry.length;
+		else if(window_size < window.size())
+			window[window_size++] = entry;
+	}
+	return true;
+}
+
+bool trace_player::next_cycle(unsigned int lookahead, unsigned int &length) {
+	// done with the cycle at the front of the window
+	if(current_length) {
+		window_size -= current_length;
+		memmove(&window[0], &window[current_length],
+				window_size * sizeof(trace_entry));
+		--num_pending;
+		memmove(pending_lengths, pending_lengths + 1,
+				num_pending * sizeof(unsigned int));
+		current_length = 0;
+	}
+	if(!fill_window(lookahead)) {
+		// the reader has finished, so the last cycles can't have all of
+		// their lookahead. get_point() makes it up from the cycle itself
+		bool at_end = reader_done.load(memory_order_acquire) &&
+			!ring.available();
+		if(!num_pending || window_size < pending_lengths[0] || !at_end) {
+			if(!at_end)
+				++underruns;
+			return false;
+		}
+	}
+	length = current_length = pending_lengths[0];
+	return true;
+}
+
+void trace_player::get_point(unsigned int index, gendydur_t &duration,
+		gendyamp_t &amplitude) const {
+	if(index >= window_size)
+		index %= current_length;
+	duration = window[index].duration;
+	amplitude = window[index].amplitude;
+}
+
+bool trace_player::finished() const {
+	return reader_done.load(memory_order_acquire) && !ring.available() &&
+		!num_pending;
+}
@@ -0,0 +1,147 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#ifndef BPTRACE_H
+#define BPTRACE_H
+
+#include "gendy_waveform.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+
+// Breakpoint traces: a record of the breakpoints of every cycle a waveform
+// played, rather than of the audio. A trace is a few bytes per breakpoint
+// against one sample per sample of audio, and since it only holds the
+// shape of the walk it can be played back at any sample rate and with any
+// interpolation.
+//
+// The rendering thread only ever touches a lock-free ring. A helper thread
+// per recorder or player does the encoding and the file I/O.
+//
+// File layout: a trace_file_header, then per cycle the number of
+// breakpoints and, for each breakpoint, its duration and amplitude. All of
+// these are varints. durations and amplitudes are quantized and stored as
+// zigzag coded differences to the breakpoint at the same index in the
+// previous cycle, which are small because the walk only takes small steps.
+
+// one slot of the ring between the rendering thread and the helper thread.
+// a cycle is an entry with its length, followed by an entry per breakpoint
+// with length 0
+struct trace_entry {
+	unsigned int length;
+	gendydur_t duration;
+	gendyamp_t amplitude;
+};
+
+// records the waveforms it's listening to. add it with add_cycle_listener()
+// after start(), and remove it again before stop()
+class trace_recorder : public cycle_listener
+{
+	spsc_ring<trace_entry> ring;
+	FILE *file;
+	std::thread writer;
+	std::atomic<bool> running;
+	std::atomic<bool> recording;
+	std::atomic<bool> write_failed;
+	std::atomic<unsigned long long> dropped_cycles;
+
+	void write_trace();
+
+	// not copyable
+	trace_recorder(const trace_recorder &);
+	trace_recorder &operator=(const trace_recorder &);
+
+	public:
+	// capacity is in breakpoints. a cycle that doesn't fit in the ring any
+	// more, because the writer has fallen behind, is dropped
+	trace_recorder(size_t capacity = 1 << 16);
+	~trace_recorder();
+	// samplerate is the one the durations are counted in
+	bool start(const char *path, float samplerate);
+	// writes out what's left in the ring and closes the file. returns false
+	// if anything couldn't be written
+	bool stop();
+	bool is_recording() const;
+	unsigned long long get_dropped_cycles() const;
+
+	void cycle_moved(gendy_waveform &waveform);
+};
+
+// plays a trace back. set it with set_breakpoint_source() after start(),
+// and take it away again before stop(). the waveform goes back to the
+// random walk by itself when the trace runs out
+class trace_player : public breakpoint_source
+{
+	spsc_ring<trace_entry> ring;
+	FILE *file;
+	std::thread reader;
+	std::atomic<bool> running;
+	std::atomic<bool> reader_done;
+	std::atomic<unsigned long long> underruns;
+	unsigned int max_length;
+	// from the trace's quantized values to ours
+	double duration_scale;
+	double amplitude_scale;
+
+	// rendering thread side. the breakpoints of the current cycle and the
+	// ones after it that have been taken from the ring so far
+	std::vector<trace_entry> window;
+	unsigned int window_size;
+	// lengths of the cycles in the window, oldest first
+	static const unsigned int max_pending = 8;
+	unsigned int pending_lengths[max_pending];
+	unsigned int num_pending;
+	// the cycle last handed to the waveform, still at the front of the window
+	unsigned int current_length;
+
+	void read_trace();
+	bool fill_window(unsigned int wanted);
+
+	// not copyable
+	trace_player(const trace_player &);
+	trace_player &operator=(const trace_player &);
+
+	public:
+	// capacity is in breakpoints. max_length is the longest cycle accepted
+	trace_player(size_t capacity = 1 << 16, unsigned int max_length = 4096);
+	~trace_player();
+	// samplerate is the one to play at, the durations are rescaled to it
+	bool start(const char *path, float samplerate);
+	void stop();
+	// cycles the waveform had to play again because the reader fell behind
+	unsigned long long get_underruns() const;
+
+	bool next_cycle(unsigned int lookahead, unsigned int &length);
+	void get_point(unsigned int index, gendydur_t &duration,
+			gendyamp_t &amplitude) const;
+	bool finished() const;
+};
+
+#endif /* BPTRACE_H */
@@ -40,6 +40,9 @@ breakpoint::breakpoint() {
 	center_amp = 0;
 }
 
+// longest a segment can get, relative to its center duration
+static const gendydur_t max_duration_ratio = 16;
+
 breakpoint::breakpoint(gendydur_t duration, gendyamp_t amplitude) {
 	print_log("gendy~: New breakpoint with duration %u", duration, LOG_DEBUG);
 	print_log("gendy~: \t\t\tamplitude %f", amplitude, LOG_DEBUG);
@@ -62,37 +65,63 @@ breakpoint::breakpoint(gendydur_t duration, gendyamp_t amplitude,
 // elastic_move
 //
 // elastic_move sets a new position for the breakpoint. The breakpoint is
-// moved (vertically and horizontally) from its current position by a normal
-// distributed distance, the standard deviations of which are h_step and
-// v_step.
+// moved (vertically and horizontally) from its current position by a random
+// distance, h_random and v_random, scaled by h_step and v_step. The random
+// values are drawn by the caller, from whichever distribution it uses.
 //
 // the breakpoint is also pulled toward its center by the factors h_pull and
 // v_pull, with a 1 corresponding to immediately jumping to the center point
 // and 0 not pulling toward the center point at all.
 //
 // amplitudes out of the audio range [-1,1] are mirrored back in.
-// durations less than 2 samples are set to 2.
+// durations less than 2 samples are set to 2, and ones longer than
+// max_duration_ratio times the center are mirrored back below that.
 //
 void breakpoint::elastic_move(gendydur_t h_step, gendyamp_t v_step,
-		gendydur_t h_pull, gendyamp_t v_pull) {
+		gendydur_t h_pull, gendyamp_t v_pull,
+		double h_random, double v_random) {
 	gendydur_t old_duration = duration;
 	gendydur_t new_duration;
 	gendyamp_t new_amplitude;
 
 	new_duration = old_duration *
 			pow(center_dur / old_duration,h_pull * h_step) *
-			exp(gauss() *0.1 * h_step * (1.0-h_pull));
+			exp(h_random *0.1 * h_step * (1.0-h_pull));
 	/*new_duration = old_duration + round((1.0 - h_pull) * h_step * gauss() +
 		(h_pull * (center_dur - old_duration))); */
-	// set boundaries on new_duration
+	// set boundaries on new_duration. heavy tailed distributions can throw
+	// it far out, so it's mirrored at the upper one on the same log scale
+	// the steps are taken on, folded to within one period first
+	gendydur_t max_duration = max_duration_ratio * center_dur;
+	if(max_duration < 4)
+		max_duration = 4;
+	if(new_duration > max_duration) {
+		if(!std::isfinite(new_duration))
+			new_duration = max_duration;
+		else {
+			double range = log(max_duration / 2);
+			double excess = fmod(log(new_duration / max_duration), 2 * range);
+			if(excess > range)
+				excess = 2 * range - excess;
+			new_duration = max_duration * exp(-excess);
+		}
+	}
 	if(new_duration < 2)
 		new_duration = 2;
 	
 	new_amplitude = amplitude + v_step *
 			(v_pull * (center_amp - amplitude) +
-			(1.0 - v_pull) * gauss());
+			(1.0 - v_pull) * v_random);
 	/*new_amplitude = amplitude + (1 - v_pull) * v_step * gauss() +
 		v_pull * (center_amp - amplitude);*/
+	// heavy tailed distributions can throw the amplitude far out, fold it
+	// back to within one period of the mirroring first
+	if(new_amplitude > 3 || new_amplitude < -3) {
+		new_amplitude = fmod(new_amplitude + 1, 4);
+		if(new_amplitude < 0)
+			new_amplitude += 4;
+		new_amplitude -= 1;
+	}
 	// set mirror boundaries on new_amplitude
 	do {
 		if(new_amplitude > 1)
@@ -104,51 +133,3 @@ void breakpoint::elastic_move(gendydur_t h_step, gendyamp_t v_step,
 	duration = new_duration;
 	amplitude = new_amplitude;
 }
-
-void breakpoint::set_duration(gendydur_t new_duration) {
-	duration = new_duration;
-}
-
-void breakpoint::set_amplitude(gendyamp_t new_amplitude) {
-	amplitude = new_amplitude;
-}
-
-void breakpoint::set_position(gendydur_t new_duration, gendyamp_t new_amplitude) {
-	//TODO: argument sanitization
-	duration = new_duration;
-	amplitude = new_amplitude;
-}
-
-void breakpoint::set_center_duration(gendydur_t new_duration) {
-	center_dur = new_duration;
-}
-
-void breakpoint::set_center_amplitude(gendyamp_t new_amplitude) {
-	center_amp = new_amplitude;
-}
-
-// set_center
-// accessor function to set the amplitude and duration of a breakpoint's
-// center position
-
-void breakpoint::set_center(gendydur_t new_duration, gendyamp_t new_amplitude) {
-	//TODO: argument sanitization
-	center_dur= new_duration;
-	center_amp = new_amplitude;
-}
-
-gendydur_t breakpoint::get_duration() const {
-	return duration;
-}
-
-gendyamp_t breakpoint::get_amplitude() const {
-	return amplitude;
-}
-
-gendydur_t breakpoint::get_center_duration() const {
-	return center_dur;
-}
-
-gendyamp_t breakpoint::get_center_amplitude() const {
-	return center_amp;
-}
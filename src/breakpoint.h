@@ -49,7 +49,8 @@ class breakpoint
 	breakpoint(gendydur_t duration, gendyamp_t amplitude,
 			gendydur_t center_dur, gendyamp_t center_amp);
 	void elastic_move(gendydur_t h_step, gendyamp_t v_step,
-			gendydur_t h_pull, gendyamp_t v_pull);
+			gendydur_t h_pull, gendyamp_t v_pull,
+			double h_random, double v_random);
 	void set_duration(gendydur_t new_duration);
 	void set_amplitude(gendyamp_t new_amplitude);
 	void set_position(gendydur_t new_duration, gendyamp_t new_amplitude);
@@ -61,4 +62,58 @@ class breakpoint
 	gendydur_t get_center_duration() const;
 	gendyamp_t get_center_amplitude() const;
 };
+
+// the accessors are used for every segment of every cycle, so they're
+// defined here where the render loops can inline them
+
+inline void breakpoint::set_duration(gendydur_t new_duration) {
+	duration = new_duration;
+}
+
+inline void breakpoint::set_amplitude(gendyamp_t new_amplitude) {
+	amplitude = new_amplitude;
+}
+
+inline void breakpoint::set_position(gendydur_t new_duration,
+		gendyamp_t new_amplitude) {
+	//TODO: argument sanitization
+	duration = new_duration;
+	amplitude = new_amplitude;
+}
+
+inline void breakpoint::set_center_duration(gendydur_t new_duration) {
+	center_dur = new_duration;
+}
+
+inline void breakpoint::set_center_amplitude(gendyamp_t new_amplitude) {
+	center_amp = new_amplitude;
+}
+
+// set_center
+// accessor function to set the amplitude and duration of a breakpoint's
+// center position
+
+inline void breakpoint::set_center(gendydur_t new_duration,
+		gendyamp_t new_amplitude) {
+	//TODO: argument sanitization
+	center_dur= new_duration;
+	center_amp = new_amplitude;
+}
+
+inline gendydur_t breakpoint::get_duration() const {
+	return duration;
+}
+
+inline gendyamp_t breakpoint::get_amplitude() const {
+	return amplitude;
+}
+
+inline gendydur_t breakpoint::get_center_duration() const {
+	return center_dur;
+}
+
+inline gendyamp_t breakpoint::get_center_amplitude() const {
+	return center_amp;
+}
+
 #endif /* BREAKPOINT_H */
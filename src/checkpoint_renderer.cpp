@@ -0,0 +1,205 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "checkpoint_renderer.h"
+#include "log.h"
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+// checkpoint file layout: a checkpoint_file_header, then for each
+// checkpoint a 64 bit position, a 32 bit length and that many bytes of
+// snapshot. native byte order, like the snapshots themselves
+static const char checkpoint_magic[4] = { 'G', 'D', 'Y', 'C' };
+static const uint32_t checkpoint_version = 1;
+
+struct checkpoint_file_header {
+	char magic[4];
+	uint32_t version;
+	uint64_t interval;
+	uint64_t num_checkpoints;
+};
+
+checkpoint_renderer::checkpoint_renderer(gendy_waveform &waveform,
+		unsigned long long interval) : waveform(waveform) {
+	this->interval = interval ? interval : 1;
+	position = 0;
+}
+
+void checkpoint_renderer::take_checkpoint() {
+	checkpoint point;
+	point.position = position;
+	point.state.resize(waveform.state_size());
+	waveform.save_state(&point.state[0], point.state.size());
+	checkpoints.push_back(point);
+}
+
+// takes the checkpoint that's due at position, if there is one
+void checkpoint_renderer::update_checkpoints() {
+	// parameters set up before rendering take effect from the very start,
+	// the first cycle hasn't begun yet
+	if(position == 0)
+		waveform.commit_changes();
+	// a checkpoint is due every interval samples. one held back by pending
+	// changes is taken as soon as they're through. we only extend the
+	// checkpoints past the furthest one, a render after seeking back would
+	// otherwise add them again
+	if(!waveform.has_pending_changes() &&
+			(checkpoints.empty() ||
+			 checkpoints.back().position / interval < position / interval))
+		take_checkpoint();
+}
+
+unsigned int checkpoint_renderer::render(gendysamp_t *dest, unsigned int n) {
+	unsigned int done = 0;
+	while(done < n) {
+		update_checkpoints();
+		unsigned long long to_next = interval - position % interval;
+		unsigned int chunk = n - done;
+		if(to_next < chunk)
+			chunk = to_next;
+		waveform.get_block(dest + done, chunk);
+		done += chunk;
+		position += chunk;
+	}
+	return n;
+}
+
+// moves forward without rendering, see gendy_waveform::advance_samples()
+void checkpoint_renderer::skip(unsigned long long samples) {
+	while(samples) {
+		update_checkpoints();
+		unsigned long long chunk = interval - position % interval;
+		if(samples < chunk)
+			chunk = samples;
+		waveform.advance_samples(chunk);
+		samples -= chunk;
+		position += chunk;
+	}
+}
+
+bool checkpoint_renderer::seek(unsigned long long new_position) {
+	// the last checkpoint at or before new_position
+	vector<checkpoint>::const_iterator i = checkpoints.end();
+	while(i != checkpoints.begin() && (i - 1)->position > new_position)
+		--i;
+	if(i == checkpoints.begin())
+		return false;
+	--i;
+	// rendering on from where we are is quicker if we're closer
+	if(position > new_position || position < i->position) {
+		if(!waveform.load_state(&i->state[0], i->state.size()))
+			return false;
+		position = i->position;
+	}
+	skip(new_position - position);
+	return true;
+}
+
+unsigned long long checkpoint_renderer::get_position() const {
+	return position;
+}
+
+unsigned long long checkpoint_renderer::get_interval() const {
+	return interval;
+}
+
+size_t checkpoint_renderer::get_num_checkpoints() const {
+	return checkpoints.size();
+}
+
+void checkpoint_renderer::clear_checkpoints() {
+	checkpoints.clear();
+}
+
+bool checkpoint_renderer::save_checkpoints(const char *path) const {
+	FILE *file = fopen(path, "wb");
+	if(!file) {
+		print_log("gendy~: can't create checkpoint file", LOG_ERROR);
+		return false;
+	}
+	checkpoint_file_header header;
+	memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+	header.version = checkpoint_version;
+	header.interval = interval;
+	header.num_checkpoints = checkpoints.size();
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	vector<checkpoint>::const_iterator i;
+	for(i = checkpoints.begin(); ok && i != checkpoints.end(); ++i) {
+		uint64_t point_position = i->position;
+		uint32_t length = i->state.size();
+		ok = fwrite(&point_position, sizeof(point_position), 1, file) == 1 &&
+			fwrite(&length, sizeof(length), 1, file) == 1 &&
+			fwrite(&i->state[0], length, 1, file) == 1;
+	}
+	if(fclose(file) != 0)
+		ok = false;
+	if(!ok)
+		print_log("gendy~: can't write checkpoint file", LOG_ERROR);
+	return ok;
+}
+
+// replaces the current checkpoints with the file's. the interval is taken
+// from the file too, so further checkpoints line up with the loaded ones
+bool checkpoint_renderer::load_checkpoints(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if(!file) {
+		print_log("gendy~: can't open checkpoint file", LOG_ERROR);
+		return false;
+	}
+	checkpoint_file_header header;
+	vector<checkpoint> loaded;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+		memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) == 0 &&
+		header.version == checkpoint_version && header.interval > 0;
+	for(uint64_t n = 0; ok && n < header.num_checkpoints; ++n) {
+		uint64_t point_position;
+		uint32_t length;
+		ok = fread(&point_position, sizeof(point_position), 1, file) == 1 &&
+			fread(&length, sizeof(length), 1, file) == 1 && length > 0 &&
+			(loaded.empty() || loaded.back().position < point_position);
+		if(!ok)
+			break;
+		checkpoint point;
+		point.position = point_position;
+		point.state.resize(length);
+		ok = fread(&point.state[0], length, 1, file) == 1;
+		loaded.push_back(point);
+	}
+	fclose(file);
+	if(!ok) {
+		print_log("gendy~: not a valid checkpoint file", LOG_ERROR);
+		return false;
+	}
+	interval = header.interval;
+	checkpoints.swap(loaded);
+	return true;
+}
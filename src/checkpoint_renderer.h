@@ -0,0 +1,85 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef CHECKPOINT_RENDERER_H
+#define CHECKPOINT_RENDERER_H
+
+#include "gendy_waveform.h"
+#include <vector>
+#include <cstddef>
+
+// Offline rendering with seeking. While rendering, the renderer snapshots
+// the waveform every interval samples. seek() then restores the nearest
+// checkpoint at or before the target and fast-forwards from it, so a
+// passage in the middle of a long piece can be rendered again without
+// starting over from sample 0.
+//
+// Because the random walk is counter based (see gendy_rng), a restored
+// checkpoint continues exactly as the original render did, or to within
+// rounding with ADDITIVE interpolation, which starts its oscillators afresh
+// from the middle of a cycle. tools/gendy-selfcheck.cpp checks both.
+// Checkpoints describe the render they were taken from; after changing
+// parameters in a way the render shouldn't repeat, clear_checkpoints().
+// Parameter changes still pending at a checkpoint's position would be
+// lost, so that checkpoint is put off until they've been applied.
+class checkpoint_renderer
+{
+	struct checkpoint {
+		unsigned long long position;
+		std::vector<char> state;
+	};
+
+	gendy_waveform &waveform;
+	unsigned long long interval;
+	// samples rendered since the start, i.e. the position of the next sample
+	unsigned long long position;
+	// in order of position
+	std::vector<checkpoint> checkpoints;
+
+	void take_checkpoint();
+	void update_checkpoints();
+	void skip(unsigned long long samples);
+
+	public:
+	checkpoint_renderer(gendy_waveform &waveform, unsigned long long interval);
+	// renders n samples into dest from the current position, and moves on
+	unsigned int render(gendysamp_t *dest, unsigned int n);
+	// moves to new_position, so the next render() starts there. returns
+	// false if there's no checkpoint to start from (nothing rendered yet)
+	bool seek(unsigned long long new_position);
+	unsigned long long get_position() const;
+	unsigned long long get_interval() const;
+	size_t get_num_checkpoints() const;
+	void clear_checkpoints();
+	// keep the checkpoints of a render in a file, to seek in a later session
+	bool save_checkpoints(const char *path) const;
+	bool load_checkpoints(const char *path);
+};
+
+#endif /* CHECKPOINT_RENDERER_H */
@@ -0,0 +1,113 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "distributions.h"
+#include <cmath>
+#include <cstring>
+
+// number of intervals in each table. the table has one more entry than this
+static const int table_size = 1024;
+static const int num_distributions = HYPERBOLIC_COSINE + 1;
+
+// quartile of the standard normal distribution, which every table is
+// scaled to
+static const double normal_quartile = 0.6744897501960817;
+
+// the unscaled inverse CDF of each distribution, and the value it takes at
+// u = 0.75 (its upper quartile)
+static double raw_inverse_cdf(distribution_t distribution, double u) {
+	switch(distribution) {
+		case CAUCHY:
+			return tan(M_PI * (u - 0.5));
+		case LOGISTIC:
+			return log(u / (1 - u));
+		case ARCSINE:
+			return sin(M_PI * (u - 0.5));
+		case HYPERBOLIC_COSINE:
+			return log(tan(M_PI * u / 2));
+		default:
+			return 0;
+	}
+}
+
+struct distribution_tables {
+	float table[num_distributions][table_size + 1];
+
+	distribution_tables() {
+		// the gaussian row is unused, gauss() is exact and cheap enough
+		memset(table[GAUSSIAN], 0, sizeof(table[GAUSSIAN]));
+		for(int d = CAUCHY; d < num_distributions; ++d) {
+			distribution_t distribution = (distribution_t)d;
+			double scale = normal_quartile / raw_inverse_cdf(distribution, 0.75);
+			for(int i = 0; i <= table_size; ++i) {
+				double u = i / (double)table_size;
+				// keep clear of the infinite tails
+				if(u < 0.5 / table_size)
+					u = 0.5 / table_size;
+				if(u > 1 - 0.5 / table_size)
+					u = 1 - 0.5 / table_size;
+				table[d][i] = scale * raw_inverse_cdf(distribution, u);
+			}
+		}
+	}
+};
+
+// built when the library loads, rather than on the first draw, which is on
+// the audio thread
+static const distribution_tables tables;
+
+double inverse_cdf(distribution_t distribution, double u) {
+	const float *table = tables.table[distribution];
+	double position = u * table_size;
+	int i = (int)position;
+	if(i >= table_size)
+		return table[table_size];
+	if(i < 0)
+		return table[0];
+	double frac = position - i;
+	return table[i] + frac * (table[i + 1] - table[i]);
+}
+
+double random_step(distribution_t distribution, gendy_rng &rng) {
+	if(distribution == GAUSSIAN)
+		return gauss(rng);
+	return inverse_cdf(distribution, randf(rng));
+}
+
+bool distribution_from_name(const char *name, distribution_t &result) {
+	static const char *names[num_distributions] =
+		{ "gaussian", "cauchy", "logistic", "arcsine", "hypcos" };
+	for(int d = 0; d < num_distributions; ++d) {
+		if(strcmp(name, names[d]) == 0) {
+			result = (distribution_t)d;
+			return true;
+		}
+	}
+	return false;
+}
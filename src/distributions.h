@@ -0,0 +1,57 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef DISTRIBUTIONS_H
+#define DISTRIBUTIONS_H
+
+#include "types.h"
+#include "util.h"
+
+// Random steps for the breakpoints' walk, drawn from the distributions
+// Xenakis used in GENDYN.
+//
+// Apart from GAUSSIAN, which keeps using gauss(), every distribution is
+// sampled by looking a uniform random number up in a precomputed table of
+// its inverse CDF, with linear interpolation between entries, so no draw
+// calls tan() or log(). The tables are built once, when the library loads.
+// The tails are cut off half a table step from 0 and 1.
+//
+// All of them are scaled to the gaussian's interquartile range, so a given
+// h_step or v_step gives steps of roughly the same typical size whichever
+// distribution is chosen; they differ in their tails and shape.
+double random_step(distribution_t distribution, gendy_rng &rng);
+
+// looks up the distribution's (scaled) inverse CDF at u, 0 <= u <= 1
+double inverse_cdf(distribution_t distribution, double u);
+
+// returns the distribution named name ("gaussian", "cauchy", "logistic",
+// "arcsine" or "hypcos") in result. returns false for an unknown name
+bool distribution_from_name(const char *name, distribution_t &result);
+
+#endif /* DISTRIBUTIONS_H */
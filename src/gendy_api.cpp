@@ -0,0 +1,273 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "gendy_api.h"
+#include "gendy_waveform.h"
+#include "log.h"
+#include <new>
+
+// an instance lives at the start of the arena, followed by the storage
+// for its breakpoint pool
+struct gendy_handle {
+	gendy_waveform waveform;
+	float samplerate;
+
+	gendy_handle(unsigned int max_breakpoints, void *storage, float samplerate) :
+		waveform(max_breakpoints, storage), samplerate(samplerate) {}
+};
+
+// keep everything in the arena aligned for any type
+static const size_t arena_alignment = sizeof(long double);
+
+static size_t align_up(size_t n) {
+	return (n + arena_alignment - 1) / arena_alignment * arena_alignment;
+}
+
+int gendy_api_version(void) {
+	return GENDY_API_VERSION;
+}
+
+void gendy_set_log_function(gendy_log_function function) {
+	set_log_function(function);
+}
+
+size_t gendy_arena_size(unsigned int max_breakpoints) {
+	// the extra alignment covers an arena that doesn't start aligned
+	return arena_alignment + align_up(sizeof(gendy_handle)) +
+		gendy_waveform::storage_size(max_breakpoints);
+}
+
+gendy_handle *gendy_create(void *arena, size_t arena_size,
+		unsigned int max_breakpoints, float samplerate) {
+	if(!arena || max_breakpoints == 0 || samplerate <= 0 ||
+			arena_size < gendy_arena_size(max_breakpoints))
+		return NULL;
+	char *start = static_cast<char *>(arena);
+	start += align_up((size_t)start) - (size_t)start;
+	void *storage = start + align_up(sizeof(gendy_handle));
+	try {
+		return new(start) gendy_handle(max_breakpoints, storage, samplerate);
+	}
+	catch(...) {
+		return NULL;
+	}
+}
+
+void gendy_destroy(gendy_handle *handle) {
+	if(handle)
+		handle->~gendy_handle();
+}
+
+unsigned int gendy_render(gendy_handle *handle, float *out, unsigned int n) {
+	return handle->waveform.get_block(out, n);
+}
+
+unsigned int gendy_get_cycle(gendy_handle *handle, float *out, unsigned int n) {
+	return handle->waveform.get_cycle(out, n);
+}
+
+void gendy_advance_cycles(gendy_handle *handle, unsigned long long n) {
+	handle->waveform.advance_cycles(n);
+}
+
+void gendy_advance_samples(gendy_handle *handle, unsigned long long n) {
+	handle->waveform.advance_samples(n);
+}
+
+// the waveform would log a count out of range, so it's clamped here and
+// reported through the return value instead
+static int set_num_breakpoints(gendy_waveform &waveform, float value) {
+	int count = (int)value;
+	int max_count = waveform.get_max_breakpoints();
+	int clamped = count < 1 ? 1 : count;
+	if(max_count && clamped > max_count)
+		clamped = max_count;
+	waveform.set_num_breakpoints(clamped);
+	return clamped == count ? 1 : -1;
+}
+
+int gendy_set_param(gendy_handle *handle, gendy_param param, float value) {
+	gendy_waveform &waveform = handle->waveform;
+	switch(param) {
+		case GENDY_PARAM_FREQUENCY:
+			if(value > 0)
+				waveform.set_avg_wavelength(handle->samplerate / value);
+			return 1;
+		case GENDY_PARAM_BREAKPOINTS:
+			return set_num_breakpoints(waveform, value);
+		case GENDY_PARAM_STEP_WIDTH:
+			waveform.set_step_width(value);
+			return 1;
+		case GENDY_PARAM_STEP_HEIGHT:
+			waveform.set_step_height(value);
+			return 1;
+		case GENDY_PARAM_DURATION_PULL:
+			waveform.set_duration_pull(value);
+			return 1;
+		case GENDY_PARAM_AMPLITUDE_PULL:
+			waveform.set_amplitude_pull(value);
+			return 1;
+		case GENDY_PARAM_INTERPOLATION:
+			if((int)value == GENDY_INTERPOLATION_LINEAR)
+				waveform.set_interpolation(LINEAR);
+			else if((int)value == GENDY_INTERPOLATION_CUBIC)
+				waveform.set_interpolation(CUBIC);
+			else if((int)value == GENDY_INTERPOLATION_ADDITIVE)
+				waveform.set_interpolation(ADDITIVE);
+			else
+				return 0;
+			return 1;
+		case GENDY_PARAM_WAVESHAPE:
+			if((int)value == GENDY_WAVESHAPE_FLAT)
+				waveform.set_waveshape(FLAT);
+			else if((int)value == GENDY_WAVESHAPE_SINE)
+				waveform.set_waveshape(SINE);
+			else if((int)value == GENDY_WAVESHAPE_SQUARE)
+				waveform.set_waveshape(SQUARE);
+			else
+				return 0;
+			return 1;
+		case GENDY_PARAM_DURATION_DISTRIBUTION:
+		case GENDY_PARAM_AMPLITUDE_DISTRIBUTION:
+			if((int)value < GENDY_DISTRIBUTION_GAUSSIAN ||
+					(int)value > GENDY_DISTRIBUTION_HYPERBOLIC_COSINE)
+				return 0;
+			if(param == GENDY_PARAM_DURATION_DISTRIBUTION)
+				waveform.set_duration_distribution((distribution_t)(int)value);
+			else
+				waveform.set_amplitude_distribution((distribution_t)(int)value);
+			return 1;
+		case GENDY_PARAM_OVERSAMPLING:
+			if((int)value != 1 && (int)value != 2 && (int)value != 4 &&
+					(int)value != 8)
+				return 0;
+			waveform.set_oversampling((int)value);
+			return 1;
+		case GENDY_PARAM_FREEZE:
+			waveform.set_frozen(value != 0);
+			return 1;
+		case GENDY_PARAM_CACHE_INTERVAL:
+			if(value < 0)
+				return 0;
+			waveform.set_cache_interval((unsigned int)value);
+			return 1;
+		case GENDY_PARAM_CACHE_THRESHOLD:
+			waveform.set_cache_threshold(value);
+			return 1;
+		case GENDY_PARAM_ADAPTIVE_OVERSAMPLING:
+			waveform.set_adaptive_oversampling(value != 0);
+			return 1;
+		case GENDY_PARAM_GAIN:
+			waveform.set_gain(value);
+			return 1;
+		case GENDY_PARAM_DC_CUTOFF:
+			if(value < 0)
+				return 0;
+			waveform.set_dc_cutoff(value / handle->samplerate);
+			return 1;
+		case GENDY_PARAM_SOFT_CLIP:
+			waveform.set_soft_clip(value != 0);
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+unsigned int gendy_set_params(gendy_handle *handle, const gendy_param *params,
+		const float *values, unsigned int count) {
+	unsigned int i;
+	for(i = 0; i < count; ++i)
+		if(!gendy_set_param(handle, params[i], values[i]))
+			break;
+	return i;
+}
+
+int gendy_schedule_param(gendy_handle *handle, gendy_param param, float value,
+		unsigned long long time, unsigned int ramp) {
+	scheduled_param_t scheduled;
+	switch(param) {
+		case GENDY_PARAM_FREQUENCY:
+			if(value <= 0)
+				return 0;
+			scheduled = SCHEDULE_FREQUENCY;
+			value /= handle->samplerate;
+			break;
+		case GENDY_PARAM_STEP_WIDTH:
+			scheduled = SCHEDULE_STEP_WIDTH;
+			break;
+		case GENDY_PARAM_STEP_HEIGHT:
+			scheduled = SCHEDULE_STEP_HEIGHT;
+			break;
+		case GENDY_PARAM_DURATION_PULL:
+			scheduled = SCHEDULE_DURATION_PULL;
+			break;
+		case GENDY_PARAM_AMPLITUDE_PULL:
+			scheduled = SCHEDULE_AMPLITUDE_PULL;
+			break;
+		case GENDY_PARAM_GAIN:
+			scheduled = SCHEDULE_GAIN;
+			break;
+		default:
+			return 0;
+	}
+	return handle->waveform.schedule(time, scheduled, value, ramp);
+}
+
+unsigned long long gendy_get_sample_time(const gendy_handle *handle) {
+	return handle->waveform.get_sample_time();
+}
+
+size_t gendy_state_size(const gendy_handle *handle) {
+	return handle->waveform.state_size();
+}
+
+size_t gendy_max_state_size(unsigned int max_breakpoints) {
+	return gendy_waveform::max_state_size(max_breakpoints);
+}
+
+size_t gendy_save_state(const gendy_handle *handle, void *dest, size_t size) {
+	return handle->waveform.save_state(dest, size);
+}
+
+int gendy_load_state(gendy_handle *handle, const void *src, size_t size) {
+	return handle->waveform.load_state(src, size);
+}
+
+gendy_handle *gendy_clone(const gendy_handle *handle, void *arena,
+		size_t arena_size) {
+	gendy_handle *copy = gendy_create(arena, arena_size,
+			handle->waveform.get_max_breakpoints(), handle->samplerate);
+	if(copy)
+		copy->waveform.copy_state(handle->waveform);
+	return copy;
+}
+
+void gendy_set_seed(gendy_handle *handle, unsigned long long seed) {
+	handle->waveform.set_seed(seed);
+}
@@ -0,0 +1,187 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef GENDY_API_H
+#define GENDY_API_H
+
+// C interface to libgendy, for embedding the DSS engine in other hosts.
+//
+// The host supplies all of the memory an instance will ever use when it
+// creates it. Nothing is allocated after gendy_create() returns, and
+// gendy_render() writes straight into the host's buffer, so every function
+// except create/destroy is safe to call from a real-time audio thread, once
+// the host has given gendy_set_log_function() a function that is: until
+// then, the few messages there are (bad snapshots, mostly) go to stderr.
+// An instance is not internally synchronized; call it from one thread at a
+// time.
+//
+// The numeric values of the enums below are part of the interface and won't
+// change within a major version.
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// bumped whenever the interface changes incompatibly
+#define GENDY_API_VERSION 1
+
+typedef struct gendy_handle gendy_handle;
+
+typedef enum {
+	GENDY_PARAM_FREQUENCY = 0,     // Hz
+	GENDY_PARAM_BREAKPOINTS = 1,   // count, up to max_breakpoints
+	GENDY_PARAM_STEP_WIDTH = 2,    // 0-1
+	GENDY_PARAM_STEP_HEIGHT = 3,   // 0-1
+	GENDY_PARAM_DURATION_PULL = 4, // 0-1
+	GENDY_PARAM_AMPLITUDE_PULL = 5,// 0-1
+	GENDY_PARAM_INTERPOLATION = 6, // a gendy_interpolation value
+	GENDY_PARAM_WAVESHAPE = 7,     // a gendy_waveshape value
+	GENDY_PARAM_DURATION_DISTRIBUTION = 8,  // a gendy_distribution value
+	GENDY_PARAM_AMPLITUDE_DISTRIBUTION = 9, // a gendy_distribution value
+	GENDY_PARAM_OVERSAMPLING = 10, // 1, 2, 4 or 8, from the next block
+	GENDY_PARAM_FREEZE = 11,       // nonzero stops the random walk
+	GENDY_PARAM_CACHE_INTERVAL = 12,  // cycles per cached render, 0 for off
+	GENDY_PARAM_CACHE_THRESHOLD = 13, // change that forces one, 0 for none
+	GENDY_PARAM_ADAPTIVE_OVERSAMPLING = 14, // nonzero makes OVERSAMPLING a limit
+	GENDY_PARAM_GAIN = 15,         // output gain, ramped over a block
+	GENDY_PARAM_DC_CUTOFF = 16,    // output highpass in Hz, 0 for off
+	GENDY_PARAM_SOFT_CLIP = 17,    // nonzero soft clips the output to -1..1
+	GENDY_PARAM_COUNT
+} gendy_param;
+
+typedef enum {
+	GENDY_INTERPOLATION_LINEAR = 0,
+	GENDY_INTERPOLATION_CUBIC = 1,
+	GENDY_INTERPOLATION_ADDITIVE = 2
+} gendy_interpolation;
+
+typedef enum {
+	GENDY_WAVESHAPE_FLAT = 0,
+	GENDY_WAVESHAPE_SINE = 1,
+	GENDY_WAVESHAPE_SQUARE = 2
+} gendy_waveshape;
+
+typedef enum {
+	GENDY_DISTRIBUTION_GAUSSIAN = 0,
+	GENDY_DISTRIBUTION_CAUCHY = 1,
+	GENDY_DISTRIBUTION_LOGISTIC = 2,
+	GENDY_DISTRIBUTION_ARCSINE = 3,
+	GENDY_DISTRIBUTION_HYPERBOLIC_COSINE = 4
+} gendy_distribution;
+
+// version of the library actually linked, to compare with GENDY_API_VERSION
+int gendy_api_version(void);
+
+// receives the library's messages, formatted, with their level: 1 for
+// errors, 2 for information. it's called on the thread of the call that
+// logs. NULL sends them to stderr again, as before one was set
+typedef void (*gendy_log_function)(int level, const char *message);
+void gendy_set_log_function(gendy_log_function function);
+
+// bytes of arena gendy_create() needs for an instance that can grow to
+// max_breakpoints breakpoints
+size_t gendy_arena_size(unsigned int max_breakpoints);
+
+// builds an instance inside arena, which must be at least
+// gendy_arena_size(max_breakpoints) bytes and stay valid until
+// gendy_destroy(). returns NULL if the arguments are invalid.
+gendy_handle *gendy_create(void *arena, size_t arena_size,
+		unsigned int max_breakpoints, float samplerate);
+
+// tears the instance down. the arena belongs to the caller again afterwards
+void gendy_destroy(gendy_handle *handle);
+
+// renders n samples into out. returns the number of samples written
+unsigned int gendy_render(gendy_handle *handle, float *out, unsigned int n);
+
+// renders one cycle of the current waveform into out, without advancing.
+// returns the number of samples written, at most n
+unsigned int gendy_get_cycle(gendy_handle *handle, float *out, unsigned int n);
+
+// moves the random walk on without rendering: to the start of the n-th
+// cycle from here, or to where n samples of gendy_render() would leave it.
+// costs roughly one breakpoint update per cycle skipped
+void gendy_advance_cycles(gendy_handle *handle, unsigned long long n);
+void gendy_advance_samples(gendy_handle *handle, unsigned long long n);
+
+// sets count parameters at once, params[i] to values[i]. returns the number
+// applied; it stops at the first unknown parameter. changes to the number of
+// breakpoints, interpolation, frequency and waveshape are picked up by
+// gendy_render() at the start of the next cycle
+unsigned int gendy_set_params(gendy_handle *handle, const gendy_param *params,
+		const float *values, unsigned int count);
+
+// sets a single parameter. returns 0 if the parameter is unknown, and -1 if
+// the value was out of range and has been clamped into it (only checked for
+// BREAKPOINTS, which is kept within 1 to max_breakpoints)
+int gendy_set_param(gendy_handle *handle, gendy_param param, float value);
+
+// changes FREQUENCY, STEP_WIDTH, STEP_HEIGHT, DURATION_PULL, AMPLITUDE_PULL
+// or GAIN at sample time, which gendy_render() splits its block at. with a
+// nonzero ramp it goes there in a straight line over that many samples
+// instead. once 64 changes are waiting, a newer one takes the place of the
+// newest one waiting for the same parameter. returns 0 if the parameter
+// can't be scheduled
+int gendy_schedule_param(gendy_handle *handle, gendy_param param, float value,
+		unsigned long long time, unsigned int ramp);
+
+// the clock gendy_schedule_param() goes by: samples gendy_render() and
+// gendy_advance_samples() have gone through since gendy_create()
+unsigned long long gendy_get_sample_time(const gendy_handle *handle);
+
+// bytes needed to snapshot the instance as it is now, and at most for an
+// instance created with max_breakpoints
+size_t gendy_state_size(const gendy_handle *handle);
+size_t gendy_max_state_size(unsigned int max_breakpoints);
+
+// writes a versioned binary snapshot of the instance (breakpoints, phase,
+// random generator and parameters) into dest. returns the number of bytes
+// written, or 0 if size is too small
+size_t gendy_save_state(const gendy_handle *handle, void *dest, size_t size);
+
+// restores a snapshot. returns 0 if it's invalid or needs more breakpoints
+// than the instance was created with
+int gendy_load_state(gendy_handle *handle, const void *src, size_t size);
+
+// forks a running instance into a new arena, which must be at least
+// gendy_arena_size() of the original's max_breakpoints. both instances
+// then continue identically until one is reseeded
+gendy_handle *gendy_clone(const gendy_handle *handle, void *arena,
+		size_t arena_size);
+
+// reseeds the instance's random walk
+void gendy_set_seed(gendy_handle *handle, unsigned long long seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GENDY_API_H */
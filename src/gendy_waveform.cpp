@@ -30,78 +30,299 @@
 #include "gendy_waveform.h"
 #include "log.h"
 #include "splines.h"
+#include "distributions.h"
+#include "trace.h"
 #include <list>
 #include <limits>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
 
 using namespace std;
 
-// gendy_waveform class constructor with all default arguments
-gendy_waveform::gendy_waveform() {
-	//initialize variables to defaults
+// each new waveform gets the next seed, so voices don't walk in lockstep.
+// atomic, as waveforms may be created on several threads at once
+static std::atomic<unsigned long long> next_seed(0);
+
+// taps of the oversampling decimators, from the one to the output rate up.
+// the later stages only have to clear the bands that would fold down into
+// what the first one passes, so they can be much shorter
+static const unsigned int decimator_taps[] = { 47, 31, 19 };
+
+// adaptive oversampling keeps every segment at least this many internal
+// samples long. a fade feeds the new cascade for fade_warmup output
+// samples, which covers the history of all three decimators, before
+// fading over to it in fade_length more
+static const float min_segment_samples = 16;
+static const unsigned int fade_warmup = 48;
+static const unsigned int fade_length = 64;
+
+// what each quality level gives up, from the full quality of level 0 down
+struct quality_setting {
+	bool linear;
+	unsigned int move_interval;
+	unsigned int oversampling_shift;
+};
+static const quality_setting quality_settings[] = {
+	{ false, 1, 0 },
+	{ true, 1, 0 },
+	{ true, 2, 1 },
+	{ true, 4, 2 },
+	{ true, 8, 3 }
+};
+
+gendy_config::gendy_config() {
+	num_breakpoints = 8;
+	wavelength = 147;
+	interpolation = CUBIC;
+	waveshape = FLAT;
 	step_width = 0.1;
 	step_height = 0.1;
 	duration_pull = 0.7;
 	amplitude_pull = 0.4;
+	duration_distribution = GAUSSIAN;
+	amplitude_distribution = GAUSSIAN;
+	oversampling = 1;
+	adaptive_oversampling = false;
+	gain = 1;
+	level = 1;
+	dc_cutoff = 0;
+	soft_clip = false;
+	seeded = false;
+	seed = 0;
+	voice = 0;
+}
+
+// gendy_waveform class constructor with all default arguments
+gendy_waveform::gendy_waveform(unsigned int max_breakpoints, void *storage) :
+		gendy_waveform(gendy_config(), max_breakpoints, storage) {
+}
+
+// lays the list out at its final size straight away. the breakpoints only
+// get their positions from center_breakpoints() and reset_breakpoints(),
+// so it ends up just as if it had been grown one breakpoint at a time
+gendy_waveform::gendy_waveform(const gendy_config &config,
+		unsigned int max_breakpoints, void *storage) :
+		pool(max_breakpoints ? max_breakpoints + max_guardpoints : 0, storage),
+		breakpoint_list(pool_allocator<breakpoint>(&pool)),
+		rng(next_seed++),
+		incoming(incoming_slots, max_scheduled) {
+	this->max_breakpoints = max_breakpoints;
+	step_width = config.step_width;
+	step_height = config.step_height;
+	duration_pull = config.duration_pull;
+	amplitude_pull = config.amplitude_pull;
 	constrain_endpoints = true;
-	
-	// start with a single breakpoint that spans the whole wavelength
-	breakpoint_list.push_front(breakpoint(147,0,147,0));
-	// and add an guard point to the end (for linear interpolation)
-	breakpoint_list.push_back(breakpoint(147,0,147,0));
-	// no pre-guard points
-	breakpoint_begin = breakpoint_list.begin();
-	breakpoint_current = breakpoint_list.begin();
-	// 1 end guard point, which acts as the end of the list of actual
-	// breakpoints
-	breakpoint_end = --breakpoint_list.end();
+	waveshape = config.waveshape;
+	duration_distribution = config.duration_distribution;
+	amplitude_distribution = config.amplitude_distribution;
+	average_wavelength = config.wavelength > 0 ? config.wavelength : 147;
 
-	set_interpolation(CUBIC);
-	
-	// set the average wavelength for 300 Hz at 44.1 kHz
-	set_avg_wavelength(147);
-	waveshape = FLAT;
-	phase = 0;
+	interpolation_type = config.interpolation;
+	if(interpolation_type != LINEAR && interpolation_type != CUBIC &&
+			interpolation_type != ADDITIVE) {
+		print_log("gendy~: unimplemented interpolation. defaulting to cubic",
+				LOG_ERROR);
+		interpolation_type = CUBIC;
+	}
+	unsigned int num_breakpoints = config.num_breakpoints;
+	if(num_breakpoints == 0)
+		num_breakpoints = 1;
+	if(max_breakpoints && num_breakpoints > max_breakpoints)
+		num_breakpoints = max_breakpoints;
+	// the guard points of each interpolation type, as apply_interpolation()
+	// sets them up
+	unsigned int pre_guardpoints = interpolation_type == CUBIC ? 1 : 0;
+	unsigned int post_guardpoints = interpolation_type == CUBIC ? 2 : 1;
+	resize_list(pre_guardpoints + num_breakpoints + post_guardpoints);
+	set_iterators(pre_guardpoints, num_breakpoints, pre_guardpoints);
 
+	clear_pending_changes();
 
-	set_num_breakpoints(8);
+	phase = 0;
+	cycle_count = 0;
+	num_listeners = 0;
+	source = NULL;
+	sink = NULL;
+	oversampling = 1;
+	oversampling_stages = 0;
+	fade_oversampling = 0;
+	fade_stages = 0;
+	fade_position = 0;
+	for(unsigned int i = 0; i < max_oversampling_stages; ++i) {
+		decimators[i].set_taps(decimator_taps[i]);
+		fade_decimators[i].set_taps(decimator_taps[i]);
+	}
+	requested_oversampling = 1;
+	if(config.oversampling == 2 || config.oversampling == 4 ||
+			config.oversampling == 8) {
+		apply_oversampling(config.oversampling);
+		requested_oversampling = config.oversampling;
+	}
+	adaptive_oversampling = config.adaptive_oversampling;
+	shortest_segment = 0;
+	requested_interpolation = interpolation_type;
+	quality_level = 0;
+	interpolation_stale = false;
+	move_interval = 1;
+	cycles_since_move = 0;
+	cache_interval = 0;
+	cache_threshold = 0;
+	frozen = false;
+	cache_stale = true;
+	cache_position = 0;
+	cache_period = 1;
+	cache_rate = 1;
+	cycles_since_render = 0;
+	accumulated_change = 0;
+	partials_stale = true;
+	gain = config.gain;
+	target_gain = gain;
+	level = config.level;
+	target_level = level;
+	dc_input = 0;
+	dc_output = 0;
+	apply_dc_cutoff(config.dc_cutoff);
+	soft_clip = config.soft_clip;
+	num_scheduled = 0;
+	for(unsigned int p = 0; p < num_scheduled_params; ++p) {
+		ramps[p].length = 0;
+		overflow[p].sequence = 0;
+		overflow[p].taken = 0;
+	}
+	num_ramps = 0;
+	sample_time = 0;
+
+	if(config.seeded)
+		rng.seed(config.seed, config.voice);
+	center_breakpoints();
 	reset_breakpoints();
 	move_breakpoints();
+	if(adaptive_oversampling) {
+		shortest_segment = find_shortest_segment();
+		apply_oversampling(needed_oversampling(shortest_segment));
+	}
 }
 
 gendy_waveform::~gendy_waveform() {
 }
 
-//TODO: protect against this getting called before data
-//strucutres are set up
+// number of bytes of storage to pass to the constructor to hold
+// max_breakpoints breakpoints
+size_t gendy_waveform::storage_size(unsigned int max_breakpoints) {
+	return breakpoint_pool::storage_size(max_breakpoints + max_guardpoints);
+}
+
+// Structural changes (number of breakpoints, interpolation) and
+// recentering are only requested here. They're applied by the audio thread
+// at the next cycle boundary, in apply_pending_changes(), so the list is
+// never changed under get_block() and, with a reserved pool, nothing is
+// allocated on the audio thread.
+
 void gendy_waveform::set_num_breakpoints(int new_size) {
+	GENDY_TRACE_SCOPE("set_num_breakpoints", new_size);
 	if(new_size <= 0) {
 		print_log("gendy~: Cannot resize to less than 1, resizing to 1", LOG_INFO);
 		new_size = 1;
 	}
+	if(max_breakpoints && (unsigned int)new_size > max_breakpoints) {
+		print_log("gendy~: Cannot resize past %d breakpoints",
+				(int)max_breakpoints, LOG_INFO);
+		new_size = max_breakpoints;
+	}
+	pending_breakpoints = new_size;
+}
 
-	unsigned int target_length = new_size + get_num_guardpoints();
+void gendy_waveform::set_avg_wavelength(float new_wavelength) {
+	if(new_wavelength <= 0)
+		return;
+	pending_wavelength = new_wavelength;
+	pending_center = true;
+}
 
-	while(breakpoint_list.size() < (target_length))
-		add_breakpoint();
-	while(breakpoint_list.size() > (target_length))
-		remove_breakpoint();
-	center_breakpoints();
+// applies any requested changes right away instead of waiting for the next
+// cycle boundary. only call this from the thread that renders
+void gendy_waveform::commit_changes() {
+	apply_block_changes();
+	if(cache_interval && !cache_stale)
+		leave_cache();
+	apply_pending_changes();
+	cache_stale = true;
 }
 
-void gendy_waveform::set_avg_wavelength(float new_wavelength) {
-	average_wavelength = new_wavelength;
-	center_breakpoints();
+void gendy_waveform::apply_pending_changes() {
+	// the current breakpoint would go stale if its node was removed, and
+	// we're about to start a new cycle anyway
+	breakpoint_current = breakpoint_begin;
+	partials_stale = true;
+	int new_interpolation = pending_interpolation.exchange(-1);
+	if(new_interpolation >= 0)
+		requested_interpolation = (interpolation_t)new_interpolation;
+	if(new_interpolation >= 0 || interpolation_stale) {
+		apply_interpolation(effective_interpolation());
+		interpolation_stale = false;
+	}
+	float new_wavelength = pending_wavelength.exchange(0);
+	if(new_wavelength > 0)
+		average_wavelength = new_wavelength;
+	// a new size centers them anyway, the request mustn't linger until the
+	// next cycle
+	bool new_center = pending_center.exchange(false);
+	int new_size = pending_breakpoints.exchange(0);
+	if(new_size > 0)
+		apply_num_breakpoints(new_size);
+	else if(new_center)
+		center_breakpoints();
+	breakpoint_current = breakpoint_begin;
 }
 
+void gendy_waveform::clear_pending_changes() {
+	pending_breakpoints = 0;
+	pending_interpolation = -1;
+	pending_wavelength = 0;
+	pending_center = false;
+	pending_oversampling = 0;
+	pending_quality = -1;
+	pending_cache_interval = -1;
+	pending_cache_threshold = -1;
+	pending_adaptive = -1;
+	pending_dc_cutoff = -1;
+}
+
+// moves on to the next cycle: applies requested changes and sets new
+// positions for the breakpoints
+void gendy_waveform::next_cycle() {
+	apply_pending_changes();
+	move_breakpoints();
+	if(adaptive_oversampling)
+		shortest_segment = find_shortest_segment();
+}
+
+// done in a single pass over the list whatever the change in size, so
+// jumping from 1 breakpoint to thousands costs no more at the cycle
+// boundary than rendering the cycle
+void gendy_waveform::apply_num_breakpoints(unsigned int new_size) {
+	GENDY_TRACE_SCOPE("apply_num_breakpoints", new_size);
+	unsigned int old_size = get_num_breakpoints();
+	if(new_size > old_size)
+		add_breakpoints(new_size - old_size);
+	else if(new_size < old_size)
+		remove_breakpoints(old_size - new_size);
+	center_breakpoints();
+}
 
 unsigned int gendy_waveform::get_num_guardpoints() const {
 	return breakpoint_list.size() - get_num_breakpoints();
 }
 
+unsigned int gendy_waveform::get_max_breakpoints() const {
+	return max_breakpoints;
+}
+
 unsigned int gendy_waveform::get_num_breakpoints() const {
-	list<breakpoint>::const_iterator i = breakpoint_begin;
+	breakpoint_list_t::const_iterator i = breakpoint_begin;
 	unsigned int num_breakpoints = 0;
 	while(i != breakpoint_end) {
 		++i;
@@ -111,8 +332,8 @@ unsigned int gendy_waveform::get_num_breakpoints() const {
 }
 
 void gendy_waveform::set_pre_guardpoints(unsigned int guardpoints) {
-	list<breakpoint>::iterator src = breakpoint_end;
-	list<breakpoint>::iterator i = breakpoint_begin;
+	breakpoint_list_t::iterator src = breakpoint_end;
+	breakpoint_list_t::iterator i = breakpoint_begin;
 	//work backwards from the first breakpoint until:
 	// a) we get to the beginning of the list (more guard points needed)
 	// b) guardpoints goes to 0 (we need to remove guardpoints)
@@ -133,12 +354,12 @@ void gendy_waveform::set_pre_guardpoints(unsigned int guardpoints) {
 }
 
 void gendy_waveform::set_post_guardpoints(unsigned int guardpoints) {
-	list<breakpoint>::iterator src = breakpoint_begin;
+	breakpoint_list_t::iterator src = breakpoint_begin;
 	// move breakpoint_end to point at the last breakpoint instead
 	// of the first node after the last breakpoint, so it doesn't
 	// get clobbered
 	--breakpoint_end;
-	list<breakpoint>::iterator i = breakpoint_end;
+	breakpoint_list_t::iterator i = breakpoint_end;
 	//work forwards from the last breakpoint until:
 	// a) we get to the end of the list (more guard points needed)
 	// b) guardpoints goes to 0 (we need to remove guardpoints)
@@ -161,6 +382,16 @@ void gendy_waveform::set_post_guardpoints(unsigned int guardpoints) {
 }
 
 void gendy_waveform::set_interpolation(interpolation_t new_interpolation) {
+	if(new_interpolation == LINEAR || new_interpolation == CUBIC ||
+			new_interpolation == ADDITIVE)
+		pending_interpolation = new_interpolation;
+	else {
+		print_log("gendy~: unimplemented interpolation. defaulting to linear",
+				LOG_ERROR);
+	}
+}
+
+void gendy_waveform::apply_interpolation(interpolation_t new_interpolation) {
 	if(new_interpolation == LINEAR) {
 		interpolation_type = LINEAR;
 		set_pre_guardpoints(0);
@@ -171,6 +402,12 @@ void gendy_waveform::set_interpolation(interpolation_t new_interpolation) {
 		set_pre_guardpoints(1);
 		set_post_guardpoints(2);
 	}
+	// the series only needs the cycle and where the next one starts
+	else if(new_interpolation == ADDITIVE) {
+		interpolation_type = ADDITIVE;
+		set_pre_guardpoints(0);
+		set_post_guardpoints(1);
+	}
 	else {
 		print_log("gendy~: unimplemented interpolation. defaulting to linear",
 				LOG_ERROR);
@@ -187,7 +424,7 @@ void gendy_waveform::set_interpolation_type(t_symbol *new_interpolation) {
 
 void gendy_waveform::set_waveshape(waveshape_t new_waveshape) {
 	waveshape = new_waveshape;
-	center_breakpoints();
+	pending_center = true;
 }
 
 void gendy_waveform::set_step_width(float new_width) {
@@ -206,12 +443,322 @@ void gendy_waveform::set_amplitude_pull(float new_pull) {
 	amplitude_pull = new_pull;
 }
 
+float gendy_waveform::get_avg_wavelength() const {
+	float wavelength = pending_wavelength;
+	return wavelength > 0 ? wavelength : average_wavelength;
+}
+
+float gendy_waveform::get_step_width() const {
+	return step_width;
+}
+
+float gendy_waveform::get_step_height() const {
+	return step_height;
+}
+
+float gendy_waveform::get_amplitude_pull() const {
+	return amplitude_pull;
+}
+
+float gendy_waveform::get_duration_pull() const {
+	return duration_pull;
+}
+
 void gendy_waveform::set_constrain_endpoints(bool constrain) {
 	constrain_endpoints = constrain;
 }
 
+void gendy_waveform::set_oversampling(unsigned int factor) {
+	if(factor != 1 && factor != 2 && factor != 4 && factor != 8) {
+		print_log("gendy~: oversampling has to be 1, 2, 4 or 8", LOG_ERROR);
+		return;
+	}
+	pending_oversampling = factor;
+}
+
+unsigned int gendy_waveform::get_oversampling() const {
+	return oversampling;
+}
+
+void gendy_waveform::set_adaptive_oversampling(bool adaptive) {
+	pending_adaptive = adaptive;
+}
+
+bool gendy_waveform::is_oversampling_adaptive() const {
+	return adaptive_oversampling;
+}
+
+void gendy_waveform::set_quality_level(unsigned int level) {
+	if(level > max_quality_level)
+		level = max_quality_level;
+	pending_quality = level;
+}
+
+unsigned int gendy_waveform::get_quality_level() const {
+	return quality_level;
+}
+
+void gendy_waveform::set_cache_interval(unsigned int interval) {
+	pending_cache_interval = interval;
+}
+
+void gendy_waveform::set_cache_threshold(float threshold) {
+	pending_cache_threshold = threshold > 0 ? threshold : 0;
+}
+
+unsigned int gendy_waveform::get_cache_interval() const {
+	return cache_interval;
+}
+
+void gendy_waveform::set_gain(float new_gain) {
+	target_gain = new_gain;
+}
+
+float gendy_waveform::get_gain() const {
+	return target_gain;
+}
+
+void gendy_waveform::set_level(float new_level) {
+	target_level = new_level;
+}
+
+float gendy_waveform::get_level() const {
+	return target_level;
+}
+
+void gendy_waveform::set_dc_cutoff(float cutoff) {
+	pending_dc_cutoff = cutoff > 0 ? cutoff : 0;
+}
+
+float gendy_waveform::get_dc_cutoff() const {
+	return dc_cutoff;
+}
+
+void gendy_waveform::set_soft_clip(bool clip) {
+	soft_clip = clip;
+}
+
+bool gendy_waveform::is_soft_clipping() const {
+	return soft_clip;
+}
+
+void gendy_waveform::set_frozen(bool freeze) {
+	frozen = freeze;
+}
+
+bool gendy_waveform::is_frozen() const {
+	return frozen;
+}
+
+// oversampling and quality changes don't touch the breakpoints, so they
+// can take effect at any block, unlike the rest
+void gendy_waveform::apply_block_changes() {
+	int new_oversampling = pending_oversampling.exchange(0);
+	if(new_oversampling) {
+		requested_oversampling = new_oversampling;
+		if(!adaptive_oversampling)
+			apply_oversampling(oversampling_ceiling());
+	}
+	int new_quality = pending_quality.exchange(-1);
+	if(new_quality >= 0)
+		apply_quality_level(new_quality);
+	int new_adaptive = pending_adaptive.exchange(-1);
+	if(new_adaptive >= 0 && (bool)new_adaptive != adaptive_oversampling) {
+		adaptive_oversampling = new_adaptive;
+		if(adaptive_oversampling)
+			shortest_segment = find_shortest_segment();
+		// back to the full factor, faded like any other change
+		else if(!fade_oversampling && oversampling != oversampling_ceiling())
+			start_fade(oversampling_ceiling());
+	}
+	if(adaptive_oversampling)
+		adapt_oversampling();
+	float new_threshold = pending_cache_threshold.exchange(-1);
+	if(new_threshold >= 0)
+		cache_threshold = new_threshold;
+	int new_interval = pending_cache_interval.exchange(-1);
+	if(new_interval >= 0 && (unsigned int)new_interval != cache_interval) {
+		if(cache_interval && !cache_stale)
+			leave_cache();
+		cache_interval = new_interval;
+		cache_stale = true;
+	}
+	float new_cutoff = pending_dc_cutoff.exchange(-1);
+	if(new_cutoff >= 0)
+		apply_dc_cutoff(new_cutoff);
+}
+
+// the highpass is y[n] = x[n] - x[n-1] + R*y[n-1], with its pole at
+// R = 1 - 2*pi*cutoff, which is close enough for the low cutoffs it's for.
+// turning it off forgets its history, so it starts clean when turned back on
+void gendy_waveform::apply_dc_cutoff(float cutoff) {
+	if(cutoff > 0.25f)
+		cutoff = 0.25f;
+	if(cutoff <= 0) {
+		cutoff = 0;
+		dc_input = 0;
+		dc_output = 0;
+	}
+	dc_cutoff = cutoff;
+	dc_coefficient = 1 - 2 * M_PI * cutoff;
+	if(dc_coefficient < 0)
+		dc_coefficient = 0;
+}
+
+// gain, DC blocking and clipping in a single pass over the block, while
+// it's still in the cache from rendering
+void gendy_waveform::apply_output_stage(gendysamp_t *dest, unsigned int n) {
+	float target = target_gain;
+	float target_note = target_level;
+	bool clip = soft_clip;
+	if(gain == 1 && target == 1 && level == 1 && target_note == 1 &&
+			!dc_cutoff && !clip)
+		return;
+	float current = gain * level;
+	float gain_step = (target * target_note - current) / n;
+	gendysamp_t x1 = dc_input;
+	gendysamp_t y1 = dc_output;
+	const gendysamp_t r = dc_coefficient;
+	bool dc = dc_cutoff > 0;
+	for(unsigned int i = 0; i < n; ++i) {
+		current += gain_step;
+		gendysamp_t x = dest[i] * current;
+		if(dc) {
+			gendysamp_t y = x - x1 + r * y1;
+			x1 = x;
+			y1 = y;
+			x = y;
+		}
+		// a cubic with unit slope at 0 that flattens out at 1.5 -> 1
+		if(clip) {
+			if(x > 1.5f)
+				x = 1.5f;
+			else if(x < -1.5f)
+				x = -1.5f;
+			x -= (4.0f / 27.0f) * x * x * x;
+		}
+		dest[i] = x;
+	}
+	gain = target;
+	level = target_note;
+	if(dc) {
+		// a decaying output would otherwise run into denormals in silence
+		if(fabs(y1) < 1e-20f)
+			y1 = 0;
+		dc_input = x1;
+		dc_output = y1;
+	}
+}
+
+void gendy_waveform::apply_quality_level(unsigned int level) {
+	if(level == quality_level)
+		return;
+	quality_level = level;
+	const quality_setting &setting = quality_settings[level];
+	if(!adaptive_oversampling)
+		apply_oversampling(oversampling_ceiling());
+	move_interval = setting.move_interval;
+	if(effective_interpolation() != interpolation_type)
+		interpolation_stale = true;
+}
+
+interpolation_t gendy_waveform::effective_interpolation() const {
+	if(quality_settings[quality_level].linear)
+		return LINEAR;
+	return requested_interpolation;
+}
+
+// the decimators start out silent, so switching fades in over a few samples
+void gendy_waveform::apply_oversampling(unsigned int factor) {
+	fade_oversampling = 0;
+	if(factor == oversampling)
+		return;
+	oversampling = factor;
+	oversampling_stages = 0;
+	while((1u << oversampling_stages) < factor)
+		++oversampling_stages;
+	for(unsigned int i = 0; i < oversampling_stages; ++i)
+		decimators[i].reset();
+}
+
+// the factor asked for, less what the quality level gives up
+unsigned int gendy_waveform::oversampling_ceiling() const {
+	unsigned int factor = requested_oversampling >>
+		quality_settings[quality_level].oversampling_shift;
+	return factor ? factor : 1;
+}
+
+// Adaptive oversampling
+//
+// The factor goes up as soon as the shortest segment calls for it, and
+// down only once the segments would still be long enough at half the
+// factor it moves to, so it doesn't flap at the edge.
+
+void gendy_waveform::adapt_oversampling() {
+	if(fade_oversampling)
+		return;
+	unsigned int target = needed_oversampling(shortest_segment);
+	if(target <= oversampling) {
+		unsigned int relaxed = needed_oversampling(shortest_segment / 2);
+		target = relaxed < oversampling ? relaxed : oversampling;
+	}
+	if(target != oversampling)
+		start_fade(target);
+}
+
+// the lowest factor, up to the ceiling, that gives every segment of
+// shortest output samples min_segment_samples internal ones
+unsigned int gendy_waveform::needed_oversampling(float shortest) const {
+	// additive rendering doesn't alias to begin with
+	if(interpolation_type == ADDITIVE)
+		return 1;
+	unsigned int ceiling = oversampling_ceiling();
+	unsigned int factor = 1;
+	while(factor < ceiling && shortest * factor < min_segment_samples)
+		factor *= 2;
+	return factor;
+}
+
+float gendy_waveform::find_shortest_segment() const {
+	float shortest = numeric_limits<float>::max();
+	breakpoint_list_t::const_iterator i;
+	for(i = breakpoint_begin; i != breakpoint_end; ++i)
+		if(i->get_duration() < shortest)
+			shortest = i->get_duration();
+	return shortest;
+}
+
+void gendy_waveform::start_fade(unsigned int factor) {
+	GENDY_TRACE_SCOPE("oversampling_fade", factor);
+	fade_oversampling = factor;
+	fade_stages = 0;
+	while((1u << fade_stages) < factor)
+		++fade_stages;
+	for(unsigned int i = 0; i < fade_stages; ++i)
+		fade_decimators[i].reset();
+	fade_position = 0;
+}
+
+// the new cascade takes over where it is, history and all
+void gendy_waveform::finish_fade() {
+	for(unsigned int i = 0; i < fade_stages; ++i)
+		decimators[i] = fade_decimators[i];
+	oversampling = fade_oversampling;
+	oversampling_stages = fade_stages;
+	fade_oversampling = 0;
+}
+
+// the distributions are used from the next time the breakpoints move
+void gendy_waveform::set_duration_distribution(distribution_t distribution) {
+	duration_distribution = distribution;
+}
+
+void gendy_waveform::set_amplitude_distribution(distribution_t distribution) {
+	amplitude_distribution = distribution;
+}
+
 float gendy_waveform::get_wavelength() const {
-	list<breakpoint>::iterator i;
+	breakpoint_list_t::iterator i;
 	float wavelength = 0;
 	for(i = breakpoint_begin; i != breakpoint_end; i++)
 		wavelength += i->get_duration();
@@ -220,99 +767,198 @@ float gendy_waveform::get_wavelength() const {
 
 // set new positions for all the breakpoints
 void gendy_waveform::move_breakpoints() {
-	int breakpoint_count;
-	
-	// first we copy the last breakpoints of the current cycle into
-	// the pre guard points, which represent the past
-	
-	list<breakpoint>::iterator i = breakpoint_begin;
-	list<breakpoint>::iterator j = breakpoint_end;
-	while(i != breakpoint_list.begin())
-		*(--i) = *(--j);
+	GENDY_TRACE_SCOPE("move_breakpoints", (long)cycle_count);
+	GENDY_STATS_START(start);
+	GENDY_STATS_COUNT(stats, cycles);
 
-	// now we copy the post guard points (which represent the first
-	// breakpoints of the next cycle) into the beginning of this cycle
-	i = breakpoint_begin;
-	j = breakpoint_end;
-	while(j != breakpoint_list.end())
-		*(i++) = *(j++);
-	// i now points to the first breakpoint that needs to be newly calculated.
-	// we'll also continue into the post guard points and recalculate those,
-	// they are the future
+	if(frozen || !source || !replay_breakpoints()) {
+		// first we copy the last breakpoints of the current cycle into
+		// the pre guard points, which represent the past
+		
+		breakpoint_list_t::iterator i = breakpoint_begin;
+		breakpoint_list_t::iterator j = breakpoint_end;
+		while(i != breakpoint_list.begin())
+			*(--i) = *(--j);
 
-	
-	// calculate new values for all the rest of the breakpoints
-	while(i != breakpoint_list.end()) {
-		i->elastic_move(step_width, step_height, duration_pull, amplitude_pull);
-		i++;
+		// now we copy the post guard points (which represent the first
+		// breakpoints of the next cycle) into the beginning of this cycle
+		i = breakpoint_begin;
+		j = breakpoint_end;
+		while(j != breakpoint_list.end())
+			*(i++) = *(j++);
+		// i now points to the first breakpoint that needs to be newly
+		// calculated. we'll also continue into the post guard points and
+		// recalculate those, they are the future
+
+		// at a reduced quality level the breakpoints hold still for a few
+		// cycles. the cycle after this one is then this one again, so the
+		// post guard points are its first breakpoints
+		// frozen, they hold for good
+		if(frozen || ++cycles_since_move < move_interval) {
+			j = breakpoint_begin;
+			for(i = breakpoint_end; i != breakpoint_list.end(); ++i)
+				*i = *(j++);
+			i = breakpoint_list.end();
+		}
+		else {
+			cycles_since_move = 0;
+			// calculate new values for all the rest of the breakpoints,
+			// from this cycle's own random stream
+			rng.set_stream(cycle_count++);
+		}
+		// the cycle cache keeps count of how far they've gone
+		float change = 0;
+		unsigned int moved = 0;
+		while(i != breakpoint_list.end()) {
+			double h_random = random_step(duration_distribution, rng);
+			double v_random = random_step(amplitude_distribution, rng);
+			gendydur_t old_duration = i->get_duration();
+			gendyamp_t old_amplitude = i->get_amplitude();
+			i->elastic_move(step_width, step_height, duration_pull,
+					amplitude_pull, h_random, v_random);
+			change += fabs(i->get_amplitude() - old_amplitude) +
+				fabs(i->get_duration() - old_duration) / old_duration;
+			++moved;
+			i++;
+		}
+		if(moved)
+			accumulated_change += change / moved;
 	}
+	GENDY_STATS_ADD_TIME(stats, move_time, start);
+
+	for(unsigned int n = 0; n < num_listeners; ++n)
+		listeners[n]->cycle_moved(*this);
 }
 
-// adds a breakpoint by splitting the longest breakpoint into two
-void gendy_waveform::add_breakpoint() {
-	gendydur_t new_duration;
-	gendyamp_t new_amplitude;
+// takes the next cycle's breakpoints from the source instead of moving
+// them. returns false, and drops the source, once it has finished. if it
+// just hasn't got the next cycle ready we play the current one again
+bool gendy_waveform::replay_breakpoints() {
+	unsigned int pre_guardpoints =
+		distance(breakpoint_list.begin(), breakpoint_begin);
+	unsigned int post_guardpoints =
+		distance(breakpoint_end, breakpoint_list.end());
+	unsigned int length;
+	if(!source->next_cycle(post_guardpoints, length)) {
+		if(!source->finished())
+			return true;
+		source = NULL;
+		return false;
+	}
+	if(length == 0 || (max_breakpoints && length > max_breakpoints)) {
+		print_log("gendy~: replayed cycle has too many breakpoints", LOG_ERROR);
+		source = NULL;
+		return false;
+	}
 
-	gendydur_t longest_dur = 0;
-	list<breakpoint>::iterator longest_dur_breakpoint;
-	list<breakpoint>::iterator breakpoint_iter;
+	// the pre guard points are the end of the cycle we're leaving
+	gendydur_t durations[max_guardpoints];
+	gendyamp_t amplitudes[max_guardpoints];
+	breakpoint_list_t::iterator i = breakpoint_end;
+	for(unsigned int n = pre_guardpoints; n > 0; --n) {
+		--i;
+		durations[n - 1] = i->get_duration();
+		amplitudes[n - 1] = i->get_amplitude();
+	}
+	unsigned int old_size = breakpoint_list.size();
+	if(!resize_list(pre_guardpoints + length + post_guardpoints)) {
+		source = NULL;
+		return false;
+	}
+	set_iterators(pre_guardpoints, length, pre_guardpoints);
+	// the centers aren't replayed, but they have to fit the number of
+	// breakpoints for when the random walk takes over again. this copies
+	// into the guard points, so it has to come before the positions
+	if(breakpoint_list.size() != old_size)
+		center_breakpoints();
 
-	// find the longest breakpoint
-	for(breakpoint_iter = breakpoint_begin;
-			breakpoint_iter != breakpoint_end;
-			breakpoint_iter++) {
-		if((breakpoint_iter->get_duration()) > longest_dur) {
-			longest_dur = breakpoint_iter->get_duration();
-			longest_dur_breakpoint = breakpoint_iter;
-		}
+	i = breakpoint_list.begin();
+	for(unsigned int n = 0; n < pre_guardpoints; ++n, ++i)
+		i->set_position(durations[n], amplitudes[n]);
+	for(unsigned int n = 0; n < length + post_guardpoints; ++n, ++i) {
+		gendydur_t duration;
+		gendyamp_t amplitude;
+		source->get_point(n, duration, amplitude);
+		i->set_position(duration, amplitude);
 	}
+	++cycle_count;
+	return true;
+}
 
-	// set the duration of the new breakpoint to be half the previous
-	new_duration = longest_dur_breakpoint->get_duration() / 2;
-	// halve the duration of the previous breakpoint
-	longest_dur_breakpoint->set_duration(new_duration);
-	// set the new amplitude to be the average of the 2 adjacent breakpoints
-	// and move longest_dur_breakpoint iterator to the next breakpoint
-	// for insertion
-	new_amplitude = (longest_dur_breakpoint->get_amplitude() +
-			(++longest_dur_breakpoint)->get_amplitude()) / 2;
-	// insert the breakpoint in the list
-	breakpoint_list.insert(longest_dur_breakpoint,
-			breakpoint(new_duration, new_amplitude));
-	//TODO: copy data to guard points if need be
-}
-
-// remove the breakpoint closest to its neighbors. breakpoints centers
-// should be reset after.
-void gendy_waveform::remove_breakpoint() {
-	// start smallest_space to be the largest it can be
-	gendydur_t smallest_space = numeric_limits<gendydur_t>::max();
-	gendydur_t space;
-	list<breakpoint>::iterator smallest_space_position = breakpoint_list.end();
-	
-	// find the breakpoint closest to the adjacent breakpoints
-	list<breakpoint>::iterator breakpoint_iter = breakpoint_begin;
-	list<breakpoint>::iterator breakpoint_last = breakpoint_end;
-	--breakpoint_last;
-	while(breakpoint_iter != breakpoint_last) {
-		space = breakpoint_iter->get_duration() +
-			(++breakpoint_iter)->get_duration();
-		if(space < smallest_space) {
-			smallest_space = space;
-			smallest_space_position = breakpoint_iter;
+// adds count breakpoints by splitting the segments, each into as many
+// pieces as its share of the cycle's duration calls for. the new
+// breakpoints are spread evenly along their segment, on the line to the
+// next breakpoint. breakpoint centers should be reset after.
+void gendy_waveform::add_breakpoints(unsigned int count) {
+	GENDY_STATS_COUNT(stats, resizes);
+	double total = 0;
+	breakpoint_list_t::iterator i;
+	for(i = breakpoint_begin; i != breakpoint_end; ++i)
+		total += i->get_duration();
+
+	double position = 0;
+	unsigned int added = 0;
+	i = breakpoint_begin;
+	while(i != breakpoint_end) {
+		breakpoint_list_t::iterator next = i;
+		++next;
+		gendydur_t duration = i->get_duration();
+		position += duration;
+		// rounding the running total rather than each share makes them
+		// add up to count
+		unsigned int target = next == breakpoint_end || total <= 0 ? count :
+			(unsigned int)(count * position / total + 0.5);
+		if(target > added) {
+			unsigned int pieces = target - added + 1;
+			gendyamp_t from = i->get_amplitude();
+			gendyamp_t to = next->get_amplitude();
+			i->set_duration(duration / pieces);
+			for(unsigned int k = 1; k < pieces; ++k)
+				breakpoint_list.insert(next, breakpoint(duration / pieces,
+						from + (to - from) * k / pieces));
+			added = target;
 		}
+		i = next;
+	}
+}
+
+// removes count breakpoints, keeping the ones that come nearest after
+// evenly spaced points in the cycle, so it's the crowded ones that go. a
+// removed breakpoint's duration goes to the one before it. breakpoint
+// centers should be reset after.
+void gendy_waveform::remove_breakpoints(unsigned int count) {
+	GENDY_STATS_COUNT(stats, resizes);
+	double total = 0;
+	unsigned int num_breakpoints = 0;
+	breakpoint_list_t::iterator i;
+	for(i = breakpoint_begin; i != breakpoint_end; ++i) {
+		total += i->get_duration();
+		++num_breakpoints;
 	}
-	if(smallest_space_position != breakpoint_list.end()) {
-		// if the element we're about to erase is the current one
-		if(breakpoint_current == smallest_space_position) {
-			--breakpoint_current;
-			phase += breakpoint_current->get_duration();
+	if(count >= num_breakpoints)
+		return;
+
+	// the first breakpoint always stays, as breakpoint_begin points at it
+	unsigned int keep = num_breakpoints - count;
+	unsigned int kept = 1;
+	unsigned int left = num_breakpoints - 1;
+	breakpoint_list_t::iterator previous = breakpoint_begin;
+	double position = breakpoint_begin->get_duration();
+	i = breakpoint_begin;
+	++i;
+	while(i != breakpoint_end) {
+		gendydur_t duration = i->get_duration();
+		if(kept < keep && (position >= kept * total / keep ||
+					left <= keep - kept)) {
+			previous = i++;
+			++kept;
+		}
+		else {
+			previous->set_duration(previous->get_duration() + duration);
+			i = breakpoint_list.erase(i);
 		}
-		// erase returns the list element following the erased one
-		smallest_space_position = breakpoint_list.erase(smallest_space_position);
-		// add the erased breakpoint's duration to the previous breakpoint
-		(--smallest_space_position)->set_duration(smallest_space);
-		//TODO: update guard points if need be
+		position += duration;
+		--left;
 	}
 }
 
@@ -320,10 +966,11 @@ void gendy_waveform::remove_breakpoint() {
 // TODO: sawtooth and triangle
 // TODO: crashes when called on empty breakpoint list
 void gendy_waveform::center_breakpoints() {
-	gendydur_t new_dur;
-	gendyamp_t new_amp;
+	GENDY_TRACE_SCOPE("center_breakpoints", get_num_breakpoints());
+	GENDY_STATS_START(start);
+	GENDY_STATS_COUNT(stats, centers);
 
-	list<breakpoint>::iterator breakpoint_iter = breakpoint_begin;
+	breakpoint_list_t::iterator breakpoint_iter = breakpoint_begin;
 	unsigned int breakpoint_index = 0;
 	unsigned int num_breakpoints = get_num_breakpoints();
 	while(breakpoint_iter != breakpoint_end) {
@@ -342,24 +989,33 @@ void gendy_waveform::center_breakpoints() {
 	}
 	
 	// copy center data starting at the end of the actual breakpoints
-	// into the beginning guard points
-	list<breakpoint>::iterator i = breakpoint_begin;
-	list<breakpoint>::iterator j = breakpoint_end;
-	while(i != breakpoint_list.begin())
-		*(--i) = *(--j);
+	// into the beginning guard points. only the centers: the guard points
+	// keep their positions, which are the neighbouring cycles' breakpoints
+	// as they've already moved
+	breakpoint_list_t::iterator i = breakpoint_begin;
+	breakpoint_list_t::iterator j = breakpoint_end;
+	while(i != breakpoint_list.begin()) {
+		--i;
+		--j;
+		i->set_center(j->get_center_duration(), j->get_center_amplitude());
+	}
 
 	// copy center data starting at the beginning of the actual breakpoints
 	// into the end guard points
 	i = breakpoint_begin;
 	j = breakpoint_end;
-	while(j != breakpoint_list.end())
-		*(j++) = *(i++);
+	while(j != breakpoint_list.end()) {
+		j->set_center(i->get_center_duration(), i->get_center_amplitude());
+		++i;
+		++j;
+	}
+	GENDY_STATS_ADD_TIME(stats, center_time, start);
 }
 
 // reset_breakpoints() sets all of the breakpoint positions to be the
 // center positions
 void gendy_waveform::reset_breakpoints() {
-	list<breakpoint>::iterator current;
+	breakpoint_list_t::iterator current;
 	for(current = breakpoint_list.begin();
 			current != breakpoint_list.end(); current++)
 		current->set_position(current->get_center_duration(),
@@ -367,57 +1023,45 @@ void gendy_waveform::reset_breakpoints() {
 }
 
 
-/*
- * generates a block of gendy audio.
- * This function will take care of moving the breakpoints when it reaches
- * the end of a cycle.
- */
-//TODO: should this really return the number of samples copied? it's always
-//      bufsize
-unsigned int gendy_waveform::get_block(gendysamp_t *dest, unsigned int bufsize) {
-	if(interpolation_type == LINEAR) {
-		// assert that we have no pre guard points and at least 1 post guard point
-		assert(breakpoint_begin == breakpoint_list.begin());
-		assert(breakpoint_end != breakpoint_list.end());
-		// generate the endpoints for the current segment
-		list<breakpoint>::iterator breakpoint_next = breakpoint_current;
-		breakpoint_next++;
-		gendydur_t current_dur = breakpoint_current->get_duration();
-		gendydur_t current_amp = breakpoint_current->get_amplitude();
-		gendydur_t next_dur = breakpoint_next->get_duration();
-		gendydur_t next_amp = breakpoint_next->get_amplitude();
-
-		for(unsigned int i = 0; i < bufsize; i++) {
-			dest[i] = current_amp + phase / current_dur * (next_amp - current_amp);
-			phase++;
-			// if we've reached the end of the current segment
-			if(phase > current_dur) {
-				breakpoint_current = breakpoint_next;;
-				breakpoint_next++;
-				phase -= current_dur;
-				current_dur = next_dur;
-				current_amp = next_amp;
-				// if we've reached the end of this cycle
-				if(breakpoint_next == breakpoint_end) {
-					move_breakpoints();
-					// wrap around the current and next iterators to the beginning
-					breakpoint_current = breakpoint_begin;
-					breakpoint_next = breakpoint_begin;
-					breakpoint_next++;
-				}
-				next_dur = breakpoint_next->get_duration();
-				next_amp = breakpoint_next->get_amplitude();
-			}
-		}
+// Segment policies
+//
+// The render loops are templates over one of these, so each interpolation
+// type gets its own loop with everything inlined and no per-sample
+// dispatch. start() sets up the segment from current to the breakpoint
+// after it and returns its duration, value() interpolates phase samples
+// into it.
+
+struct linear_segment {
+	static const interpolation_t type = LINEAR;
+	gendyamp_t amplitude;
+	gendyamp_t rise;
+	gendydur_t duration;
+
+	gendydur_t start(breakpoint_list_t::const_iterator current) {
+		breakpoint_list_t::const_iterator next = current;
+		++next;
+		duration = current->get_duration();
+		amplitude = current->get_amplitude();
+		rise = next->get_amplitude() - amplitude;
+		return duration;
+	}
+
+	gendysamp_t value(gendydur_t phase) const {
+		return amplitude + phase / duration * rise;
 	}
-	else if(interpolation_type == CUBIC) {
+};
+
+struct cubic_segment {
+	static const interpolation_t type = CUBIC;
+	double coefs[4];
+
+	gendydur_t start(breakpoint_list_t::const_iterator current) {
 		double x[4];
 		double y[4];
-		double coefs[4];
-		// set iter to be the breakpoint before the current one
-		list<breakpoint>::const_iterator iter = breakpoint_current;
+		// start at the breakpoint before the current one
+		breakpoint_list_t::const_iterator iter = current;
 		--iter;
-		//collect the 4 points needed to interpolate in the first segment
+		//collect the 4 points needed to interpolate in this segment
 		//x[0] will be negative enough to make x[1]=0, the beginning of
 		//the segment we're actually interested in here
 		x[0] = -iter->get_duration();
@@ -427,118 +1071,1299 @@ unsigned int gendy_waveform::get_block(gendysamp_t *dest, unsigned int bufsize)
 			++iter;
 			y[i] = iter->get_amplitude();
 		}
-		//iter is now pointing at the 4th point of this set
-
 		get_cspline_coefs(x,y,coefs);
+		// x[2]
+		return current->get_duration();
+	}
 
-		for(unsigned int i = 0; i < bufsize; i++) {
-			dest[i] = cspline_interp(coefs,phase);
-			++phase;
-			//if we're past the end of the segment
-			if(phase > x[2]) {
-				++breakpoint_current;
-				phase -= x[2];
-				// if we've reached the end of the current cycle
-				if(breakpoint_current == breakpoint_end) {
-					move_breakpoints();
-					breakpoint_current = breakpoint_begin;
-				}
-				iter = breakpoint_current;
-				--iter;
-				x[0] = -iter->get_duration();
-				y[0] = iter->get_amplitude();
-				for(int i = 1; i < 4; i++) {
-					x[i] = x[i-1] + iter->get_duration();
-					++iter;
-					y[i] = iter->get_amplitude();
-				}
-				get_cspline_coefs(x,y,coefs);
-			}
-		}
+	gendysamp_t value(gendydur_t phase) const {
+		return cspline_interp(coefs,phase);
+	}
+};
+
+/*
+ * generates a block of gendy audio.
+ * This function will take care of moving the breakpoints when it reaches
+ * the end of a cycle.
+ */
+//TODO: should this really return the number of samples copied? it's always
+//      bufsize
+unsigned int gendy_waveform::get_block(gendysamp_t *dest, unsigned int bufsize) {
+	GENDY_TRACE_SCOPE("get_block", bufsize);
+	take_scheduled();
+	if(!num_scheduled && !num_ramps) {
+		render_span(dest, bufsize);
+		sample_time += bufsize;
 	}
 	else {
-		print_log("gendy~: Unimplemeted Interpolation Type", LOG_ERROR);
-		assert(0);
+		// in spans between the scheduled changes
+		unsigned int done = 0;
+		while(done < bufsize) {
+			unsigned int n = apply_scheduled(bufsize - done);
+			render_span(dest + done, n);
+			done += n;
+			sample_time += n;
+		}
 	}
+	if(sink)
+		sink->write_block(dest, bufsize);
 	return bufsize;
 }
 
-//TODO:needs protection against buffer overrun
-unsigned int gendy_waveform::get_cycle(gendysamp_t *dest, unsigned int bufsize) const {
-	if(interpolation_type == LINEAR) {
-		assert(get_num_guardpoints() == 1);
-
-		// we'll be going through the waveform piecewise. next stores
-		// the endpoint of the current section
-		list<breakpoint>::const_iterator next = breakpoint_list.begin();
-		// keep track of how long before a sample boundry the current
-		// segment started. the first segment will start at the beginning of the buffer
-		gendydur_t segment_shift = 0;
-		gendydur_t current_dur, next_dur;
-		gendyamp_t current_amp, next_amp;
-		double slope;
-		current_dur = next->get_duration();
-		current_amp = next->get_amplitude();
-
-		unsigned int buffer_offset = 0;
-		// for each breakpoint
-		while(++next != breakpoint_list.end()) {
-			next_amp = next->get_amplitude();
-			slope = (next_amp - current_amp) / current_dur;
-			unsigned int i = 0;
-			while(i + segment_shift < current_dur && i + buffer_offset < bufsize) {
-				dest[i + buffer_offset] = current_amp +
-					slope * (i + segment_shift);
-				i++;
-			}
-			buffer_offset += i;
-			segment_shift = (gendydur_t)i + segment_shift - current_dur;
-			current_dur = next->get_duration();
-			current_amp = next_amp;
+void gendy_waveform::render_span(gendysamp_t *dest, unsigned int n) {
+	apply_block_changes();
+	if(cache_interval)
+		render_cached(dest, n);
+	else if(oversampling == 1 && !fade_oversampling)
+		render_block(dest, n, 1);
+	else {
+		unsigned int done = 0;
+		while(done < n) {
+			unsigned int chunk = n - done;
+			if(chunk > halfband_decimator::block_size)
+				chunk = halfband_decimator::block_size;
+			if(fade_oversampling)
+				render_fade(dest + done, chunk);
+			else
+				render_oversampled(dest + done, chunk);
+			done += chunk;
 		}
-		return buffer_offset;
 	}
-	else if(interpolation_type == CUBIC) {
-		assert(get_num_guardpoints() == 3);
-		double x[4];
-		double y[4];
-		double coefs[4];
-		double x_in = 0;
-		// set iter to be the first guard breakpoint
-		list<breakpoint>::const_iterator iter = breakpoint_begin;
-		--iter;
-		//collect the 4 points needed to interpolate in the first segment
-		//x[0] will be negative enough to make x[1]=0, the beginning of
-		//the segment we're actually interested in here
-		x[0] = -iter->get_duration();
-		y[0] = iter->get_amplitude();
-		for(int i = 1; i < 4; i++) {
-			x[i] = x[i-1] + iter->get_duration();
-			++iter;
-			y[i] = iter->get_amplitude();
+	apply_output_stage(dest, n);
+}
+
+void gendy_waveform::render_block(gendysamp_t *dest, unsigned int bufsize,
+		gendydur_t step) {
+	// render loops by interpolation type, in the order of interpolation_t
+	static const render_function renderers[] = {
+		&gendy_waveform::render_with<linear_segment>,
+		&gendy_waveform::render_with<cubic_segment>,
+		NULL,
+		NULL,
+		&gendy_waveform::render_additive_with
+	};
+	unsigned int done = 0;
+	// the render loops return early if the interpolation type changes at a
+	// cycle boundary, and we carry on with the new one
+	while(done < bufsize) {
+		if(interpolation_type > ADDITIVE || !renderers[interpolation_type]) {
+			print_log("gendy~: Unimplemeted Interpolation Type", LOG_ERROR);
+			assert(0);
+			return;
 		}
-		//iter is now pointing at the 4th point of this set
+		done += renderers[interpolation_type](*this, dest + done,
+				bufsize - done, step);
+	}
+}
 
-		get_cspline_coefs(x,y,coefs);
+// the phase still counts output samples, the internal samples just step
+// through it in fractions. 1/oversampling is a power of two, so with
+// oversampling 1 this is the plain render, to the bit
+void gendy_waveform::render_oversampled(gendysamp_t *dest, unsigned int n) {
+	unsigned int length = n * oversampling;
+	render_block(oversampled, length, 1.0f / oversampling);
+	for(unsigned int i = oversampling_stages - 1; i > 0; --i) {
+		length /= 2;
+		decimators[i].process(oversampled, oversampled, length);
+	}
+	decimators[0].process(oversampled, dest, n);
+}
+
+// brings n samples down from stages halvings above the output rate, in
+// place. with no stages they're just copied
+static void decimate(halfband_decimator *cascade, unsigned int stages,
+		gendysamp_t *samples, gendysamp_t *dest, unsigned int n) {
+	if(stages == 0) {
+		memcpy(dest, samples, n * sizeof(gendysamp_t));
+		return;
+	}
+	unsigned int length = n << stages;
+	for(unsigned int i = stages - 1; i > 0; --i) {
+		length /= 2;
+		cascade[i].process(samples, samples, length);
+	}
+	cascade[0].process(samples, dest, n);
+}
+
+void gendy_waveform::render_fade(gendysamp_t *dest, unsigned int n) {
+	bool rising = fade_oversampling > oversampling;
+	unsigned int factor = rising ? fade_oversampling : oversampling;
+	unsigned int stride = rising ? fade_oversampling / oversampling :
+		oversampling / fade_oversampling;
+	render_block(oversampled, n * factor, 1.0f / factor);
+	// the lower of the two gets every stride-th sample, the phase steps
+	// being powers of two, just as if it had been rendered on its own
+	unsigned int lower_length = n * factor / stride;
+	for(unsigned int i = 0; i < lower_length; ++i)
+		fade_input[i] = oversampled[i * stride];
+	if(rising) {
+		decimate(decimators, oversampling_stages, fade_input, dest, n);
+		decimate(fade_decimators, fade_stages, oversampled, fade_output, n);
+	}
+	else {
+		decimate(decimators, oversampling_stages, oversampled, dest, n);
+		decimate(fade_decimators, fade_stages, fade_input, fade_output, n);
+	}
+	for(unsigned int i = 0; i < n; ++i) {
+		unsigned int position = fade_position + i;
+		if(position < fade_warmup)
+			continue;
+		float gain = (float)(position - fade_warmup + 1) / fade_length;
+		if(gain > 1)
+			gain = 1;
+		dest[i] += gain * (fade_output[i] - dest[i]);
+	}
+	fade_position += n;
+	if(fade_position >= fade_warmup + fade_length)
+		finish_fade();
+}
+
+template<class segment_t>
+unsigned int gendy_waveform::render_with(gendy_waveform &waveform,
+		gendysamp_t *dest, unsigned int bufsize, gendydur_t step) {
+	return waveform.render<segment_t>(dest, bufsize, step);
+}
+
+// renders up to bufsize samples, moving on through the cycles. returns
+// the number of samples rendered
+template<class segment_t>
+unsigned int gendy_waveform::render(gendysamp_t *dest, unsigned int bufsize,
+		gendydur_t step) {
+	segment_t segment;
+	// a local phase, so the compiler doesn't have to assume that writing
+	// to dest changes it
+	gendydur_t segment_phase = phase;
+	gendydur_t duration = segment.start(breakpoint_current);
 
-		unsigned int i = 0;
-		for(i = 0; i < bufsize && iter != breakpoint_list.end(); i++) {
-			dest[i] = cspline_interp(coefs,x_in);
-			++x_in;
-			//if we're past the end of the segment
-			if(x_in > x[2]) {
-				x_in -= x[2];
-				for(int j = 0; j < 3; ++j) {
-					x[j] = x[j+1] - x[2];
-					y[j] = y[j+1];
+	for(unsigned int i = 0; i < bufsize; i++) {
+		dest[i] = segment.value(segment_phase);
+		segment_phase += step;
+		// if we've reached the end of the current segment
+		if(segment_phase > duration) {
+			GENDY_STATS_COUNT(stats, segments);
+			++breakpoint_current;
+			segment_phase -= duration;
+			// if we've reached the end of this cycle. the last segment
+			// runs from the last breakpoint to the first post guard point,
+			// so we wrap when that becomes the current breakpoint
+			if(breakpoint_current == breakpoint_end) {
+				next_cycle();
+				breakpoint_current = breakpoint_begin;
+				// another interpolation type takes over from here
+				if(interpolation_type != segment_t::type) {
+					phase = segment_phase;
+					return i + 1;
 				}
-				x[3] = x[2] + iter->get_duration();
-				if(++iter != breakpoint_list.end()) {
-					y[3] = iter->get_amplitude();
-					get_cspline_coefs(x,y,coefs);
+			}
+			duration = segment.start(breakpoint_current);
+		}
+	}
+	phase = segment_phase;
+	return bufsize;
+}
+
+// Additive rendering
+//
+// The loop keeps track of the segments like the others, so the phase and
+// the current breakpoint are always where they'd be with linear
+// interpolation, and the other types and the fast-forward can take over
+// from it. The samples come from the partial bank, set up afresh at each
+// cycle.
+
+unsigned int gendy_waveform::render_additive_with(gendy_waveform &waveform,
+		gendysamp_t *dest, unsigned int bufsize, gendydur_t step) {
+	return waveform.render_additive(dest, bufsize, step);
+}
+
+unsigned int gendy_waveform::render_additive(gendysamp_t *dest,
+		unsigned int bufsize, gendydur_t step) {
+	if(partials_stale || step != partials.get_step()) {
+		double position = phase;
+		breakpoint_list_t::iterator i;
+		for(i = breakpoint_begin; i != breakpoint_current; ++i)
+			position += i->get_duration();
+		partials.set_cycle(breakpoint_begin, breakpoint_end, step);
+		partials.start(position);
+		partials_stale = false;
+	}
+	gendydur_t segment_phase = phase;
+	gendydur_t duration = breakpoint_current->get_duration();
+
+	for(unsigned int i = 0; i < bufsize; i++) {
+		dest[i] = partials.next();
+		segment_phase += step;
+		if(segment_phase > duration) {
+			GENDY_STATS_COUNT(stats, segments);
+			++breakpoint_current;
+			segment_phase -= duration;
+			if(breakpoint_current == breakpoint_end) {
+				next_cycle();
+				breakpoint_current = breakpoint_begin;
+				if(interpolation_type != ADDITIVE) {
+					phase = segment_phase;
+					return i + 1;
 				}
+				partials.set_cycle(breakpoint_begin, breakpoint_end, step);
+				partials.start(segment_phase);
+				partials_stale = false;
 			}
+			duration = breakpoint_current->get_duration();
+		}
+	}
+	phase = segment_phase;
+	return bufsize;
+}
+
+// Fast-forward
+//
+// These only do the bookkeeping of the render loops, moving the breakpoints
+// at each cycle boundary, so skipping a cycle costs about as much as
+// moving its breakpoints.
+
+void gendy_waveform::advance_cycles(unsigned long long n) {
+	if(n == 0)
+		return;
+	partials_stale = true;
+	if(cache_interval) {
+		if(cache_stale)
+			enter_cache();
+		while(n--)
+			end_cached_cycle();
+		cache_position = 0;
+		return;
+	}
+	while(n--)
+		next_cycle();
+	breakpoint_current = breakpoint_begin;
+	phase = 0;
+}
+
+// adds step (1 over a power of two) to phase, one sample at a time, until
+// it's past duration or max_steps samples are done, and returns the number
+// of samples. the result has to match the render loops' phase += step to
+// the bit. float rounding only happens where phase crosses a power of two,
+// or where step is finer than phase's resolution, so otherwise we can add
+// long runs of samples at once
+static unsigned long long step_phase(gendydur_t &phase, gendydur_t duration,
+		unsigned long long max_steps, unsigned int step_shift) {
+	const gendydur_t step = 1.0f / (1 << step_shift);
+	unsigned long long steps = 0;
+	while(steps < max_steps && phase <= duration) {
+		// most segments are short enough that the plain loop is quicker
+		if(phase < 1 || duration - phase < 32 * step) {
+			phase += step;
+			++steps;
+			continue;
+		}
+		uint32_t bits;
+		memcpy(&bits, &phase, sizeof(bits));
+		int exponent = (int)((bits >> 23) & 0xff) - 127;
+		if(exponent + (int)step_shift >= 24) {
+			phase += step;
+			++steps;
+			continue;
+		}
+		// phase + k * step is exact as long as it stays below the next
+		// power of two
+		double limit = (double)(1 << (exponent + 1));
+		unsigned long long k =
+			(unsigned long long)ceil((limit - phase) / step) - 1;
+		unsigned long long needed =
+			(unsigned long long)floor(((double)duration - phase) / step) + 1;
+		if(needed < k)
+			k = needed;
+		if(max_steps - steps < k)
+			k = max_steps - steps;
+		if(k == 0) {
+			// the step across the power of two, rounded like the render's
+			phase += step;
+			++steps;
+			continue;
+		}
+		phase = (gendydur_t)((double)phase + k * (double)step);
+		steps += k;
+	}
+	return steps;
+}
+
+// goes through the same spans as get_block(), making the scheduled changes
+// at their samples. with oversampling, the last block is rendered for real,
+// so the decimators are left holding the same history as after get_block()
+void gendy_waveform::advance_samples(unsigned long long n) {
+	partials_stale = true;
+	take_scheduled();
+	while(n) {
+		unsigned long long limit = n;
+		if(limit > halfband_decimator::block_size)
+			limit -= halfband_decimator::block_size;
+		unsigned int span = limit < max_advance_span ?
+			(unsigned int)limit : max_advance_span;
+		if(num_scheduled || num_ramps)
+			span = apply_scheduled(span);
+		// a new oversampling factor decides how the last block goes
+		apply_block_changes();
+		if(n <= halfband_decimator::block_size && oversampling > 1)
+			render_span(advanced, span);
+		else
+			advance_span(span);
+		n -= span;
+		sample_time += span;
+	}
+}
+
+// moves the walk on by n samples as render_span() would, without rendering
+// them. a fade between oversampling factors is cut short
+void gendy_waveform::advance_span(unsigned int n) {
+	apply_block_changes();
+	gain = target_gain;
+	level = target_level;
+	if(cache_interval) {
+		// the same additions as render_cached(), without the reads
+		if(cache_stale)
+			enter_cache();
+		while(n--) {
+			cache_position += cache_rate;
+			if(cache_position >= cache_period) {
+				double overshoot = (cache_position - cache_period) / cache_rate;
+				end_cached_cycle();
+				cache_position = overshoot * cache_rate;
+			}
+		}
+		return;
+	}
+	if(fade_oversampling)
+		finish_fade();
+	unsigned int step_shift = oversampling_stages;
+	unsigned long long steps = (unsigned long long)n << step_shift;
+	while(steps) {
+		gendydur_t duration = breakpoint_current->get_duration();
+		steps -= step_phase(phase, duration, steps, step_shift);
+		if(phase > duration) {
+			GENDY_STATS_COUNT(stats, segments);
+			++breakpoint_current;
+			phase -= duration;
+			if(breakpoint_current == breakpoint_end) {
+				next_cycle();
+				breakpoint_current = breakpoint_begin;
+			}
+		}
+	}
+}
+
+// renders one cycle of the current waveform from its start, the way
+// get_block() would play it, without moving anything. returns the number
+// of samples, at most bufsize
+unsigned int gendy_waveform::get_cycle(gendysamp_t *dest, unsigned int bufsize) const {
+	if(interpolation_type == LINEAR)
+		return render_cycle<linear_segment>(dest, bufsize, 1);
+	else if(interpolation_type == CUBIC)
+		return render_cycle<cubic_segment>(dest, bufsize, 1);
+	else if(interpolation_type == ADDITIVE)
+		return render_cycle_additive(dest, bufsize, 1);
+	print_log("gendy~: Unimplemeted Interpolation Type", LOG_ERROR);
+	return 0;
+}
+
+template<class segment_t>
+unsigned int gendy_waveform::render_cycle(gendysamp_t *dest,
+		unsigned int bufsize, gendydur_t step) const {
+	segment_t segment;
+	breakpoint_list_t::const_iterator current = breakpoint_begin;
+	gendydur_t cycle_phase = 0;
+	gendydur_t duration = segment.start(current);
+
+	for(unsigned int i = 0; i < bufsize; i++) {
+		dest[i] = segment.value(cycle_phase);
+		cycle_phase += step;
+		if(cycle_phase > duration) {
+			cycle_phase -= duration;
+			if(++current == breakpoint_end)
+				return i + 1;
+			duration = segment.start(current);
+		}
+	}
+	return bufsize;
+}
+
+// the linear render only counts the samples, which are then replaced
+unsigned int gendy_waveform::render_cycle_additive(gendysamp_t *dest,
+		unsigned int bufsize, gendydur_t step) const {
+	unsigned int length = render_cycle<linear_segment>(dest, bufsize, step);
+	partial_bank bank;
+	bank.set_cycle(breakpoint_begin, breakpoint_end, step);
+	bank.start(0);
+	for(unsigned int i = 0; i < length; ++i)
+		dest[i] = bank.next();
+	return length;
+}
+
+// Cycle cache
+//
+// The table holds one cycle as get_cycle() renders it, plus a copy of its
+// first sample at the end, so playing it is a linear interpolation between
+// neighbours with no wrapping inside the loop. The cycle generally doesn't
+// last a whole number of samples, so the read position carries the
+// fraction over into the next cycle the way the phase does.
+
+void gendy_waveform::render_cached(gendysamp_t *dest, unsigned int bufsize) {
+	if(cache_stale)
+		enter_cache();
+	double position = cache_position;
+	for(unsigned int i = 0; i < bufsize; i++) {
+		unsigned int k = (unsigned int)position;
+		gendysamp_t fraction = position - k;
+		dest[i] = cache_table[k] +
+			fraction * (cache_table[k + 1] - cache_table[k]);
+		position += cache_rate;
+		if(position >= cache_period) {
+			// the next table may be at another rate
+			double overshoot = (position - cache_period) / cache_rate;
+			end_cached_cycle();
+			position = overshoot * cache_rate;
+		}
+	}
+	cache_position = position;
+}
+
+// renders the current cycle into the table, at one table sample per output
+// sample unless that won't fit. the table loops, so the cycle has to lead
+// back into its own start: the post guard points become copies of the
+// first breakpoints, as in a held cycle. the next move then starts from
+// them too, so the following table picks up where this one leaves off
+void gendy_waveform::render_table() {
+	breakpoint_list_t::iterator j = breakpoint_begin;
+	for(breakpoint_list_t::iterator i = breakpoint_end;
+			i != breakpoint_list.end(); ++i)
+		*i = *(j++);
+	gendydur_t period = get_wavelength();
+	gendydur_t step = 1;
+	if(period + 2 > max_cached_length)
+		step = period / (max_cached_length - 2);
+	unsigned int length;
+	if(interpolation_type == LINEAR)
+		length = render_cycle<linear_segment>(cache_table, max_cached_length,
+				step);
+	else if(interpolation_type == ADDITIVE)
+		length = render_cycle_additive(cache_table, max_cached_length, step);
+	else
+		length = render_cycle<cubic_segment>(cache_table, max_cached_length,
+				step);
+	// the post guard points have changed
+	partials_stale = true;
+	cache_table[length] = cache_table[0];
+	cache_rate = 1 / step;
+	cache_period = period * cache_rate;
+	if(cache_period > length)
+		cache_period = length;
+	cycles_since_render = 0;
+	accumulated_change = 0;
+	cache_stale = false;
+}
+
+// decides at the end of each cached cycle whether the walk moves on and
+// whether the table has to follow. requested changes always go through
+void gendy_waveform::end_cached_cycle() {
+	++cycles_since_render;
+	bool changes = cycle_changes_pending();
+	if(frozen && !changes)
+		return;
+	if(cache_threshold > 0) {
+		next_cycle();
+		if(!changes && cycles_since_render < cache_interval &&
+				accumulated_change < cache_threshold)
+			return;
+	}
+	else {
+		if(!changes && cycles_since_render < cache_interval)
+			return;
+		next_cycle();
+	}
+	render_table();
+}
+
+// picks the cycle up from breakpoint_current and phase
+void gendy_waveform::enter_cache() {
+	render_table();
+	double elapsed = phase;
+	breakpoint_list_t::iterator i;
+	for(i = breakpoint_begin; i != breakpoint_current; ++i)
+		elapsed += i->get_duration();
+	cache_position = elapsed * cache_rate;
+	if(cache_position >= cache_period)
+		cache_position = 0;
+}
+
+// hands the cycle back to the render loops where the table has got to
+void gendy_waveform::leave_cache() {
+	unsigned int index = locate_cached(phase);
+	breakpoint_current = breakpoint_begin;
+	advance(breakpoint_current, index);
+	cache_stale = true;
+	partials_stale = true;
+}
+
+// the breakpoint, counted from breakpoint_begin, and phase within it that
+// the cache's read position corresponds to
+unsigned int gendy_waveform::locate_cached(gendydur_t &segment_phase) const {
+	double elapsed = cache_position / cache_rate;
+	unsigned int index = 0;
+	breakpoint_list_t::const_iterator i = breakpoint_begin;
+	breakpoint_list_t::const_iterator last = breakpoint_end;
+	--last;
+	while(i != last && elapsed > i->get_duration()) {
+		elapsed -= i->get_duration();
+		++i;
+		++index;
+	}
+	segment_phase = elapsed;
+	return index;
+}
+
+// whether anything is waiting that next_cycle() would apply
+bool gendy_waveform::cycle_changes_pending() const {
+	return pending_breakpoints != 0 || pending_interpolation != -1 ||
+		pending_center || interpolation_stale;
+}
+
+#if GENDY_STATS
+const gendy_stats &gendy_waveform::get_stats() const {
+	return stats;
+}
+
+void gendy_waveform::reset_stats() {
+	stats.reset();
+}
+#endif
+
+// rekeys the random walk and starts it over from the reset shape, so
+// waveforms given the same seed and parameters sound the same
+void gendy_waveform::set_seed(unsigned long long seed, unsigned long long voice) {
+	rng.seed(seed, voice);
+	cycle_count = 0;
+	reset_breakpoints();
+	move_breakpoints();
+	breakpoint_current = breakpoint_begin;
+	phase = 0;
+	cache_stale = true;
+	partials_stale = true;
+}
+
+// starts a new cycle with any requested changes applied, those scheduled
+// for now included, e.g. for a new note. the breakpoints stay where the
+// walk has taken them rather than going back to the centers, with their
+// durations scaled to a new wavelength so it starts there straight away
+void gendy_waveform::restart() {
+	take_scheduled();
+	apply_scheduled(0);
+	float old_wavelength = average_wavelength;
+	commit_changes();
+	if(average_wavelength != old_wavelength) {
+		gendydur_t scale = average_wavelength / old_wavelength;
+		breakpoint_list_t::iterator i;
+		for(i = breakpoint_list.begin(); i != breakpoint_list.end(); ++i)
+			i->set_duration(i->get_duration() * scale);
+	}
+	breakpoint_current = breakpoint_begin;
+	phase = 0;
+	cache_stale = true;
+	partials_stale = true;
+	if(adaptive_oversampling)
+		shortest_segment = find_shortest_segment();
+}
+
+// picks a fresh seed, the same way a new waveform gets one
+void gendy_waveform::reseed() {
+	rng.seed(next_seed++);
+}
+
+bool gendy_waveform::schedule(unsigned long long time, scheduled_param_t param,
+		float value, unsigned int ramp) {
+	if((unsigned int)param >= num_scheduled_params)
+		return false;
+	scheduled_change change;
+	change.time = time;
+	change.ramp = ramp;
+	change.param = param;
+	change.value = value;
+	// while one is waiting in the overflow slot, the ones after it have to
+	// follow it there, or they'd overtake it through the ring
+	overflow_change &slot = overflow[param];
+	if(slot.sequence == slot.taken && incoming.push(change))
+		return true;
+	++slot.sequence;
+	slot.time = time;
+	slot.ramp = ramp;
+	slot.value = value;
+	++slot.sequence;
+	return true;
+}
+
+unsigned long long gendy_waveform::get_sample_time() const {
+	return sample_time;
+}
+
+void gendy_waveform::skip_samples(unsigned int n) {
+	take_scheduled();
+	unsigned int done = 0;
+	while(done < n) {
+		unsigned int span = n - done;
+		if(num_scheduled || num_ramps)
+			span = apply_scheduled(span);
+		done += span;
+		sample_time += span;
+	}
+}
+
+// moves the changes that have come in into the schedule, in time order
+void gendy_waveform::take_scheduled() {
+	scheduled_change change;
+	while(num_scheduled < max_scheduled && incoming.pop(change))
+		insert_scheduled(change);
+	for(unsigned int p = 0; p < num_scheduled_params; ++p) {
+		if(overflow[p].sequence != overflow[p].taken)
+			take_overflow((scheduled_param_t)p);
+	}
+}
+
+// takes the change waiting in param's overflow slot, once the ones that
+// went into the ring before it are all in. with the schedule full, it
+// takes the place of param's newest change, which it came after anyway
+void gendy_waveform::take_overflow(scheduled_param_t param) {
+	overflow_change &slot = overflow[param];
+	unsigned int sequence = slot.sequence;
+	if(sequence & 1 || incoming.available())
+		return;
+	scheduled_change change;
+	change.time = slot.time;
+	change.ramp = slot.ramp;
+	change.param = param;
+	change.value = slot.value;
+	// written to meanwhile, so it's taken next time
+	if(slot.sequence != sequence)
+		return;
+	if(num_scheduled == max_scheduled) {
+		unsigned int n = num_scheduled;
+		while(n > 0 && scheduled[n - 1].param != param)
+			--n;
+		if(!n)
+			return;
+		if(change.time < scheduled[n - 1].time)
+			change.time = scheduled[n - 1].time;
+		for(--num_scheduled; n <= num_scheduled; ++n)
+			scheduled[n - 1] = scheduled[n];
+	}
+	insert_scheduled(change);
+	slot.taken = sequence;
+}
+
+// changes for the same time stay in the order they were made
+void gendy_waveform::insert_scheduled(const scheduled_change &change) {
+	unsigned int n = num_scheduled++;
+	while(n > 0 && scheduled[n - 1].time > change.time) {
+		scheduled[n] = scheduled[n - 1];
+		--n;
+	}
+	scheduled[n] = change;
+}
+
+// makes the changes that are due and moves the ramps on, and returns how
+// many samples can be rendered before anything else needs doing. the gain
+// and level are set to where their ramps will be at the end of the span,
+// as the output stage ramps them across it, the rest to where their last
+// step took them
+unsigned int gendy_waveform::apply_scheduled(unsigned int max_samples) {
+	unsigned int due = 0;
+	while(due < num_scheduled && scheduled[due].time <= sample_time) {
+		const scheduled_change &change = scheduled[due++];
+		parameter_ramp &ramp = ramps[change.param];
+		if(ramp.length)
+			--num_ramps;
+		ramp.length = change.ramp;
+		if(ramp.length) {
+			ramp.start = sample_time;
+			ramp.from = get_scheduled_param(change.param);
+			ramp.to = change.value;
+			++num_ramps;
+		}
+		else
+			set_scheduled_param(change.param, change.value);
+	}
+	if(due) {
+		num_scheduled -= due;
+		for(unsigned int i = 0; i < num_scheduled; ++i)
+			scheduled[i] = scheduled[i + due];
+	}
+
+	unsigned int n = max_samples;
+	if(num_scheduled && scheduled[0].time - sample_time < n)
+		n = scheduled[0].time - sample_time;
+	// the ramps move on every ramp_interval samples from where they started
+	// and end right where they end, however the blocks fall, so they go
+	// through the same values whatever the block size
+	for(unsigned int p = 0; num_ramps && p < num_scheduled_params; ++p) {
+		const parameter_ramp &ramp = ramps[p];
+		if(!ramp.length)
+			continue;
+		unsigned long long position = sample_time - ramp.start;
+		unsigned long long left = ramp_interval - position % ramp_interval;
+		if(position < ramp.length && ramp.length - position < left)
+			left = ramp.length - position;
+		if(left < n)
+			n = left;
+	}
+	for(unsigned int p = 0; num_ramps && p < num_scheduled_params; ++p) {
+		parameter_ramp &ramp = ramps[p];
+		if(!ramp.length)
+			continue;
+		unsigned long long position = sample_time - ramp.start;
+		if(p == SCHEDULE_GAIN || p == SCHEDULE_LEVEL)
+			position += n;
+		else
+			position -= position % ramp_interval;
+		if(position >= ramp.length) {
+			set_scheduled_param((scheduled_param_t)p, ramp.to);
+			ramp.length = 0;
+			--num_ramps;
 		}
-		return i;
+		else
+			set_scheduled_param((scheduled_param_t)p, ramp.from +
+					(ramp.to - ramp.from) * position / ramp.length);
+	}
+	return n;
+}
+
+float gendy_waveform::get_scheduled_param(scheduled_param_t param) const {
+	switch(param) {
+		case SCHEDULE_FREQUENCY:
+			return 1 / get_avg_wavelength();
+		case SCHEDULE_STEP_WIDTH:
+			return step_width;
+		case SCHEDULE_STEP_HEIGHT:
+			return step_height;
+		case SCHEDULE_DURATION_PULL:
+			return duration_pull;
+		case SCHEDULE_AMPLITUDE_PULL:
+			return amplitude_pull;
+		case SCHEDULE_GAIN:
+			return target_gain;
+		case SCHEDULE_LEVEL:
+			return target_level;
+	}
+	return 0;
+}
+
+void gendy_waveform::set_scheduled_param(scheduled_param_t param,
+		float value) {
+	switch(param) {
+		case SCHEDULE_FREQUENCY:
+			if(value > 0)
+				set_avg_wavelength(1 / value);
+			break;
+		case SCHEDULE_STEP_WIDTH:
+			set_step_width(value);
+			break;
+		case SCHEDULE_STEP_HEIGHT:
+			set_step_height(value);
+			break;
+		case SCHEDULE_DURATION_PULL:
+			set_duration_pull(value);
+			break;
+		case SCHEDULE_AMPLITUDE_PULL:
+			set_amplitude_pull(value);
+			break;
+		case SCHEDULE_GAIN:
+			set_gain(value);
+			break;
+		case SCHEDULE_LEVEL:
+			set_level(value);
+			break;
 	}
 }
+
+unsigned long long gendy_waveform::get_cycle_count() const {
+	return cycle_count;
+}
+
+breakpoint_list_t::const_iterator gendy_waveform::cycle_begin() const {
+	return breakpoint_begin;
+}
+
+breakpoint_list_t::const_iterator gendy_waveform::cycle_end() const {
+	return breakpoint_end;
+}
+
+bool gendy_waveform::add_cycle_listener(cycle_listener *listener) {
+	if(num_listeners == max_listeners)
+		return false;
+	listeners[num_listeners++] = listener;
+	return true;
+}
+
+void gendy_waveform::remove_cycle_listener(cycle_listener *listener) {
+	for(unsigned int n = 0; n < num_listeners; ++n) {
+		if(listeners[n] == listener) {
+			listeners[n] = listeners[--num_listeners];
+			return;
+		}
+	}
+}
+
+void gendy_waveform::set_breakpoint_source(breakpoint_source *new_source) {
+	source = new_source;
+}
+
+breakpoint_source *gendy_waveform::get_breakpoint_source() const {
+	return source;
+}
+
+void gendy_waveform::set_output_sink(output_sink *new_sink) {
+	sink = new_sink;
+}
+
+output_sink *gendy_waveform::get_output_sink() const {
+	return sink;
+}
+
+// whether changes are still waiting for the next cycle boundary. a snapshot
+// taken now wouldn't include them
+bool gendy_waveform::has_pending_changes() const {
+	return pending_breakpoints != 0 || pending_interpolation != -1 ||
+		pending_center || pending_oversampling != 0 || pending_quality != -1 ||
+		pending_adaptive != -1 || pending_cache_interval != -1 ||
+		pending_cache_threshold != -1 || pending_dc_cutoff != -1;
+}
+
+// State snapshots
+//
+// A snapshot is a gendy_state_header followed by one gendy_state_point per
+// node of the breakpoint list, guard points included, in list order.
+// Everything is in native byte order with IEEE 754 floats, so snapshots can
+// be moved between machines of the same endianness. Readers reject any
+// version newer than their own. Fields are only ever added at the end of the
+// header, so an older, shorter header is read as far as it goes and the
+// missing fields are left 0.
+//
+// version 2 added the step distributions. version 3 replaced the
+// xorshift generator with the counter based one: rng_state is now its key,
+// and the cycle count and generator position follow. older snapshots load
+// with their generator state taken as the key, at cycle 0. version 4 added
+// the output stage, which older snapshots load with at unity gain and off.
+// version 5 added the cycle cache and freeze mode, followed by the table
+// after the decimator history when it's up to date. older snapshots leave
+// them as they are, with the table rendered afresh.
+
+static const char state_magic[4] = { 'G', 'D', 'Y', 'S' };
+static const uint16_t state_version = 5;
+
+struct gendy_state_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t header_size;
+	// breakpoints plus guard points
+	uint32_t num_points;
+	uint32_t pre_guardpoints;
+	uint32_t num_breakpoints;
+	// position of breakpoint_current in the list
+	uint32_t current;
+	uint8_t interpolation;
+	uint8_t waveshape;
+	uint8_t constrain_endpoints;
+	// 0 in snapshots from before there was oversampling, meaning 1
+	uint8_t oversampling;
+	float phase;
+	float average_wavelength;
+	float step_width;
+	float step_height;
+	float duration_pull;
+	float amplitude_pull;
+	uint64_t rng_state;
+	uint8_t duration_distribution;
+	uint8_t amplitude_distribution;
+	uint8_t reserved2[6];
+	uint64_t cycle_count;
+	uint64_t rng_stream;
+	uint64_t rng_counter;
+	float gain;
+	float dc_cutoff;
+	float dc_input;
+	float dc_output;
+	uint8_t soft_clip;
+	uint8_t reserved4[7];
+	uint32_t cache_interval;
+	float cache_threshold;
+	uint32_t cycles_since_render;
+	float accumulated_change;
+	double cache_position;
+	double cache_period;
+	double cache_rate;
+	// samples of table that follow, 0 if it has to be rendered afresh
+	uint32_t cache_length;
+	uint8_t frozen;
+	uint8_t reserved5[3];
+};
+
+struct gendy_state_point {
+	float duration;
+	float amplitude;
+	float center_dur;
+	float center_amp;
+};
+
+// when oversampling, the points are followed by the history of each of the
+// decimators in use, as floats, so a restored waveform carries on exactly
+static size_t decimator_history_size(const halfband_decimator *decimators,
+		unsigned int stages) {
+	size_t size = 0;
+	for(unsigned int i = 0; i < stages; ++i)
+		size += decimators[i].history_size() * sizeof(float);
+	return size;
+}
+
+// the samples of the cycle cache's table the read position can reach, or
+// 0 if it has to be rendered before it's played again
+unsigned int gendy_waveform::cache_table_length() const {
+	if(!cache_interval || cache_stale)
+		return 0;
+	unsigned int length = (unsigned int)cache_period + 2;
+	if(length > max_cached_length + 1)
+		length = max_cached_length + 1;
+	return length;
+}
+
+// number of bytes save_state() needs for the waveform as it is now
+size_t gendy_waveform::state_size() const {
+	return sizeof(gendy_state_header) +
+		breakpoint_list.size() * sizeof(gendy_state_point) +
+		decimator_history_size(decimators, oversampling_stages) +
+		cache_table_length() * sizeof(float);
+}
+
+// the most bytes a snapshot of a waveform with up to max_breakpoints
+// breakpoints can take
+size_t gendy_waveform::max_state_size(unsigned int max_breakpoints) {
+	size_t history = 0;
+	for(unsigned int i = 0; i < max_oversampling_stages; ++i)
+		history += (3 * (decimator_taps[i] + 1) / 4 - 2) * sizeof(float);
+	return sizeof(gendy_state_header) +
+		(max_breakpoints + max_guardpoints) * sizeof(gendy_state_point) +
+		history + (max_cached_length + 1) * sizeof(float);
+}
+
+// writes a snapshot to dest. returns the number of bytes written, or 0 if
+// size is too small
+size_t gendy_waveform::save_state(void *dest, size_t size) const {
+	if(size < state_size())
+		return 0;
+
+	gendy_state_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, state_magic, sizeof(header.magic));
+	header.version = state_version;
+	header.header_size = sizeof(header);
+	header.num_points = breakpoint_list.size();
+	header.pre_guardpoints =
+		distance(breakpoint_list.begin(), breakpoint_list_t::const_iterator(breakpoint_begin));
+	header.num_breakpoints = get_num_breakpoints();
+	header.current =
+		distance(breakpoint_list.begin(), breakpoint_list_t::const_iterator(breakpoint_current));
+	header.phase = phase;
+	if(cache_interval && !cache_stale)
+		header.current = header.pre_guardpoints + locate_cached(header.phase);
+	header.interpolation = interpolation_type;
+	header.waveshape = waveshape;
+	header.constrain_endpoints = constrain_endpoints;
+	header.oversampling = oversampling;
+	header.average_wavelength = average_wavelength;
+	header.step_width = step_width;
+	header.step_height = step_height;
+	header.duration_pull = duration_pull;
+	header.amplitude_pull = amplitude_pull;
+	header.rng_state = rng.get_key();
+	header.duration_distribution = duration_distribution;
+	header.amplitude_distribution = amplitude_distribution;
+	header.cycle_count = cycle_count;
+	header.rng_stream = rng.get_stream();
+	header.rng_counter = rng.get_counter();
+	header.gain = gain;
+	header.dc_cutoff = dc_cutoff;
+	header.dc_input = dc_input;
+	header.dc_output = dc_output;
+	header.soft_clip = soft_clip;
+	header.cache_interval = cache_interval;
+	header.cache_threshold = cache_threshold;
+	header.cycles_since_render = cycles_since_render;
+	header.accumulated_change = accumulated_change;
+	header.cache_position = cache_position;
+	header.cache_period = cache_period;
+	header.cache_rate = cache_rate;
+	header.cache_length = cache_table_length();
+	header.frozen = frozen;
+
+	char *out = static_cast<char *>(dest);
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	breakpoint_list_t::const_iterator i;
+	for(i = breakpoint_list.begin(); i != breakpoint_list.end(); ++i) {
+		gendy_state_point point;
+		point.duration = i->get_duration();
+		point.amplitude = i->get_amplitude();
+		point.center_dur = i->get_center_duration();
+		point.center_amp = i->get_center_amplitude();
+		memcpy(out, &point, sizeof(point));
+		out += sizeof(point);
+	}
+	for(unsigned int stage = 0; stage < oversampling_stages; ++stage) {
+		float history[3 * (halfband_decimator::max_taps + 1) / 4];
+		decimators[stage].get_history(history);
+		size_t history_size = decimators[stage].history_size() * sizeof(float);
+		memcpy(out, history, history_size);
+		out += history_size;
+	}
+	memcpy(out, cache_table, header.cache_length * sizeof(float));
+	return state_size();
+}
+
+// restores a snapshot written by save_state(). returns false and leaves the
+// waveform alone if the snapshot is malformed or doesn't fit. when the
+// snapshot has as many points as the waveform already has, nothing is
+// allocated or freed
+bool gendy_waveform::load_state(const void *src, size_t size) {
+	// the version 1 header ends at rng_state
+	static const size_t min_header_size =
+		offsetof(gendy_state_header, rng_state) + sizeof(uint64_t);
+	gendy_state_header header;
+	memset(&header, 0, sizeof(header));
+	if(size < min_header_size)
+		return false;
+	memcpy(&header, src, min_header_size);
+	if(memcmp(header.magic, state_magic, sizeof(header.magic)) != 0 ||
+			header.version == 0 || header.version > state_version ||
+			header.header_size < min_header_size ||
+			header.header_size > sizeof(header) ||
+			size < header.header_size) {
+		print_log("gendy~: unrecognized state snapshot", LOG_ERROR);
+		return false;
+	}
+	memcpy(&header, src, header.header_size);
+
+	if(header.oversampling == 0)
+		header.oversampling = 1;
+	unsigned int stages = 0;
+	while((1u << stages) < header.oversampling)
+		++stages;
+	unsigned int post_guardpoints;
+	if((header.interpolation == LINEAR || header.interpolation == ADDITIVE) &&
+			header.pre_guardpoints == 0)
+		post_guardpoints = 1;
+	else if(header.interpolation == CUBIC && header.pre_guardpoints == 1)
+		post_guardpoints = 2;
+	else {
+		print_log("gendy~: state snapshot has invalid guard points", LOG_ERROR);
+		return false;
+	}
+	if(header.num_breakpoints == 0 ||
+			header.num_points != header.pre_guardpoints +
+				header.num_breakpoints + post_guardpoints ||
+			header.current < header.pre_guardpoints ||
+			header.current >= header.pre_guardpoints + header.num_breakpoints ||
+			header.waveshape > SAWTOOTH ||
+			header.duration_distribution > HYPERBOLIC_COSINE ||
+			header.amplitude_distribution > HYPERBOLIC_COSINE ||
+			header.oversampling != (1u << stages) ||
+			header.oversampling > max_oversampling ||
+			header.cache_length > max_cached_length + 1 ||
+			(header.cache_length && (!header.cache_interval ||
+				header.cache_rate <= 0 || header.cache_period <= 0 ||
+				header.cache_period >= header.cache_length ||
+				header.cache_position < 0 ||
+				header.cache_position >= header.cache_period)) ||
+			size < header.header_size +
+				header.num_points * sizeof(gendy_state_point) +
+				decimator_history_size(decimators, stages) +
+				header.cache_length * sizeof(float)) {
+		print_log("gendy~: state snapshot is corrupt", LOG_ERROR);
+		return false;
+	}
+	if(max_breakpoints && header.num_breakpoints > max_breakpoints) {
+		print_log("gendy~: state snapshot has too many breakpoints (%d)",
+				(int)header.num_breakpoints, LOG_ERROR);
+		return false;
+	}
+
+	if(!resize_list(header.num_points))
+		return false;
+	const char *in = static_cast<const char *>(src) + header.header_size;
+	breakpoint_list_t::iterator i;
+	for(i = breakpoint_list.begin(); i != breakpoint_list.end(); ++i) {
+		gendy_state_point point;
+		memcpy(&point, in, sizeof(point));
+		in += sizeof(point);
+		i->set_position(point.duration, point.amplitude);
+		i->set_center(point.center_dur, point.center_amp);
+	}
+	set_iterators(header.pre_guardpoints, header.num_breakpoints,
+			header.current);
+	apply_oversampling(header.oversampling);
+	// adaptively, the snapshot only has the factor that was in use
+	if(!adaptive_oversampling || header.oversampling > requested_oversampling)
+		requested_oversampling = header.oversampling;
+	for(unsigned int stage = 0; stage < stages; ++stage) {
+		float history[3 * (halfband_decimator::max_taps + 1) / 4];
+		size_t history_size = decimators[stage].history_size() * sizeof(float);
+		memcpy(history, in, history_size);
+		in += history_size;
+		decimators[stage].set_history(history);
+	}
+	memcpy(cache_table, in, header.cache_length * sizeof(float));
+
+	interpolation_type = (interpolation_t)header.interpolation;
+	requested_interpolation = interpolation_type;
+	// a snapshot is of the waveform as set, at full quality
+	quality_level = 0;
+	interpolation_stale = false;
+	move_interval = 1;
+	cycles_since_move = 0;
+	waveshape = (waveshape_t)header.waveshape;
+	constrain_endpoints = header.constrain_endpoints;
+	phase = header.phase;
+	average_wavelength = header.average_wavelength;
+	step_width = header.step_width;
+	step_height = header.step_height;
+	duration_pull = header.duration_pull;
+	amplitude_pull = header.amplitude_pull;
+	rng.set_key(header.rng_state);
+	rng.set_position(header.rng_stream, header.rng_counter);
+	cycle_count = header.cycle_count;
+	duration_distribution = (distribution_t)header.duration_distribution;
+	amplitude_distribution = (distribution_t)header.amplitude_distribution;
+	if(header.version < 4)
+		header.gain = 1;
+	gain = header.gain;
+	target_gain = gain;
+	apply_dc_cutoff(header.dc_cutoff);
+	if(dc_cutoff) {
+		dc_input = header.dc_input;
+		dc_output = header.dc_output;
+	}
+	soft_clip = header.soft_clip;
+	if(header.version >= 5) {
+		cache_interval = header.cache_interval;
+		cache_threshold = header.cache_threshold;
+		cycles_since_render = header.cycles_since_render;
+		accumulated_change = header.accumulated_change;
+		frozen = header.frozen;
+	}
+	clear_pending_changes();
+	cache_stale = header.cache_length == 0;
+	if(!cache_stale) {
+		cache_position = header.cache_position;
+		cache_period = header.cache_period;
+		cache_rate = header.cache_rate;
+	}
+	partials_stale = true;
+	if(adaptive_oversampling)
+		shortest_segment = find_shortest_segment();
+	return true;
+}
+
+// makes this waveform an exact copy of other, random generator included,
+// so both continue identically until one of them is reseeded. returns false
+// if other has more breakpoints than we have room for
+bool gendy_waveform::copy_state(const gendy_waveform &other) {
+	if(&other == this)
+		return true;
+	unsigned int num_breakpoints = other.get_num_breakpoints();
+	if(max_breakpoints && num_breakpoints > max_breakpoints)
+		return false;
+	if(!resize_list(other.breakpoint_list.size()))
+		return false;
+	copy(other.breakpoint_list.begin(), other.breakpoint_list.end(),
+			breakpoint_list.begin());
+	breakpoint_list_t::const_iterator other_begin = other.breakpoint_begin;
+	breakpoint_list_t::const_iterator other_current = other.breakpoint_current;
+	set_iterators(distance(other.breakpoint_list.begin(), other_begin),
+			num_breakpoints,
+			distance(other.breakpoint_list.begin(), other_current));
+
+	interpolation_type = other.interpolation_type;
+	waveshape = other.waveshape;
+	constrain_endpoints = other.constrain_endpoints;
+	phase = other.phase;
+	average_wavelength = other.average_wavelength;
+	step_width = other.step_width;
+	step_height = other.step_height;
+	duration_pull = other.duration_pull;
+	amplitude_pull = other.amplitude_pull;
+	rng = other.rng;
+	cycle_count = other.cycle_count;
+	duration_distribution = other.duration_distribution;
+	amplitude_distribution = other.amplitude_distribution;
+	oversampling = other.oversampling;
+	oversampling_stages = other.oversampling_stages;
+	requested_interpolation = other.requested_interpolation;
+	requested_oversampling = other.requested_oversampling;
+	quality_level = other.quality_level;
+	interpolation_stale = other.interpolation_stale;
+	move_interval = other.move_interval;
+	cycles_since_move = other.cycles_since_move;
+	for(unsigned int stage = 0; stage < max_oversampling_stages; ++stage) {
+		decimators[stage] = other.decimators[stage];
+		fade_decimators[stage] = other.fade_decimators[stage];
+	}
+	adaptive_oversampling = other.adaptive_oversampling;
+	shortest_segment = other.shortest_segment;
+	partials = other.partials;
+	partials_stale = other.partials_stale;
+	fade_oversampling = other.fade_oversampling;
+	fade_stages = other.fade_stages;
+	fade_position = other.fade_position;
+	cache_interval = other.cache_interval;
+	cache_threshold = other.cache_threshold;
+	frozen = other.is_frozen();
+	cache_stale = other.cache_stale;
+	cache_position = other.cache_position;
+	cache_period = other.cache_period;
+	cache_rate = other.cache_rate;
+	cycles_since_render = other.cycles_since_render;
+	accumulated_change = other.accumulated_change;
+	gain = other.gain;
+	target_gain = other.get_gain();
+	dc_cutoff = other.dc_cutoff;
+	dc_coefficient = other.dc_coefficient;
+	dc_input = other.dc_input;
+	dc_output = other.dc_output;
+	soft_clip = other.is_soft_clipping();
+	if(cache_interval && !cache_stale)
+		memcpy(cache_table, other.cache_table, sizeof(cache_table));
+	clear_pending_changes();
+	// so both pick up a wavelength other has been given at the same cycle
+	float other_wavelength = other.pending_wavelength;
+	if(other_wavelength > 0)
+		set_avg_wavelength(other_wavelength);
+	return true;
+}
+
+// grows or shrinks the breakpoint list to size nodes. the contents and
+// iterators have to be set up again afterwards
+bool gendy_waveform::resize_list(unsigned int size) {
+	if(pool.get_capacity() &&
+			size > breakpoint_list.size() + pool.get_available())
+		return false;
+	while(breakpoint_list.size() < size)
+		breakpoint_list.push_back(breakpoint());
+	while(breakpoint_list.size() > size)
+		breakpoint_list.pop_back();
+	return true;
+}
+
+// points breakpoint_begin, breakpoint_end and breakpoint_current at the
+// given positions in the list
+void gendy_waveform::set_iterators(unsigned int pre_guardpoints,
+		unsigned int num_breakpoints, unsigned int current) {
+	breakpoint_begin = breakpoint_list.begin();
+	advance(breakpoint_begin, pre_guardpoints);
+	breakpoint_end = breakpoint_begin;
+	advance(breakpoint_end, num_breakpoints);
+	breakpoint_current = breakpoint_list.begin();
+	advance(breakpoint_current, current);
+}
@@ -32,22 +32,114 @@
 
 #include "types.h"
 #include "breakpoint.h"
+#include "util.h"
+#include "stats.h"
+#include "pool.h"
+#include "halfband.h"
+#include "additive.h"
+#include "spsc_ring.h"
 #include <list>
+#include <atomic>
+#include <cstddef>
+
+class gendy_waveform;
+
+// gets told about every new cycle, right after the breakpoints have moved.
+// it's called on the rendering thread, so it mustn't block or allocate
+class cycle_listener
+{
+	public:
+	virtual ~cycle_listener() {}
+	virtual void cycle_moved(gendy_waveform &waveform) = 0;
+};
+
+// gets every block get_block() renders once it's complete. called on the
+// rendering thread, like cycle_listener
+class output_sink
+{
+	public:
+	virtual ~output_sink() {}
+	virtual void write_block(const gendysamp_t *block, unsigned int n) = 0;
+};
+
+// supplies breakpoints in place of the random walk, e.g. to replay a
+// recorded trace. the breakpoints of successive cycles form one stream, and
+// the waveform looks a few breakpoints ahead into the next cycle for its
+// guard points. called on the rendering thread, like cycle_listener
+class breakpoint_source
+{
+	public:
+	virtual ~breakpoint_source() {}
+	// moves on to the next cycle. sets length to its number of breakpoints
+	// and makes sure that many plus lookahead more can be read with
+	// get_point(). returns false if they aren't available (yet)
+	virtual bool next_cycle(unsigned int lookahead, unsigned int &length) = 0;
+	// breakpoint index of the current cycle, counting on into the next
+	virtual void get_point(unsigned int index, gendydur_t &duration,
+			gendyamp_t &amplitude) const = 0;
+	// true once the source has run out for good
+	virtual bool finished() const = 0;
+};
+
+// parameters that can be changed at a given sample, see schedule(). the
+// frequency is in cycles per sample
+enum scheduled_param_t { SCHEDULE_FREQUENCY, SCHEDULE_STEP_WIDTH,
+	SCHEDULE_STEP_HEIGHT, SCHEDULE_DURATION_PULL, SCHEDULE_AMPLITUDE_PULL,
+	SCHEDULE_GAIN, SCHEDULE_LEVEL };
+
+// the settings a waveform starts out with. building one from its final
+// settings lays the breakpoint list out in one go, instead of resizing and
+// recentering it through the setters afterwards
+struct gendy_config
+{
+	unsigned int num_breakpoints;
+	// average, in samples
+	float wavelength;
+	interpolation_t interpolation;
+	waveshape_t waveshape;
+	float step_width;
+	float step_height;
+	float duration_pull;
+	float amplitude_pull;
+	distribution_t duration_distribution;
+	distribution_t amplitude_distribution;
+	// 1, 2, 4 or 8, and whether that's only the most the waveform uses
+	unsigned int oversampling;
+	bool adaptive_oversampling;
+	// the output stage, see set_gain() and set_level()
+	float gain;
+	float level;
+	float dc_cutoff;
+	bool soft_clip;
+	// keys the random walk as set_seed() does, if seeded is set. otherwise
+	// the waveform gets the next seed, like any other
+	bool seeded;
+	unsigned long long seed;
+	unsigned long long voice;
+
+	// the defaults: 8 breakpoints, cubic, 300 Hz at 44.1 kHz
+	gendy_config();
+};
 
 class gendy_waveform
 {
+	// storage for the breakpoint list nodes. declared before the list so
+	// it's constructed first and destroyed last
+	breakpoint_pool pool;
+	// most breakpoints the pool has room for, or 0 for no limit
+	unsigned int max_breakpoints;
 	// keep track of where we are in the current segment(in samples)
 	gendydur_t phase;
 	// average wavelength in samples. 	
 	float average_wavelength;
 	// list of breakpoints plus guard points(for continuity)
-	std::list<breakpoint> breakpoint_list;
+	breakpoint_list_t breakpoint_list;
 	// the first breakpoint after the guard points
-	std::list<breakpoint>::iterator breakpoint_begin;
+	breakpoint_list_t::iterator breakpoint_begin;
 	// the first guard point after the breakpoints
-	std::list<breakpoint>::iterator breakpoint_end;
+	breakpoint_list_t::iterator breakpoint_end;
 	// the current breakpoint that the next request block will start with
-	std::list<breakpoint>::iterator breakpoint_current;;
+	breakpoint_list_t::iterator breakpoint_current;;
 	// set the type of interpolation(see defines at top)
 	interpolation_t interpolation_type;
 	// the waveshape that the breakpoints will gravitate to
@@ -62,22 +154,252 @@ class gendy_waveform
 	// the waveshape. ranges from 0 to 1
 	float duration_pull;
 	float amplitude_pull;
+	// the distributions the duration and amplitude steps are drawn from
+	distribution_t duration_distribution;
+	distribution_t amplitude_distribution;
+	// changes requested by the setters, applied at the next cycle boundary.
+	// 0 or -1 for nothing pending
+	std::atomic<int> pending_breakpoints;
+	std::atomic<int> pending_interpolation;
+	std::atomic<float> pending_wavelength;
+	std::atomic<bool> pending_center;
+	// source of the random walk. per instance so it can be saved and restored
+	gendy_rng rng;
+	// number of times the breakpoints have moved. it picks the random
+	// stream for the next move
+	unsigned long long cycle_count;
+	// told about each new cycle
+	static const unsigned int max_listeners = 4;
+	cycle_listener *listeners[max_listeners];
+	unsigned int num_listeners;
+	// replaces the random walk while it's set
+	breakpoint_source *source;
+	// gets a copy of the output while it's set
+	output_sink *sink;
+	// internal rate as a multiple of the output rate, 1 for none. the
+	// audio is rendered at that rate and brought down to the output rate by
+	// a cascade of decimators, decimators[0] being the one to the output
+	static const unsigned int max_oversampling = 8;
+	static const unsigned int max_oversampling_stages = 3;
+	unsigned int oversampling;
+	unsigned int oversampling_stages;
+	std::atomic<int> pending_oversampling;
+	// what was asked for, before the quality level takes its share
+	interpolation_t requested_interpolation;
+	unsigned int requested_oversampling;
+	// reduced quality under load, see set_quality_level(). changes are
+	// picked up at the start of the next block
+	unsigned int quality_level;
+	std::atomic<int> pending_quality;
+	// the interpolation has to follow a new quality level at the next cycle
+	bool interpolation_stale;
+	// the breakpoints move every move_interval cycles and hold in between
+	unsigned int move_interval;
+	unsigned int cycles_since_move;
+	halfband_decimator decimators[max_oversampling_stages];
+	gendysamp_t oversampled[max_oversampling * halfband_decimator::block_size];
+	// where advance_samples() renders the block it renders for real
+	gendysamp_t advanced[halfband_decimator::block_size];
+	// adaptive oversampling, see set_adaptive_oversampling(). a change of
+	// factor renders at the higher of the old and the new rate for a few
+	// dozen samples and feeds both cascades, the lower one every few
+	// samples, then fades over to the new one once its history is filled.
+	// fade_oversampling is the new factor, 0 when there's no fade
+	bool adaptive_oversampling;
+	std::atomic<int> pending_adaptive;
+	// of the current cycle, in output samples
+	float shortest_segment;
+	unsigned int fade_oversampling;
+	unsigned int fade_stages;
+	unsigned int fade_position;
+	halfband_decimator fade_decimators[max_oversampling_stages];
+	gendysamp_t fade_input[max_oversampling * halfband_decimator::block_size];
+	gendysamp_t fade_output[halfband_decimator::block_size];
+	// the cycle cache, see set_cache_interval(). while it's on the cycle
+	// plays from cache_table, and breakpoint_current and phase only get
+	// brought up to date when it's turned off again. cache_stale says the
+	// table has to be rendered from them first. positions and the period
+	// are in table samples, cache_rate table samples to an output sample
+	static const unsigned int max_cached_length = 4096;
+	unsigned int cache_interval;
+	float cache_threshold;
+	std::atomic<int> pending_cache_interval;
+	std::atomic<float> pending_cache_threshold;
+	std::atomic<bool> frozen;
+	bool cache_stale;
+	double cache_position;
+	double cache_period;
+	double cache_rate;
+	unsigned int cycles_since_render;
+	// how far the breakpoints have moved since the table was rendered
+	float accumulated_change;
+	gendysamp_t cache_table[max_cached_length + 1];
+	// the oscillators of additive rendering, see additive.h. they're set
+	// up for each cycle, and again whenever anything but the render loop
+	// has moved the cycle or the position in it, which makes them stale
+	partial_bank partials;
+	bool partials_stale;
+	// the output stage, see set_gain(). the gain and level move to their
+	// targets over a block, and the highpass remembers its last input and
+	// output
+	float gain;
+	std::atomic<float> target_gain;
+	float level;
+	std::atomic<float> target_level;
+	float dc_cutoff;
+	float dc_coefficient;
+	std::atomic<float> pending_dc_cutoff;
+	gendysamp_t dc_input;
+	gendysamp_t dc_output;
+	std::atomic<bool> soft_clip;
+	// scheduled changes, see schedule(). they come in through a ring kept
+	// in incoming_slots, and wait in scheduled, in time order, until
+	// they're due. each parameter can have one ramp going, a length of 0
+	// meaning none
+	struct scheduled_change {
+		unsigned long long time;
+		unsigned int ramp;
+		scheduled_param_t param;
+		float value;
+	};
+	struct parameter_ramp {
+		unsigned long long start;
+		unsigned int length;
+		float from;
+		float to;
+	};
+	// a change that doesn't fit in the ring waits in its parameter's
+	// overflow slot instead, where a newer one for that parameter replaces
+	// it. the sequence is odd while the slot is being written, and there's
+	// one waiting while it differs from the last one take_scheduled() took
+	struct overflow_change {
+		std::atomic<unsigned int> sequence;
+		std::atomic<unsigned int> taken;
+		std::atomic<unsigned long long> time;
+		std::atomic<unsigned int> ramp;
+		std::atomic<float> value;
+	};
+	static const unsigned int max_scheduled = 64;
+	static const unsigned int num_scheduled_params = 7;
+	scheduled_change incoming_slots[max_scheduled];
+	spsc_ring<scheduled_change> incoming;
+	overflow_change overflow[num_scheduled_params];
+	scheduled_change scheduled[max_scheduled];
+	unsigned int num_scheduled;
+	parameter_ramp ramps[num_scheduled_params];
+	unsigned int num_ramps;
+	// samples rendered so far, the clock changes are scheduled by. only
+	// the rendering thread moves it on, others can read it
+	std::atomic<unsigned long long> sample_time;
 	// eventually debugging info will be switchable on an object-basis
 	bool debug;
+#if GENDY_STATS
+	// instrumentation counters, see stats.h
+	gendy_stats stats;
+#endif
 
 	void move_breakpoints();
+	bool replay_breakpoints();
+	void next_cycle();
+	void apply_pending_changes();
+	void clear_pending_changes();
+	void apply_num_breakpoints(unsigned int new_size);
+	void apply_interpolation(interpolation_t new_interpolation);
+	// the render loops, specialized for each interpolation type's segment
+	// policy (see gendy_waveform.cpp), and plain function pointers to them
+	typedef unsigned int (*render_function)(gendy_waveform &waveform,
+			gendysamp_t *dest, unsigned int bufsize, gendydur_t step);
+	template<class segment_t>
+	unsigned int render(gendysamp_t *dest, unsigned int bufsize,
+			gendydur_t step);
+	template<class segment_t>
+	static unsigned int render_with(gendy_waveform &waveform,
+			gendysamp_t *dest, unsigned int bufsize, gendydur_t step);
+	// the render loop of additive rendering, which plays the cycles from
+	// their harmonics instead of segment by segment
+	unsigned int render_additive(gendysamp_t *dest, unsigned int bufsize,
+			gendydur_t step);
+	static unsigned int render_additive_with(gendy_waveform &waveform,
+			gendysamp_t *dest, unsigned int bufsize, gendydur_t step);
+	// renders bufsize samples, stepping the phase by step per sample
+	void render_block(gendysamp_t *dest, unsigned int bufsize,
+			gendydur_t step);
+	// renders n samples, at most a decimator block, at the internal rate
+	// and decimates them into dest
+	void render_oversampled(gendysamp_t *dest, unsigned int n);
+	void apply_oversampling(unsigned int factor);
+	unsigned int oversampling_ceiling() const;
+	void adapt_oversampling();
+	unsigned int needed_oversampling(float shortest) const;
+	float find_shortest_segment() const;
+	void start_fade(unsigned int factor);
+	void finish_fade();
+	// renders n samples, at most a decimator block, while fading from one
+	// oversampling factor to another
+	void render_fade(gendysamp_t *dest, unsigned int n);
+	// plays bufsize samples from the cycle cache
+	void render_cached(gendysamp_t *dest, unsigned int bufsize);
+	void render_table();
+	void end_cached_cycle();
+	void enter_cache();
+	void leave_cache();
+	unsigned int locate_cached(gendydur_t &segment_phase) const;
+	unsigned int cache_table_length() const;
+	bool cycle_changes_pending() const;
+	void apply_block_changes();
+	void apply_dc_cutoff(float cutoff);
+	void apply_output_stage(gendysamp_t *dest, unsigned int n);
+	void render_span(gendysamp_t *dest, unsigned int n);
+	// the most advance_samples() moves on in one go
+	static const unsigned int max_advance_span = 1 << 30;
+	void advance_span(unsigned int n);
+	void take_scheduled();
+	void take_overflow(scheduled_param_t param);
+	void insert_scheduled(const scheduled_change &change);
+	unsigned int apply_scheduled(unsigned int max_samples);
+	float get_scheduled_param(scheduled_param_t param) const;
+	void set_scheduled_param(scheduled_param_t param, float value);
+	void apply_quality_level(unsigned int level);
+	interpolation_t effective_interpolation() const;
+	template<class segment_t>
+	unsigned int render_cycle(gendysamp_t *dest, unsigned int bufsize,
+			gendydur_t step) const;
+	unsigned int render_cycle_additive(gendysamp_t *dest,
+			unsigned int bufsize, gendydur_t step) const;
 	void generate_from_breakpoints();
-	void add_breakpoint();
-	void remove_breakpoint();
+	void add_breakpoints(unsigned int count);
+	void remove_breakpoints(unsigned int count);
 	void center_breakpoints();
 	void reset_breakpoints();
 	void set_pre_guardpoints(unsigned int guardpoints);
 	void set_post_guardpoints(unsigned int guardpoints);
+	bool resize_list(unsigned int size);
+	void set_iterators(unsigned int pre_guardpoints,
+			unsigned int num_breakpoints, unsigned int current);
+
+	// not copyable, the iterators point into our own list
+	gendy_waveform(const gendy_waveform &);
+	gendy_waveform &operator=(const gendy_waveform &);
 
 	public:
-	gendy_waveform();
+	// the most guard points any interpolation type uses
+	static const unsigned int max_guardpoints = 3;
+
+	// with max_breakpoints of 0 the breakpoint list grows on the heap as
+	// needed. otherwise room for that many breakpoints is reserved up front,
+	// in storage if it's given (see storage_size()) or in one allocation
+	// made here, and the waveform never allocates again.
+	gendy_waveform(unsigned int max_breakpoints = 0, void *storage = NULL);
+	gendy_waveform(const gendy_config &config, unsigned int max_breakpoints = 0,
+			void *storage = NULL);
 	~gendy_waveform();
+	static size_t storage_size(unsigned int max_breakpoints);
 	//gendy_waveform(float freq);
+	// the number of breakpoints, interpolation, wavelength and waveshape
+	// take effect at the start of the next cycle. the interpolation is
+	// LINEAR, CUBIC or ADDITIVE, which plays the linear cycle from its
+	// harmonics below half the rate it's rendered at, so it doesn't alias
+	// and doesn't need oversampling
 	void set_num_breakpoints(int new_size);
 	void set_avg_wavelength(float new_wavelength);
 	void set_interpolation(interpolation_t new_interpolation);
@@ -86,12 +408,139 @@ class gendy_waveform
 	void set_step_height(float new_height);
 	void set_amplitude_pull(float new_pull);
 	void set_duration_pull(float new_pull);
+	// the wavelength as last set, whether it's taken effect yet or not
+	float get_avg_wavelength() const;
+	float get_step_width() const;
+	float get_step_height() const;
+	float get_amplitude_pull() const;
+	float get_duration_pull() const;
 	void set_constrain_endpoints(bool constrain);
+	void set_duration_distribution(distribution_t distribution);
+	void set_amplitude_distribution(distribution_t distribution);
+	// renders at 2, 4 or 8 times the output rate to cut down aliasing, or
+	// not at all with 1. takes effect at the start of the next block
+	void set_oversampling(unsigned int factor);
+	unsigned int get_oversampling() const;
+	// makes the oversampling factor only the most the waveform uses. it
+	// then goes as low as the shortest segment of each cycle allows, so
+	// low voices with long segments aren't oversampled at all. changes of
+	// factor fade over a couple of blocks. takes effect at the start of
+	// the next block
+	void set_adaptive_oversampling(bool adaptive);
+	bool is_oversampling_adaptive() const;
+	// trades quality for speed, for when the machine can't keep up. 0 is
+	// the waveform as set. each level further down gives up more: linear
+	// instead of cubic interpolation, then moving the breakpoints only
+	// every few cycles, then less oversampling. the settings themselves are
+	// kept, and come back when the level does
+	static const unsigned int max_quality_level = 4;
+	void set_quality_level(unsigned int level);
+	unsigned int get_quality_level() const;
+	// plays each cycle from a wavetable rendered once, instead of
+	// interpolating every sample, for voices that change slowly. the walk
+	// moves on and the table is rendered again every interval cycles, and
+	// 0 turns the cache off. with a threshold above 0 the walk moves every
+	// cycle as usual, and the table is only rendered again once the
+	// breakpoints have moved that far since (in mean amplitude plus
+	// relative duration change per breakpoint), or after interval cycles.
+	// cycles longer than max_cached_length samples are stored at a lower
+	// rate, and oversampling doesn't apply while the cache is on. both
+	// take effect at the start of the next block
+	void set_cache_interval(unsigned int interval);
+	void set_cache_threshold(float threshold);
+	unsigned int get_cache_interval() const;
+	// the output stage, which finishes each block in one pass while it's
+	// still in the cache: a gain, ramped over a block when it changes, a
+	// one-pole highpass against the DC the walk wanders into, with its
+	// cutoff in cycles per sample or 0 for none, and a soft clipper that
+	// keeps the output within -1 to 1 (cubic interpolation overshoots).
+	// a gain of 1 and the rest off costs nothing. the gain and clipper
+	// take effect at the next block, as does the cutoff
+	void set_gain(float new_gain);
+	float get_gain() const;
+	// a second gain, for whoever plays the waveform as a note to set its
+	// level with, so the gain stays the user's. it's ramped like the gain,
+	// and left out of snapshots and copies as it belongs to the note
+	void set_level(float new_level);
+	float get_level() const;
+	void set_dc_cutoff(float cutoff);
+	float get_dc_cutoff() const;
+	void set_soft_clip(bool clip);
+	bool is_soft_clipping() const;
+	// changes a parameter at sample time, counted as get_sample_time()
+	// counts, so it takes effect at exactly that sample of whichever block
+	// it falls in: get_block() splits the block there. with a ramp, it
+	// goes there in a straight line over that many samples instead. the
+	// gain and level follow sample by sample, the rest are followed every
+	// ramp_interval samples from the ramp's start, as they only matter at
+	// cycle boundaries anyway. times already gone by are taken as the
+	// start of the next block, and a change cancels any ramp of the same
+	// parameter. once max_scheduled changes are waiting, a parameter's
+	// newer changes are merged into its newest one rather than made ahead
+	// of the older ones. returns false if the parameter can't be
+	// scheduled. can be called from another thread than the one that
+	// renders
+	static const unsigned int ramp_interval = 16;
+	bool schedule(unsigned long long time, scheduled_param_t param,
+			float value, unsigned int ramp = 0);
+	// samples get_block(), advance_samples() and skip_samples() have gone
+	// through since the waveform was made
+	unsigned long long get_sample_time() const;
+	// moves the clock on by n samples without rendering or moving the
+	// breakpoints, making the scheduled changes that come due meanwhile.
+	// for keeping a voice that isn't playing in step with the others
+	void skip_samples(unsigned int n);
+	// stops the walk, so the breakpoints stay put until it's unfrozen.
+	// requested changes still go through
+	void set_frozen(bool freeze);
+	bool is_frozen() const;
+	void commit_changes();
 	float get_wavelength() const;
 	unsigned int get_num_breakpoints() const;
+	unsigned int get_max_breakpoints() const;
 	unsigned int get_num_guardpoints() const;
 	unsigned int get_block(gendysamp_t *dest, unsigned int bufsize);
 	unsigned int get_cycle(gendysamp_t *dest, unsigned int bufsize) const;
+	// move the random walk on without rendering. advance_cycles() skips to
+	// the start of the n-th cycle from here, advance_samples() leaves the
+	// waveform exactly where get_block() would after n samples
+	void advance_cycles(unsigned long long n);
+	void advance_samples(unsigned long long n);
+	// restarts the random walk keyed by seed and voice, so voices of one
+	// object seeded alike still walk differently
+	void set_seed(unsigned long long seed, unsigned long long voice = 0);
+	void reseed();
+	// starts over at the start of a cycle, with the changes requested so
+	// far and those scheduled for now applied. the breakpoints keep their
+	// shape, scaled to a new wavelength, and the walk carries on from
+	// where it was. only call this from the thread that renders
+	void restart();
+	unsigned long long get_cycle_count() const;
+	// the breakpoints of the current cycle, without the guard points
+	breakpoint_list_t::const_iterator cycle_begin() const;
+	breakpoint_list_t::const_iterator cycle_end() const;
+	// listeners and sources aren't owned by the waveform. returns false if
+	// there are too many listeners already
+	bool add_cycle_listener(cycle_listener *listener);
+	void remove_cycle_listener(cycle_listener *listener);
+	// NULL goes back to the random walk, as does a source that's finished
+	void set_breakpoint_source(breakpoint_source *new_source);
+	breakpoint_source *get_breakpoint_source() const;
+	// NULL for none. not owned either
+	void set_output_sink(output_sink *new_sink);
+	output_sink *get_output_sink() const;
+	bool has_pending_changes() const;
+
+	// state snapshots, see gendy_waveform.cpp for the format
+	size_t state_size() const;
+	static size_t max_state_size(unsigned int max_breakpoints);
+	size_t save_state(void *dest, size_t size) const;
+	bool load_state(const void *src, size_t size);
+	bool copy_state(const gendy_waveform &other);
+#if GENDY_STATS
+	const gendy_stats &get_stats() const;
+	void reset_stats();
+#endif
 }; //end gendy_waveform class def
 
 #endif /* GENDY_WAVEFORM_H */
@@ -35,27 +35,197 @@
 //
 
 #include <math.h>
+#include <string.h>
+#include <new>
 #include <flext.h>
 #include "gendy~.h"
+#include "distributions.h"
 #include "log.h"
+#include "trace.h"
 
 using namespace std;
 
+// breakpoints reserved per voice without a -maxbreakpoints argument
+static const unsigned int default_max_breakpoints = 256;
+// recalls and copies that can wait for the next block at once
+static const unsigned int max_voice_changes = 64;
+// breakpoints buffered between the audio thread and the trace file
+static const size_t trace_ring_size = 1 << 14;
+// Hz the dcblock message and creation argument highpass at by default
+static const float default_dc_cutoff = 10;
+
 #if !defined(FLEXT_VERSION) || (FLEXT_VERSION < 502)
 #error You need at least flext version 0.5.2
 #endif
 
 
 // object class constructor(run at each gendy object creation)
-gendy::gendy() {
+//
+// creation arguments, in any order:
+//   FREQ [BREAKPOINTS]  start at FREQ Hz with BREAKPOINTS breakpoints
+//   linear | cubic | additive
+//                       interpolation
+//   flat | sine | square
+//                       waveshape
+//   seed N              seed the random walk, as the seed message does
+//   oversample N        oversample by N (1, 2, 4 or 8)
+//   auto                oversample only as much as each voice needs, up to N
+//   gain G              scale the output by G
+//   dcblock             highpass the output at 10 Hz
+//   softclip            soft clip the output to -1..1
+//   -voices N           render N independent voices, each to its own outlet
+//   -poly N             play notes on a pool of N voices mixed to one outlet
+//   -maxbreakpoints N   reserve room for up to N breakpoints per voice, so
+//                       the breakpoints message never allocates
+//
+// e.g. [gendy~ 220 64 linear sine seed 7]. the voices are built in that
+// state directly, so there's no resizing or recentering to do at load
+gendy::gendy(int argc, t_atom *argv) :
+		voice_changes(max_voice_changes),
+		governor(gendy_waveform::max_quality_level) {
 	id = gendy_count;
 	gendy_count++;
 	if(debug)
 		print_log("gendy~ #%d: Constructor initiated", id, LOG_DEBUG);
+
+	gendy_config config;
+	num_voices = 1;
+	selected_voice = -1;
+	bool poly = false;
+	max_breakpoints = default_max_breakpoints;
+	bool fixed_max_breakpoints = false;
+	unsigned int positional = 0;
+	for(int i = 0; i < argc; ++i) {
+		if(!IsSymbol(argv[i])) {
+			float value = GetAFloat(argv[i]);
+			if(positional == 0 && value > 0)
+				config.wavelength = Samplerate() / value;
+			else if(positional == 1 && value >= 1)
+				config.num_breakpoints = (unsigned int)value;
+			else
+				print_log("gendy~: ignoring creation argument %f", value,
+						LOG_ERROR);
+			++positional;
+			continue;
+		}
+		const char *flag = GetString(argv[i]);
+		if(strcmp(flag, "linear") == 0)
+			config.interpolation = LINEAR;
+		else if(strcmp(flag, "cubic") == 0)
+			config.interpolation = CUBIC;
+		else if(strcmp(flag, "additive") == 0)
+			config.interpolation = ADDITIVE;
+		else if(strcmp(flag, "flat") == 0)
+			config.waveshape = FLAT;
+		else if(strcmp(flag, "sine") == 0)
+			config.waveshape = SINE;
+		else if(strcmp(flag, "square") == 0)
+			config.waveshape = SQUARE;
+		else if(strcmp(flag, "auto") == 0)
+			config.adaptive_oversampling = true;
+		else if(strcmp(flag, "dcblock") == 0)
+			config.dc_cutoff = default_dc_cutoff / Samplerate();
+		else if(strcmp(flag, "softclip") == 0)
+			config.soft_clip = true;
+		else if(strcmp(flag, "gain") == 0 && i + 1 < argc &&
+				CanbeFloat(argv[i + 1]))
+			config.gain = GetAFloat(argv[++i]);
+		else if(i + 1 >= argc || !CanbeInt(argv[i + 1]))
+			print_log("gendy~: ignoring unknown creation argument", LOG_ERROR);
+		else {
+			int value = GetAInt(argv[++i]);
+			if(strcmp(flag, "-voices") == 0) {
+				if(value < 1) {
+					print_log("gendy~: need at least 1 voice, using 1", LOG_ERROR);
+					value = 1;
+				}
+				num_voices = value;
+				poly = false;
+			}
+			else if(strcmp(flag, "-poly") == 0) {
+				if(value < 1) {
+					print_log("gendy~: need at least 1 voice, using 1", LOG_ERROR);
+					value = 1;
+				}
+				num_voices = value;
+				poly = true;
+			}
+			else if(strcmp(flag, "-maxbreakpoints") == 0) {
+				if(value < 1) {
+					print_log("gendy~: need room for at least 1 breakpoint", LOG_ERROR);
+					value = 1;
+				}
+				max_breakpoints = value;
+				fixed_max_breakpoints = true;
+			}
+			else if(strcmp(flag, "seed") == 0) {
+				config.seeded = true;
+				config.seed = value;
+			}
+			else if(strcmp(flag, "oversample") == 0) {
+				if(value != 1 && value != 2 && value != 4 && value != 8)
+					print_log("gendy~: oversampling has to be 1, 2, 4 or 8",
+							LOG_ERROR);
+				else
+					config.oversampling = value;
+			}
+			else
+				print_log("gendy~: ignoring unknown creation argument", LOG_ERROR);
+		}
+	}
+	// make room for the breakpoints asked for, unless the room was given too
+	if(config.num_breakpoints > max_breakpoints) {
+		if(fixed_max_breakpoints)
+			print_log("gendy~: Cannot resize past %d breakpoints",
+					(int)max_breakpoints, LOG_INFO);
+		else
+			max_breakpoints = config.num_breakpoints;
+	}
+
+	// polyphonic voices start out silent, and get their level from notes
+	num_outputs = poly ? 1 : num_voices;
+	allocator = poly ? new voice_allocator(num_voices) : NULL;
+	if(poly)
+		config.level = 0;
+
 	AddInAnything("control input");	// control input
-	AddOutSignal("audio out");		  // audio output
+	for(unsigned int v = 0; v < num_outputs; ++v)
+		AddOutSignal("audio out");		  // audio output
+	// info outlet: governor levels, spectra, and the counters of a
+	// GENDY_STATS build. there in every build, as the first two are
+	AddOutAnything("info out");
+
+	// all of the voices and their breakpoint pools are allocated here, in
+	// two blocks, and never again
+	size_t pool_size = gendy_waveform::storage_size(max_breakpoints);
+	pool_storage = new char[num_voices * pool_size];
+	voices = static_cast<gendy_waveform *>(
+			operator new[](num_voices * sizeof(gendy_waveform)));
+	for(unsigned int v = 0; v < num_voices; ++v) {
+		config.voice = v;
+		new(&voices[v]) gendy_waveform(config, max_breakpoints,
+				pool_storage + v * pool_size);
+	}
 
 	display_buf = NULL;
+	recorder = NULL;
+	recording_voice = 0;
+	player = NULL;
+	replaying_voice = 0;
+	sink = NULL;
+	streaming_voice = 0;
+	spectrum = NULL;
+	spectrum_voice = 0;
+	spectrum_buf = NULL;
+	modulation = NULL;
+	staged_states = NULL;
+	staged_state_size = gendy_waveform::max_state_size(max_breakpoints);
+	recall_waiting = new std::atomic<bool>[num_voices];
+	for(unsigned int v = 0; v < num_voices; ++v)
+		recall_waiting[v] = false;
+	trace_file = NULL;
+	governing = false;
+	next_block_time = GetTime();
 
 	if(debug)
 		print_log("gendy~ #%d: Constructor terminated", id, LOG_DEBUG);
@@ -65,6 +235,22 @@ gendy::~gendy() {
 	if(debug)
 		print_log("gendy~ #%d: Destructor initiated", id, LOG_DEBUG);
 	gendy_count--;
+	stop_recording();
+	stop_replay();
+	stop_streaming();
+	stop_spectrum();
+	delete recorder;
+	delete player;
+	delete sink;
+	delete spectrum;
+	delete modulation;
+	delete allocator;
+	delete[] staged_states;
+	delete[] recall_waiting;
+	for(unsigned int v = 0; v < num_voices; ++v)
+		voices[v].~gendy_waveform();
+	operator delete[](voices);
+	delete[] pool_storage;
 	if(debug)
 		print_log("gendy~ #%d: Destructor terminated", id, LOG_DEBUG);
 }
@@ -82,12 +268,38 @@ void gendy::class_setup(t_classid thisclass) {
 	FLEXT_CADDMETHOD_(thisclass, 0, "cubic", set_interpolation_cubic);
 	FLEXT_CADDMETHOD_(thisclass, 0, "spline", set_interpolation_spline);
 	FLEXT_CADDMETHOD_(thisclass, 0, "sinc", set_interpolation_sinc);
+	FLEXT_CADDMETHOD_(thisclass, 0, "additive", set_interpolation_additive);
 	FLEXT_CADDMETHOD_(thisclass, 0, "flat", set_waveform_flat);
 	FLEXT_CADDMETHOD_(thisclass, 0, "sine", set_waveform_sine);
 	FLEXT_CADDMETHOD_(thisclass, 0, "square", set_waveform_square);
+	FLEXT_CADDMETHOD_(thisclass, 0, "distribution", set_distribution);
 	FLEXT_CADDMETHOD_(thisclass, 0, "debug", set_debug);
 	FLEXT_CADDMETHOD_(thisclass, 0, "table", set_outbuf);
 	FLEXT_CADDMETHOD_(thisclass, 0, "redraw", redraw);
+	FLEXT_CADDMETHOD_(thisclass, 0, "stats", output_stats);
+	FLEXT_CADDMETHOD_(thisclass, 0, "voice", select_voice);
+	FLEXT_CADDMETHOD_(thisclass, 0, "bank", open_bank);
+	FLEXT_CADDMETHOD_(thisclass, 0, "store", store_preset);
+	FLEXT_CADDMETHOD_(thisclass, 0, "recall", recall_preset);
+	FLEXT_CADDMETHOD_(thisclass, 0, "copy", copy_voice);
+	FLEXT_CADDMETHOD_(thisclass, 0, "seed", set_seed);
+	FLEXT_CADDMETHOD_(thisclass, 0, "advance", advance);
+	FLEXT_CADDMETHOD_(thisclass, 0, "oversample", set_oversampling);
+	FLEXT_CADDMETHOD_(thisclass, 0, "trace", trace);
+	FLEXT_CADDMETHOD_(thisclass, 0, "governor", set_governor);
+	FLEXT_CADDMETHOD_(thisclass, 0, "cache", set_cache);
+	FLEXT_CADDMETHOD_(thisclass, 0, "freeze", freeze);
+	FLEXT_CADDMETHOD_(thisclass, 0, "record", record);
+	FLEXT_CADDMETHOD_(thisclass, 0, "replay", replay);
+	FLEXT_CADDMETHOD_(thisclass, 0, "shm", stream);
+	FLEXT_CADDMETHOD_(thisclass, 0, "spectrum", set_spectrum);
+	FLEXT_CADDMETHOD_(thisclass, 0, "gain", set_gain);
+	FLEXT_CADDMETHOD_(thisclass, 0, "dcblock", set_dc_block);
+	FLEXT_CADDMETHOD_(thisclass, 0, "softclip", set_soft_clip);
+	FLEXT_CADDMETHOD_(thisclass, 0, "mod", modulate);
+	FLEXT_CADDMETHOD_(thisclass, 0, "note", note);
+	FLEXT_CADDMETHOD_(thisclass, 0, "release", release);
+	FLEXT_CADDMETHOD_(thisclass, 0, "steal", set_steal_policy);
 	print_log("",LOG_INFO);
 	print_log("-- gendy~ v%d.%d.%d by Spencer Russell --",
 			GENDY_MAJ, GENDY_MIN, GENDY_REV, LOG_INFO);
@@ -101,40 +313,198 @@ void gendy::class_setup(t_classid thisclass) {
 // float *const *in, float *const *out:
 //  These are arrays of signal vectors(in is a pointer to const pointer to float)
 
-void gendy::m_signal(int n, float *const *in, float *const *out) {
-	waveform.get_block(out[0], n);
+void gendy::m_signal(int n, float *const * /* in */, float *const *out) {
+	GENDY_TRACE_SCOPE("m_signal", n);
+	GENDY_STATS_START(start);
+	gendy_ticks_t governor_start = governing ? gendy_clock() : 0;
+	apply_voice_changes();
+	if(allocator)
+		render_poly(out[0], n);
+	else {
+		for(unsigned int v = 0; v < num_voices; ++v)
+			voices[v].get_block(out[v], n);
+	}
+	if(governing) {
+		unsigned int level = governor.get_level();
+		unsigned int new_level = governor.update(gendy_clock() - governor_start,
+				(gendy_ticks_t)(n * 1e9 / Samplerate()));
+		if(new_level != level) {
+			for(unsigned int v = 0; v < num_voices; ++v)
+				voices[v].set_quality_level(new_level);
+			// messages don't belong in the DSP routine, flext passes
+			// queued ones on from the message thread
+			t_atom arg;
+			SetFloat(arg, new_level);
+			ToQueueAnything(num_outputs, MakeSymbol("governor"), 1, &arg);
+		}
+	}
+	if(spectrum && spectrum->take_update())
+		output_spectrum();
+	next_block_time = GetTime();
+#if GENDY_STATS
+	gendy_ticks_t elapsed = gendy_clock() - start;
+	++block_stats.blocks;
+	block_stats.block_time += elapsed;
+	if(elapsed > block_stats.worst_block_time)
+		block_stats.worst_block_time = elapsed;
+#endif
+}
+
+// mixes the voices that are playing into out, and skips the rest. a voice
+// that was idle starts over at its note's frequency rather than gliding
+// there, and a released one goes idle once its level has ramped down
+void gendy::render_poly(float *out, int n) {
+	for(int i = 0; i < n; ++i)
+		out[i] = 0;
+	for(unsigned int v = 0; v < num_voices; ++v) {
+		if(!allocator->is_active(v)) {
+			voices[v].skip_samples(n);
+			continue;
+		}
+		if(allocator->take_start(v))
+			voices[v].restart();
+		for(int done = 0; done < n; done += mix_block_size) {
+			unsigned int chunk = n - done < (int)mix_block_size ?
+				n - done : mix_block_size;
+			voices[v].get_block(mix_buffer, chunk);
+			for(unsigned int i = 0; i < chunk; ++i)
+				out[done + i] += mix_buffer[i];
+		}
+		if(allocator->is_releasing(v) && voices[v].get_level() == 0)
+			allocator->set_idle(v);
+	}
 }
 
 // Message handling functions
 
-void gendy::set_frequency(float new_freq) {
+// freq HZ [MS]
+//
+// with MS, glides to HZ over MS milliseconds
+void gendy::set_frequency(short argc, t_atom *argv) {
+	float new_freq;
+	unsigned int ramp;
+	if(!get_ramped_value(argc, argv, "gendy~: usage: freq HZ [MS]", new_freq,
+				ramp))
+		return;
 	print_log("set_frequency(%f)", new_freq, LOG_DEBUG);
-	waveform.set_avg_wavelength(Samplerate() / new_freq);
+	if(new_freq <= 0) {
+		print_log("gendy~: the frequency has to be above 0", LOG_ERROR);
+		return;
+	}
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(!schedule_change(v, SCHEDULE_FREQUENCY, new_freq / Samplerate(),
+					ramp))
+			voices[v].set_avg_wavelength(Samplerate() / new_freq);
+		if(modulation)
+			modulation->set_base(v, TARGET_FREQUENCY, Samplerate() / new_freq);
+	}
 }
 
 void gendy::set_num_breakpoints(float num_breakpoints) {
 	print_log("set_num_breakpoints(%f)", num_breakpoints, LOG_DEBUG);
-	waveform.set_num_breakpoints(num_breakpoints);
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].set_num_breakpoints(num_breakpoints);
 }
 
-void gendy::set_h_step(float new_stepsize) {
+// h_step, v_step, h_pull and v_pull take VALUE [MS] too
+
+void gendy::set_h_step(short argc, t_atom *argv) {
+	float new_stepsize;
+	unsigned int ramp;
+	if(!get_ramped_value(argc, argv, "gendy~: usage: h_step STEP [MS]",
+				new_stepsize, ramp))
+		return;
 	print_log("set_h_step(%f)", new_stepsize, LOG_DEBUG);
-	waveform.set_step_width(new_stepsize);
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(!schedule_change(v, SCHEDULE_STEP_WIDTH, new_stepsize, ramp))
+			voices[v].set_step_width(new_stepsize);
+		if(modulation)
+			modulation->set_base(v, TARGET_STEP_WIDTH, new_stepsize);
+	}
 }
 
-void gendy::set_v_step(float new_stepsize) {
+void gendy::set_v_step(short argc, t_atom *argv) {
+	float new_stepsize;
+	unsigned int ramp;
+	if(!get_ramped_value(argc, argv, "gendy~: usage: v_step STEP [MS]",
+				new_stepsize, ramp))
+		return;
 	print_log("set_v_step(%f)", new_stepsize, LOG_DEBUG);
-	waveform.set_step_height(new_stepsize);
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(!schedule_change(v, SCHEDULE_STEP_HEIGHT, new_stepsize, ramp))
+			voices[v].set_step_height(new_stepsize);
+		if(modulation)
+			modulation->set_base(v, TARGET_STEP_HEIGHT, new_stepsize);
+	}
 }
 
-void gendy::set_h_pull(float new_pull) {
+void gendy::set_h_pull(short argc, t_atom *argv) {
+	float new_pull;
+	unsigned int ramp;
+	if(!get_ramped_value(argc, argv, "gendy~: usage: h_pull PULL [MS]",
+				new_pull, ramp))
+		return;
 	print_log("set_h_pull(%f)", new_pull, LOG_DEBUG);
-	waveform.set_duration_pull(new_pull);
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(!schedule_change(v, SCHEDULE_DURATION_PULL, new_pull, ramp))
+			voices[v].set_duration_pull(new_pull);
+		if(modulation)
+			modulation->set_base(v, TARGET_DURATION_PULL, new_pull);
+	}
 }
 
-void gendy::set_v_pull(float new_pull) {
+void gendy::set_v_pull(short argc, t_atom *argv) {
+	float new_pull;
+	unsigned int ramp;
+	if(!get_ramped_value(argc, argv, "gendy~: usage: v_pull PULL [MS]",
+				new_pull, ramp))
+		return;
 	print_log("set_v_pull(%f)", new_pull, LOG_DEBUG);
-	waveform.set_amplitude_pull(new_pull);
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(!schedule_change(v, SCHEDULE_AMPLITUDE_PULL, new_pull, ramp))
+			voices[v].set_amplitude_pull(new_pull);
+		if(modulation)
+			modulation->set_base(v, TARGET_AMPLITUDE_PULL, new_pull);
+	}
+}
+
+// reads the VALUE [MS] that the parameter messages take, MS being how long
+// to ramp to VALUE over, in samples. complains with usage if they don't fit
+bool gendy::get_ramped_value(short argc, t_atom *argv, const char *usage,
+		float &value, unsigned int &ramp) {
+	if(argc < 1 || argc > 2 || !CanbeFloat(argv[0]) ||
+			(argc == 2 && !CanbeFloat(argv[1]))) {
+		print_log(usage, LOG_ERROR);
+		return false;
+	}
+	value = GetAFloat(argv[0]);
+	float ms = argc == 2 ? GetAFloat(argv[1]) : 0;
+	ramp = ms > 0 ? (unsigned int)(ms * 0.001f * Samplerate() + 0.5f) : 0;
+	return true;
+}
+
+// has voice v make a change at the sample of the coming block that Pd's
+// logical time puts the message at, as vline~ does. false if it should be
+// made right away instead, because the DSP isn't running, so there's no
+// block coming
+bool gendy::schedule_change(unsigned int v, scheduled_param_t param,
+		float value, unsigned int ramp) {
+	unsigned int offset = 0;
+	if(!get_block_offset(offset) && !ramp)
+		return false;
+	return voices[v].schedule(voices[v].get_sample_time() + offset, param,
+			value, ramp);
+}
+
+// where a message arriving now falls in the coming block, in samples,
+// going by Pd's logical time. false if the DSP isn't running, as then
+// there's no block coming
+bool gendy::get_block_offset(unsigned int &offset) const {
+	double samples = (GetTime() - next_block_time) * Samplerate() + 0.5;
+	if(samples < 0 || samples >= Blocksize())
+		return false;
+	offset = (unsigned int)samples;
+	return true;
 }
 
 void gendy::set_interpolation_lin() {
@@ -157,6 +527,13 @@ void gendy::set_interpolation_sinc() {
 	set_interpolation(SINC);
 }
 
+// plays each cycle as the sum of its harmonics below the Nyquist frequency,
+// so high voices with many breakpoints don't alias
+void gendy::set_interpolation_additive() {
+	print_log("set_interpolation_additive()", LOG_DEBUG);
+	set_interpolation(ADDITIVE);
+}
+
 void gendy::set_waveform_flat() {
 	print_log("set_waveform_flat()", LOG_DEBUG);
 	set_waveform(FLAT);
@@ -172,6 +549,38 @@ void gendy::set_waveform_square() {
 	set_waveform(SQUARE);
 }
 
+// distribution [h|v] NAME
+//
+// sets the distribution the random steps are drawn from, for durations (h),
+// amplitudes (v) or, without an axis, both. NAME is one of gaussian, cauchy,
+// logistic, arcsine or hypcos
+void gendy::set_distribution(short argc, t_atom *argv) {
+	bool horizontal = true;
+	bool vertical = true;
+	if(argc == 2 && IsSymbol(argv[0])) {
+		const char *axis = GetString(argv[0]);
+		horizontal = strcmp(axis, "h") == 0;
+		vertical = strcmp(axis, "v") == 0;
+		--argc;
+		++argv;
+	}
+	if(argc != 1 || !IsSymbol(argv[0]) || !(horizontal || vertical)) {
+		print_log("gendy~: usage: distribution [h|v] name", LOG_ERROR);
+		return;
+	}
+	distribution_t distribution;
+	if(!distribution_from_name(GetString(argv[0]), distribution)) {
+		print_log("gendy~: unknown distribution", LOG_ERROR);
+		return;
+	}
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(horizontal)
+			voices[v].set_duration_distribution(distribution);
+		if(vertical)
+			voices[v].set_amplitude_distribution(distribution);
+	}
+}
+
 void gendy::set_debug(int new_debug) {
 	print_log("set_debug(%d)", new_debug, LOG_DEBUG);
 	if(new_debug)
@@ -208,14 +617,689 @@ void gendy::set_outbuf(short argc, t_atom *argv) {
 
 // private class methods
 void gendy::set_interpolation(interpolation_t new_interpolation) {
-	waveform.set_interpolation(new_interpolation);
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].set_interpolation(new_interpolation);
 }
 
 void gendy::set_waveform(waveshape_t new_waveform) {
-	waveform.set_waveshape(new_waveform);
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].set_waveshape(new_waveform);
+}
+
+// voice N [message...]
+//
+// with a message following the voice number, that message only goes to
+// voice N. with just a number, all following messages go to voice N until
+// "voice all" (or a negative number) selects all of the voices again.
+void gendy::select_voice(short argc, t_atom *argv) {
+	if(argc < 1) {
+		print_log("gendy~: voice needs a voice number or 'all'", LOG_ERROR);
+		return;
+	}
+	int voice;
+	if(IsSymbol(argv[0]) && strcmp(GetString(argv[0]), "all") == 0)
+		voice = -1;
+	else if(CanbeInt(argv[0]))
+		voice = GetAInt(argv[0]);
+	else {
+		print_log("gendy~: invalid voice number", LOG_ERROR);
+		return;
+	}
+	if(voice >= (int)num_voices) {
+		print_log("gendy~: no voice %d", voice, LOG_ERROR);
+		return;
+	}
+	if(voice < 0)
+		voice = -1;
+
+	if(argc == 1) {
+		selected_voice = voice;
+		return;
+	}
+	if(!IsSymbol(argv[1])) {
+		print_log("gendy~: voice expects a message after the voice number",
+				LOG_ERROR);
+		return;
+	}
+	int previous = selected_voice;
+	selected_voice = voice;
+	CbMethodHandler(0, GetSymbol(argv[1]), argc - 2, argv + 2);
+	selected_voice = previous;
+}
+
+// bank FILE [SLOTS]
+//
+// opens a preset bank file, or creates a new one with room for SLOTS
+// presets if SLOTS is given
+void gendy::open_bank(short argc, t_atom *argv) {
+	if(argc < 1 || !IsSymbol(argv[0])) {
+		print_log("gendy~: bank needs a file name", LOG_ERROR);
+		return;
+	}
+	const char *path = GetString(argv[0]);
+	if(argc > 1 && CanbeInt(argv[1])) {
+		int slots = GetAInt(argv[1]);
+		if(slots < 1) {
+			print_log("gendy~: a preset bank needs at least 1 slot", LOG_ERROR);
+			return;
+		}
+		presets.create(path, slots, max_breakpoints);
+	}
+	else
+		presets.open(path);
+}
+
+// saves the selected voice (the first one if all are selected) to a slot
+// of the preset bank
+void gendy::store_preset(int slot) {
+	if(!presets.is_open()) {
+		print_log("gendy~: no preset bank open", LOG_ERROR);
+		return;
+	}
+	if(slot < 0 || !presets.store(slot, voices[target_begin()]))
+		print_log("gendy~: couldn't store preset %d", slot, LOG_ERROR);
+}
+
+// restores the selected voices from a slot of the preset bank, at the
+// start of the next block
+void gendy::recall_preset(int slot) {
+	if(!presets.is_open()) {
+		print_log("gendy~: no preset bank open", LOG_ERROR);
+		return;
+	}
+	if(!staged_states)
+		staged_states = new char[num_voices * staged_state_size];
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(recall_waiting[v]) {
+			print_log("gendy~: voice %d is still waiting for a recall", v,
+					LOG_ERROR);
+			continue;
+		}
+		voice_change change;
+		change.type = RECALL_VOICE;
+		change.source = slot;
+		change.dest = v;
+		change.length = slot < 0 ? 0 : presets.read_snapshot(slot,
+				staged_states + v * staged_state_size, staged_state_size);
+		if(change.length == 0) {
+			print_log("gendy~: couldn't recall preset %d", slot, LOG_ERROR);
+			return;
+		}
+		recall_waiting[v] = true;
+		if(!voice_changes.push(change)) {
+			recall_waiting[v] = false;
+			print_log("gendy~: too many recalls and copies waiting", LOG_ERROR);
+			return;
+		}
+	}
+	unsigned int offset;
+	if(!get_block_offset(offset))
+		apply_voice_changes();
+}
+
+// copy SOURCE DEST
+//
+// forks voice SOURCE into voice DEST, which picks up exactly where SOURCE
+// is and then wanders off on its own
+void gendy::copy_voice(int source, int dest) {
+	if(source < 0 || source >= (int)num_voices ||
+			dest < 0 || dest >= (int)num_voices) {
+		print_log("gendy~: no such voice", LOG_ERROR);
+		return;
+	}
+	if(source == dest)
+		return;
+	voice_change change;
+	change.type = COPY_VOICE;
+	change.source = source;
+	change.dest = dest;
+	change.length = 0;
+	if(!voice_changes.push(change)) {
+		print_log("gendy~: too many recalls and copies waiting", LOG_ERROR);
+		return;
+	}
+	unsigned int offset;
+	if(!get_block_offset(offset))
+		apply_voice_changes();
+}
+
+// makes the recalls and copies that are waiting, in the order they were
+// asked for. called by the DSP method before it renders anything, so a
+// copy picks up exactly where its source is, or right away by the message
+// methods when the DSP isn't running
+void gendy::apply_voice_changes() {
+	voice_change change;
+	while(voice_changes.pop(change)) {
+		gendy_waveform &voice = voices[change.dest];
+		if(change.type == RECALL_VOICE) {
+			if(!voice.load_state(staged_states +
+						change.dest * staged_state_size, change.length))
+				print_log("gendy~: couldn't recall preset %d", change.source,
+						LOG_ERROR);
+			recall_waiting[change.dest] = false;
+		}
+		else if(!voice.copy_state(voices[change.source]))
+			print_log("gendy~: voice %d has too many breakpoints to copy",
+					change.source, LOG_ERROR);
+		else
+			voice.reseed();
+	}
+}
+
+// seed N
+//
+// makes the random walk reproducible: each voice is keyed by N and its own
+// index, so the same seed always gives the same sound
+void gendy::set_seed(int seed) {
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].set_seed(seed, v);
+}
+
+// advance N
+//
+// evolves the waveform N cycles ahead without rendering them. sent from a
+// loadbang, it saves a patch from starting on the plain reset shape
+void gendy::advance(int cycles) {
+	if(cycles < 0) {
+		print_log("gendy~: can't advance by a negative number of cycles",
+				LOG_ERROR);
+		return;
+	}
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].advance_cycles(cycles);
+}
+
+// oversample N [auto]
+//
+// renders internally at N (1, 2, 4 or 8) times the sample rate and filters
+// back down, which keeps high or jagged waveforms from aliasing. with auto
+// N is only the most a voice uses. each voice then goes as low as its
+// shortest segment allows, so low drones with long segments cost no more
+// than without oversampling
+void gendy::set_oversampling(short argc, t_atom *argv) {
+	if(argc < 1 || !CanbeInt(argv[0]) || (argc > 1 && (!IsSymbol(argv[1]) ||
+			strcmp(GetString(argv[1]), "auto") != 0))) {
+		print_log("gendy~: oversample needs a factor and optionally auto",
+				LOG_ERROR);
+		return;
+	}
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		voices[v].set_oversampling(GetAInt(argv[0]));
+		voices[v].set_adaptive_oversampling(argc > 1);
+	}
+}
+
+// governor BUDGET
+//
+// with a BUDGET above 0, gives up quality step by step (cubic to linear,
+// holding the breakpoints for a few cycles, less oversampling) whenever
+// rendering takes more than that share of each block's duration, and
+// brings it back once there's room again. the level goes out of the last
+// outlet as "governor N", 0 being full quality. 0 turns it off
+void gendy::set_governor(float budget) {
+	governing = budget > 0;
+	if(governing)
+		governor.set_budget(budget);
+	else if(governor.get_level() > 0) {
+		governor.reset();
+		for(unsigned int v = 0; v < num_voices; ++v)
+			voices[v].set_quality_level(0);
+		t_atom arg;
+		SetFloat(arg, 0);
+		ToOutAnything(num_outputs, MakeSymbol("governor"), 1, &arg);
+	}
+	else
+		governor.reset();
+}
+
+// cache N [THRESHOLD]
+//
+// plays each cycle from a wavetable instead of interpolating every sample,
+// which is much cheaper for slowly changing drones. the breakpoints move
+// and the table is rendered again only every N cycles, so the walk slows
+// down N times. with a THRESHOLD the walk keeps its pace and the table is
+// rendered again once the breakpoints have moved that far (try 0.05), or
+// after N cycles at the latest. cache 0 goes back to normal rendering
+void gendy::set_cache(short argc, t_atom *argv) {
+	if(argc < 1 || !CanbeInt(argv[0]) || GetAInt(argv[0]) < 0 ||
+			(argc > 1 && !CanbeFloat(argv[1]))) {
+		print_log("gendy~: cache needs a number of cycles and an optional threshold",
+				LOG_ERROR);
+		return;
+	}
+	float threshold = argc > 1 ? GetAFloat(argv[1]) : 0;
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		voices[v].set_cache_threshold(threshold);
+		voices[v].set_cache_interval(GetAInt(argv[0]));
+	}
+}
+
+// freeze [0|1]
+//
+// stops the random walk where it is, and "freeze 0" lets it go on.
+// frequency and breakpoint changes still go through
+void gendy::freeze(short argc, t_atom *argv) {
+	bool frozen = true;
+	if(argc > 0) {
+		if(!CanbeFloat(argv[0])) {
+			print_log("gendy~: freeze takes 0 or 1", LOG_ERROR);
+			return;
+		}
+		frozen = GetAFloat(argv[0]) != 0;
+	}
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].set_frozen(frozen);
+}
+
+// gain G [MS]
+//
+// scales the output by G, ramping to it over MS milliseconds, or over the
+// rest of the block without them
+void gendy::set_gain(short argc, t_atom *argv) {
+	float new_gain;
+	unsigned int ramp;
+	if(!get_ramped_value(argc, argv, "gendy~: usage: gain G [MS]", new_gain,
+				ramp))
+		return;
+	for(unsigned int v = target_begin(); v < target_end(); ++v) {
+		if(!schedule_change(v, SCHEDULE_GAIN, new_gain, ramp))
+			voices[v].set_gain(new_gain);
+	}
+}
+
+// dcblock [HZ]
+//
+// highpasses the output at HZ, 10 without it, to take out the offset the
+// random walk drifts into. 0 turns it off
+void gendy::set_dc_block(short argc, t_atom *argv) {
+	float cutoff = default_dc_cutoff;
+	if(argc > 0) {
+		if(!CanbeFloat(argv[0])) {
+			print_log("gendy~: dcblock takes a cutoff in Hz", LOG_ERROR);
+			return;
+		}
+		cutoff = GetAFloat(argv[0]);
+	}
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].set_dc_cutoff(cutoff / Samplerate());
+}
+
+// softclip [0|1]
+//
+// soft clips the output to -1..1, or stops with 0
+void gendy::set_soft_clip(short argc, t_atom *argv) {
+	bool clip = true;
+	if(argc > 0) {
+		if(!CanbeFloat(argv[0])) {
+			print_log("gendy~: softclip takes 0 or 1", LOG_ERROR);
+			return;
+		}
+		clip = GetAFloat(argv[0]) != 0;
+	}
+	for(unsigned int v = target_begin(); v < target_end(); ++v)
+		voices[v].set_soft_clip(clip);
+}
+
+// mod FROM SOURCE TO TARGET DEPTH | mod clear
+//
+// modulates TARGET of voice TO (h_step, v_step, h_pull, v_pull or freq)
+// by SOURCE of voice FROM (length, amplitude or breakpoint), scaled by
+// DEPTH, from every cycle of FROM on. h_step and the rest get DEPTH times
+// the source added, freq goes up by that many octaves. a DEPTH of 0 takes
+// the route away again, and "mod clear" takes them all away
+void gendy::modulate(short argc, t_atom *argv) {
+	static const char *source_names[modulation_matrix::num_sources] = {
+		"length", "amplitude", "breakpoint"
+	};
+	static const char *target_names[modulation_matrix::num_targets] = {
+		"h_step", "v_step", "h_pull", "v_pull", "freq"
+	};
+	if(argc == 1 && IsSymbol(argv[0]) &&
+			strcmp(GetString(argv[0]), "clear") == 0) {
+		if(modulation)
+			modulation->clear();
+		return;
+	}
+	if(argc != 5 || !CanbeInt(argv[0]) || !IsSymbol(argv[1]) ||
+			!CanbeInt(argv[2]) || !IsSymbol(argv[3]) || !CanbeFloat(argv[4])) {
+		print_log("gendy~: usage: mod FROM SOURCE TO TARGET DEPTH", LOG_ERROR);
+		return;
+	}
+	int from = GetAInt(argv[0]);
+	int to = GetAInt(argv[2]);
+	if(from < 0 || from >= (int)num_voices || to < 0 || to >= (int)num_voices) {
+		print_log("gendy~: no voice %d", from < 0 || from >= (int)num_voices ?
+				from : to, LOG_ERROR);
+		return;
+	}
+	unsigned int source = 0;
+	while(source < modulation_matrix::num_sources &&
+			strcmp(GetString(argv[1]), source_names[source]) != 0)
+		++source;
+	unsigned int target = 0;
+	while(target < modulation_matrix::num_targets &&
+			strcmp(GetString(argv[3]), target_names[target]) != 0)
+		++target;
+	if(source == modulation_matrix::num_sources ||
+			target == modulation_matrix::num_targets) {
+		print_log("gendy~: mod sources are length, amplitude and breakpoint, "
+				"targets h_step, v_step, h_pull, v_pull and freq", LOG_ERROR);
+		return;
+	}
+	if(!modulation)
+		modulation = new modulation_matrix(voices, num_voices);
+	if(!modulation->set_route(from, (modulation_source_t)source, to,
+			(modulation_target_t)target, GetAFloat(argv[4])))
+		print_log("gendy~: couldn't add the route, there are %d already or "
+				"too many listeners", (int)modulation->get_num_routes(),
+				LOG_ERROR);
+}
+
+// note ID FREQ [AMP]
+//
+// with -poly, plays note ID at FREQ Hz and amplitude AMP (1 without it) on
+// a voice of its own, taking one from another note if they're all busy
+// (see steal). a note that's already playing changes pitch and amplitude
+// instead. an AMP of 0 releases it
+void gendy::note(short argc, t_atom *argv) {
+	if(!allocator) {
+		print_log("gendy~: note needs a gendy~ made with -poly", LOG_ERROR);
+		return;
+	}
+	if(argc < 2 || argc > 3 || !CanbeInt(argv[0]) || !CanbeFloat(argv[1]) ||
+			(argc == 3 && !CanbeFloat(argv[2]))) {
+		print_log("gendy~: usage: note ID FREQ [AMP]", LOG_ERROR);
+		return;
+	}
+	int id = GetAInt(argv[0]);
+	float freq = GetAFloat(argv[1]);
+	float amp = argc == 3 ? GetAFloat(argv[2]) : 1;
+	if(amp <= 0) {
+		int v = allocator->note_off(id);
+		if(v >= 0)
+			set_note_level(v, 0);
+		return;
+	}
+	if(freq <= 0) {
+		print_log("gendy~: a note needs a frequency above 0", LOG_ERROR);
+		return;
+	}
+	bool was_idle;
+	unsigned int v = allocator->note_on(id, amp, was_idle);
+	// a voice that was idle starts out at its note's frequency, see
+	// render_poly(), and one that's playing changes at the note's sample
+	float frequency = freq / Samplerate();
+	if(was_idle)
+		voices[v].schedule(voices[v].get_sample_time(), SCHEDULE_FREQUENCY,
+				frequency);
+	else if(!schedule_change(v, SCHEDULE_FREQUENCY, frequency, 0))
+		voices[v].set_avg_wavelength(Samplerate() / freq);
+	if(modulation)
+		modulation->set_base(v, TARGET_FREQUENCY, Samplerate() / freq);
+	set_note_level(v, amp);
+}
+
+// moves voice v's note level to level over a block, starting at the sample
+// the message falls at. the gain message scales all of them on top
+void gendy::set_note_level(unsigned int v, float level) {
+	if(!schedule_change(v, SCHEDULE_LEVEL, level, Blocksize()))
+		voices[v].set_level(level);
+}
+
+// release [ID]
+//
+// fades note ID out over a block, after which its voice stops rendering.
+// without ID, releases every note
+void gendy::release(short argc, t_atom *argv) {
+	if(!allocator) {
+		print_log("gendy~: release needs a gendy~ made with -poly", LOG_ERROR);
+		return;
+	}
+	if(argc == 0) {
+		allocator->release_all();
+		for(unsigned int v = 0; v < num_voices; ++v)
+			set_note_level(v, 0);
+		return;
+	}
+	if(!CanbeInt(argv[0])) {
+		print_log("gendy~: usage: release [ID]", LOG_ERROR);
+		return;
+	}
+	int v = allocator->note_off(GetAInt(argv[0]));
+	if(v >= 0)
+		set_note_level(v, 0);
+}
+
+// steal oldest|quietest
+//
+// which voice a note takes when they're all busy: the one whose note
+// started first (the default) or the one with the lowest AMP. voices
+// already released go before ones that are still held either way
+void gendy::set_steal_policy(short argc, t_atom *argv) {
+	const char *name = argc == 1 && IsSymbol(argv[0]) ?
+		GetString(argv[0]) : "";
+	if(!allocator)
+		print_log("gendy~: steal needs a gendy~ made with -poly", LOG_ERROR);
+	else if(strcmp(name, "oldest") == 0)
+		allocator->set_policy(STEAL_OLDEST);
+	else if(strcmp(name, "quietest") == 0)
+		allocator->set_policy(STEAL_QUIETEST);
+	else
+		print_log("gendy~: usage: steal oldest|quietest", LOG_ERROR);
+}
+
+// trace start [FILE] | trace stop [FILE]
+//
+// records what every gendy~ is doing (blocks, cycles, resizes, redraws)
+// from "trace start" until "trace stop", and writes it to FILE as Chrome
+// trace JSON, to line dropouts up with what caused them. only in builds
+// with GENDY_TRACE
+void gendy::trace(short argc, t_atom *argv) {
+#if GENDY_TRACE
+	if(argc < 1 || argc > 2 || !IsSymbol(argv[0]) ||
+			(argc == 2 && !IsSymbol(argv[1]))) {
+		print_log("gendy~: usage: trace start|stop [file]", LOG_ERROR);
+		return;
+	}
+	const char *command = GetString(argv[0]);
+	if(strcmp(command, "start") == 0) {
+		if(argc == 2)
+			trace_file = GetSymbol(argv[1]);
+		if(!gendy_trace_start())
+			print_log("gendy~: a trace is already running", LOG_ERROR);
+	}
+	else if(strcmp(command, "stop") == 0) {
+		if(argc == 2)
+			trace_file = GetSymbol(argv[1]);
+		if(!trace_file) {
+			print_log("gendy~: trace stop needs a file name", LOG_ERROR);
+			return;
+		}
+		if(!gendy_trace_running())
+			print_log("gendy~: no trace running", LOG_ERROR);
+		else
+			gendy_trace_stop(GetString(trace_file));
+	}
+	else
+		print_log("gendy~: usage: trace start|stop [file]", LOG_ERROR);
+#else
+	(void)argc;
+	(void)argv;
+	print_log("gendy~: built without GENDY_TRACE, no tracing available",
+			LOG_ERROR);
+#endif
+}
+
+// record FILE | record stop
+//
+// writes the breakpoints of every cycle of the selected voice (the first
+// one if all are selected) to a trace file, until "record stop"
+void gendy::record(short argc, t_atom *argv) {
+	if(argc != 1 || !IsSymbol(argv[0])) {
+		print_log("gendy~: usage: record file|stop", LOG_ERROR);
+		return;
+	}
+	stop_recording();
+	const char *path = GetString(argv[0]);
+	if(strcmp(path, "stop") == 0)
+		return;
+	if(!recorder)
+		recorder = new trace_recorder(trace_ring_size);
+	if(!recorder->start(path, Samplerate()))
+		return;
+	recording_voice = target_begin();
+	voices[recording_voice].add_cycle_listener(recorder);
+}
+
+// replay FILE | replay stop
+//
+// plays the selected voice from a trace file instead of the random walk,
+// at the current sample rate and with the voice's own interpolation. the
+// walk takes over again where the trace ends
+void gendy::replay(short argc, t_atom *argv) {
+	if(argc != 1 || !IsSymbol(argv[0])) {
+		print_log("gendy~: usage: replay file|stop", LOG_ERROR);
+		return;
+	}
+	stop_replay();
+	const char *path = GetString(argv[0]);
+	if(strcmp(path, "stop") == 0)
+		return;
+	if(!player)
+		player = new trace_player(trace_ring_size, max_breakpoints);
+	if(!player->start(path, Samplerate()))
+		return;
+	replaying_voice = target_begin();
+	voices[replaying_voice].set_breakpoint_source(player);
+}
+
+// shm NAME | shm stop
+//
+// publishes the selected voice's audio and the breakpoints of each cycle in
+// the shared memory segment NAME, for other programs to read without going
+// through the sound card. see shm_stream.h for the reader
+void gendy::stream(short argc, t_atom *argv) {
+	if(argc != 1 || !IsSymbol(argv[0])) {
+		print_log("gendy~: usage: shm name|stop", LOG_ERROR);
+		return;
+	}
+	stop_streaming();
+	const char *name = GetString(argv[0]);
+	if(strcmp(name, "stop") == 0)
+		return;
+	if(!sink)
+		sink = new shm_sink();
+	if(!sink->open(name, Samplerate(), max_breakpoints))
+		return;
+	streaming_voice = target_begin();
+	voices[streaming_voice].set_output_sink(sink);
+	voices[streaming_voice].add_cycle_listener(sink);
+}
+
+void gendy::stop_recording() {
+	if(!recorder || !recorder->is_recording())
+		return;
+	voices[recording_voice].remove_cycle_listener(recorder);
+	recorder->stop();
+	if(recorder->get_dropped_cycles())
+		print_log("gendy~: the trace is missing %d cycles",
+				(int)recorder->get_dropped_cycles(), LOG_ERROR);
+}
+
+void gendy::stop_streaming() {
+	if(!sink || !sink->is_open())
+		return;
+	voices[streaming_voice].set_output_sink(NULL);
+	voices[streaming_voice].remove_cycle_listener(sink);
+	sink->close();
+}
+
+// spectrum N [ARRAY] | spectrum 0
+//
+// works out the first N harmonic magnitudes of each of the selected
+// voice's cycles from its breakpoints (exact for linear interpolation, see
+// spectrum.h) and writes them to ARRAY, or sends them out of the last
+// outlet as "spectrum m1 m2 ...". either happens at most once a block
+void gendy::set_spectrum(short argc, t_atom *argv) {
+	if(argc < 1 || argc > 2 || !CanbeInt(argv[0]) || GetAInt(argv[0]) < 0 ||
+			(argc == 2 && !IsSymbol(argv[1]))) {
+		print_log("gendy~: usage: spectrum harmonics [array]", LOG_ERROR);
+		return;
+	}
+	stop_spectrum();
+	unsigned int harmonics = GetAInt(argv[0]);
+	if(harmonics == 0)
+		return;
+	if(harmonics > cycle_spectrum::max_harmonics)
+		print_log("gendy~: the spectrum goes up to harmonic %d",
+				(int)cycle_spectrum::max_harmonics, LOG_ERROR);
+	if(argc == 2) {
+		spectrum_buf = new buffer(GetSymbol(argv[1]));
+		if(!spectrum_buf->Ok()) {
+			print_log("gendy~: buffer not valid", LOG_ERROR);
+			delete spectrum_buf;
+			spectrum_buf = NULL;
+			return;
+		}
+	}
+	if(!spectrum)
+		spectrum = new cycle_spectrum();
+	spectrum->set_harmonics(harmonics);
+	spectrum->take_update();
+	spectrum_voice = target_begin();
+	if(!voices[spectrum_voice].add_cycle_listener(spectrum))
+		print_log("gendy~: too many listeners on voice %d",
+				(int)spectrum_voice, LOG_ERROR);
+}
+
+void gendy::stop_spectrum() {
+	if(spectrum)
+		voices[spectrum_voice].remove_cycle_listener(spectrum);
+	delete spectrum_buf;
+	spectrum_buf = NULL;
+}
+
+// called from m_signal once a cycle has gone by. an array can be written
+// right here, as tabwrite~ does, but a message has to be queued
+void gendy::output_spectrum() {
+	unsigned int harmonics = spectrum->get_harmonics();
+	const float *magnitudes = spectrum->get_magnitudes();
+	if(spectrum_buf) {
+		if(!spectrum_buf->Ok())
+			return;
+		flext::buffer::lock_t state = spectrum_buf->Lock();
+		int frames = spectrum_buf->Frames();
+		for(int n = 0; n < frames; ++n)
+			(*spectrum_buf)[n] = n < (int)harmonics ? magnitudes[n] : 0;
+		spectrum_buf->Dirty(true);
+		spectrum_buf->Unlock(state);
+		return;
+	}
+	t_atom args[cycle_spectrum::max_harmonics];
+	for(unsigned int n = 0; n < harmonics; ++n)
+		SetFloat(args[n], magnitudes[n]);
+	ToQueueAnything(num_outputs, MakeSymbol("spectrum"), harmonics, args);
+}
+
+void gendy::stop_replay() {
+	if(!player)
+		return;
+	if(voices[replaying_voice].get_breakpoint_source() == player)
+		voices[replaying_voice].set_breakpoint_source(NULL);
+	player->stop();
+}
+
+// first and one-past-last voice that messages currently apply to
+unsigned int gendy::target_begin() const {
+	return selected_voice < 0 ? 0 : selected_voice;
+}
+
+unsigned int gendy::target_end() const {
+	return selected_voice < 0 ? num_voices : selected_voice + 1;
 }
 
 void gendy::redraw() {
+	GENDY_TRACE_SCOPE("redraw", 0);
 	int n = 0;
 	gendysamp_t *temp_buf;
 
@@ -232,12 +1316,14 @@ void gendy::redraw() {
 	int bufsize = display_buf->Frames();
 	temp_buf = new gendysamp_t[bufsize];
 	//TODO: this is not threadsafe. wavelength could change.
+	// with all voices selected, show the first one
+	gendy_waveform &waveform = voices[target_begin()];
 	int wavelength = waveform.get_wavelength();
 	waveform.get_cycle(temp_buf, bufsize);
 	// here we copy from the raw float array to the flext buffer object
 	for(; n < wavelength && n < bufsize; ++n)
 		(*display_buf)[n] = temp_buf[n];
-	delete temp_buf;
+	delete[] temp_buf;
 	// zero out the rest of the buffer
 	while(n < bufsize)
 		(*display_buf)[n++]= 0;
@@ -245,5 +1331,42 @@ void gendy::redraw() {
 	display_buf->Unlock(state);
 }
 
+// sends the instrumentation counters out the stats outlet, one
+// "name value..." message each, then resets them. times are in microseconds
+void gendy::output_stats() {
+#if GENDY_STATS
+	gendy_stats wave_stats;
+	for(unsigned int v = 0; v < num_voices; ++v)
+		wave_stats.add(voices[v].get_stats());
+	int outlet = num_outputs;
+	t_atom args[2];
+
+	SetFloat(args[0], block_stats.blocks);
+	ToOutAnything(outlet, MakeSymbol("blocks"), 1, args);
+	SetFloat(args[0], block_stats.blocks ?
+			block_stats.block_time / 1000.0 / block_stats.blocks : 0);
+	ToOutAnything(outlet, MakeSymbol("block_avg"), 1, args);
+	SetFloat(args[0], block_stats.worst_block_time / 1000.0);
+	ToOutAnything(outlet, MakeSymbol("block_max"), 1, args);
+	SetFloat(args[0], wave_stats.segments);
+	ToOutAnything(outlet, MakeSymbol("segments"), 1, args);
+	SetFloat(args[0], wave_stats.cycles);
+	SetFloat(args[1], wave_stats.move_time / 1000.0);
+	ToOutAnything(outlet, MakeSymbol("move"), 2, args);
+	SetFloat(args[0], wave_stats.centers);
+	SetFloat(args[1], wave_stats.center_time / 1000.0);
+	ToOutAnything(outlet, MakeSymbol("center"), 2, args);
+	SetFloat(args[0], wave_stats.resizes);
+	ToOutAnything(outlet, MakeSymbol("resizes"), 1, args);
+
+	block_stats.reset();
+	for(unsigned int v = 0; v < num_voices; ++v)
+		voices[v].reset_stats();
+#else
+	print_log("gendy~: built without GENDY_STATS, no statistics available",
+			LOG_ERROR);
+#endif
+}
+
 //register the gendy class as a PD or Max object
-FLEXT_NEW_DSP("gendy~", gendy)
+FLEXT_NEW_DSP_V("gendy~", gendy)
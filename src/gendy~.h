@@ -36,6 +36,13 @@
 #ifndef GENDY_H
 #define GENDY_H
 #include "gendy_waveform.h"
+#include "preset_bank.h"
+#include "bptrace.h"
+#include "governor.h"
+#include "shm_sink.h"
+#include "spectrum.h"
+#include "modulation.h"
+#include "voice_allocator.h"
 //
 // gendy~ version 0.6.0:
 const int GENDY_MAJ = 0;
@@ -48,7 +55,7 @@ class gendy:  public flext_dsp {
 	FLEXT_HEADER_S(gendy, flext_dsp, class_setup)
 
 	public:
-		gendy();	
+		gendy(int argc, t_atom *argv);
 		~gendy();
 	
 	protected:
@@ -56,25 +63,58 @@ class gendy:  public flext_dsp {
 		virtual void m_signal(int n, float *const *in, float *const *out);
 
 		// Message handling functions
-		void set_frequency(float new_freq);
+		void set_frequency(short argc, t_atom *argv);
 		void set_num_breakpoints(float num_breakpoints);
-		void set_h_step(float new_stepsize);
-		void set_v_step(float new_stepsize);
-		void set_h_pull(float new_pull);
-		void set_v_pull(float new_pull);
+		void set_h_step(short argc, t_atom *argv);
+		void set_v_step(short argc, t_atom *argv);
+		void set_h_pull(short argc, t_atom *argv);
+		void set_v_pull(short argc, t_atom *argv);
 		void set_interpolation_lin();
 		void set_interpolation_cubic();
 		void set_interpolation_spline();
 		void set_interpolation_sinc();
+		void set_interpolation_additive();
 		void set_waveform_flat();
 		void set_waveform_sine();
 		void set_waveform_square();
+		void set_distribution(short argc, t_atom *argv);
 		void set_debug(int new_debug);
 		void set_outbuf(short argc, t_atom *argv);
 		void redraw();
+		void output_stats();
+		void select_voice(short argc, t_atom *argv);
+		void open_bank(short argc, t_atom *argv);
+		void store_preset(int slot);
+		void recall_preset(int slot);
+		void copy_voice(int source, int dest);
+		void set_seed(int seed);
+		void advance(int cycles);
+		void set_oversampling(short argc, t_atom *argv);
+		void trace(short argc, t_atom *argv);
+		void set_governor(float budget);
+		void set_cache(short argc, t_atom *argv);
+		void freeze(short argc, t_atom *argv);
+		void record(short argc, t_atom *argv);
+		void replay(short argc, t_atom *argv);
+		void stream(short argc, t_atom *argv);
+		void set_spectrum(short argc, t_atom *argv);
+		void set_gain(short argc, t_atom *argv);
+		void set_dc_block(short argc, t_atom *argv);
+		void set_soft_clip(short argc, t_atom *argv);
+		void modulate(short argc, t_atom *argv);
+		void note(short argc, t_atom *argv);
+		void release(short argc, t_atom *argv);
+		void set_steal_policy(short argc, t_atom *argv);
 
 	private:	
-		gendy_waveform waveform;
+		// voice state, stored contiguously. each voice has its own outlet
+		gendy_waveform *voices;
+		unsigned int num_voices;
+		// reserved storage for every voice's breakpoints
+		char *pool_storage;
+		unsigned int max_breakpoints;
+		// voice that messages apply to, or -1 for all of them
+		int selected_voice;
 		static bool debug;
 		// class-wide variable to keep track of how many objects exist
 		static unsigned int gendy_count;
@@ -84,29 +124,130 @@ class gendy:  public flext_dsp {
 		// waveform display buffer variables
 		// buffer to copy to for waveform display
 		flext::buffer *display_buf;
+
+		// preset bank for store/recall, see preset_bank.h
+		preset_bank presets;
+		// breakpoint trace recording and replay, see bptrace.h. made on
+		// first use, one voice at a time each
+		trace_recorder *recorder;
+		unsigned int recording_voice;
+		trace_player *player;
+		unsigned int replaying_voice;
+		// shared memory output of one voice, see shm_sink.h. made on first
+		// use
+		shm_sink *sink;
+		unsigned int streaming_voice;
+		// harmonic magnitudes of one voice's cycles, see spectrum.h. made
+		// on first use. they go to spectrum_buf if it's set, otherwise out
+		// of the last outlet
+		cycle_spectrum *spectrum;
+		unsigned int spectrum_voice;
+		flext::buffer *spectrum_buf;
+		// audio outlets. the outlet after them is the info outlet
+		unsigned int num_outputs;
+		// with -poly, hands the voices out to notes, and they're mixed into
+		// the one audio outlet a block of mix_buffer at a time. NULL
+		// otherwise
+		voice_allocator *allocator;
+		static const unsigned int mix_block_size = 64;
+		gendysamp_t mix_buffer[mix_block_size];
+		// couples the voices' sources to each others' parameters, see
+		// modulation.h. made on first use
+		modulation_matrix *modulation;
+		// where "trace stop" writes to, if "trace start" named a file
+		const t_symbol *trace_file;
+		// recalls and copies wait in voice_changes for the DSP method, which
+		// makes them before the next block, so the voices' breakpoint lists
+		// only change on the audio thread. a recall's snapshot is read out of
+		// the bank beforehand, into its voice's slot of staged_states (made
+		// on first use), which stays busy until it's been loaded
+		enum voice_change_t { RECALL_VOICE, COPY_VOICE };
+		struct voice_change {
+			voice_change_t type;
+			// the preset slot of a recall
+			unsigned int source;
+			unsigned int dest;
+			size_t length;
+		};
+		spsc_ring<voice_change> voice_changes;
+		char *staged_states;
+		size_t staged_state_size;
+		std::atomic<bool> *recall_waiting;
+		// Pd's logical time at the end of the last block, which is where
+		// the block about to be rendered starts for the messages that come
+		// in before it
+		double next_block_time;
+		// lowers the voices' quality when the blocks take too long
+		quality_governor governor;
+		bool governing;
+#if GENDY_STATS
+		// per-block timing, the waveform keeps the rest of the counters
+		gendy_stats block_stats;
+#endif
 		
 		// Internal class methods
 		static void class_setup(t_classid thisclass);
 		void set_interpolation(interpolation_t interpolation);
 		void set_waveform(waveshape_t waveform);
+		unsigned int target_begin() const;
+		unsigned int target_end() const;
+		void stop_recording();
+		void stop_replay();
+		void stop_streaming();
+		void stop_spectrum();
+		void output_spectrum();
+		void render_poly(float *out, int n);
+		void apply_voice_changes();
+		bool get_block_offset(unsigned int &offset) const;
+		bool get_ramped_value(short argc, t_atom *argv, const char *usage,
+				float &value, unsigned int &ramp);
+		bool schedule_change(unsigned int v, scheduled_param_t param,
+				float value, unsigned int ramp);
+		void set_note_level(unsigned int v, float level);
 
 		// register the callbacks, and tell flext their calling format
-		FLEXT_CALLBACK_F(set_frequency)
+		FLEXT_CALLBACK_V(set_frequency)
 		FLEXT_CALLBACK_I(set_num_breakpoints)
-		FLEXT_CALLBACK_F(set_h_step)
-		FLEXT_CALLBACK_F(set_v_step)
-		FLEXT_CALLBACK_F(set_h_pull)
-		FLEXT_CALLBACK_F(set_v_pull)
+		FLEXT_CALLBACK_V(set_h_step)
+		FLEXT_CALLBACK_V(set_v_step)
+		FLEXT_CALLBACK_V(set_h_pull)
+		FLEXT_CALLBACK_V(set_v_pull)
 		FLEXT_CALLBACK(set_interpolation_lin)
 		FLEXT_CALLBACK(set_interpolation_cubic)
 		FLEXT_CALLBACK(set_interpolation_spline)
 		FLEXT_CALLBACK(set_interpolation_sinc)
+		FLEXT_CALLBACK(set_interpolation_additive)
 		FLEXT_CALLBACK(set_waveform_flat)
 		FLEXT_CALLBACK(set_waveform_sine)
 		FLEXT_CALLBACK(set_waveform_square)
+		FLEXT_CALLBACK_V(set_distribution)
 		FLEXT_CALLBACK_I(set_debug)
 		FLEXT_CALLBACK_V(set_outbuf)
 		FLEXT_CALLBACK(redraw)
+		FLEXT_CALLBACK(output_stats)
+		FLEXT_CALLBACK_V(select_voice)
+		FLEXT_CALLBACK_V(open_bank)
+		FLEXT_CALLBACK_I(store_preset)
+		FLEXT_CALLBACK_I(recall_preset)
+		FLEXT_CALLBACK_II(copy_voice)
+		FLEXT_CALLBACK_I(set_seed)
+		FLEXT_CALLBACK_I(advance)
+		FLEXT_CALLBACK_V(set_oversampling)
+		FLEXT_CALLBACK_V(trace)
+		FLEXT_CALLBACK_F(set_governor)
+		FLEXT_CALLBACK_V(set_cache)
+		FLEXT_CALLBACK_V(freeze)
+		FLEXT_CALLBACK_V(record)
+		FLEXT_CALLBACK_V(replay)
+		FLEXT_CALLBACK_V(stream)
+		FLEXT_CALLBACK_V(set_spectrum)
+		FLEXT_CALLBACK_V(set_gain)
+		FLEXT_CALLBACK_V(set_dc_block)
+		FLEXT_CALLBACK_V(set_soft_clip)
+		FLEXT_CALLBACK_V(modulate)
+		FLEXT_CALLBACK_V(note)
+		FLEXT_CALLBACK_V(release)
+		FLEXT_CALLBACK_V(set_steal_policy)
 };
 unsigned int gendy::gendy_count = 0;
 bool gendy::debug = true;
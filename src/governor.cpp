@@ -0,0 +1,93 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#include "governor.h"
+
+// how quickly the smoothed load follows the measurements, per block
+static const float load_smoothing = 0.125;
+// time a new level gets before the next step down, in ns
+static const gendy_ticks_t settle_time = 50000000;
+// time the load has to stay low before a step back up, in ns
+static const gendy_ticks_t recover_time = 1000000000;
+// low means below this share of the budget
+static const float recover_ratio = 0.5;
+
+quality_governor::quality_governor(unsigned int max_level, float budget) {
+	this->max_level = max_level;
+	set_budget(budget);
+	reset();
+}
+
+void quality_governor::set_budget(float new_budget) {
+	budget = new_budget > 0 ? new_budget : 0.25;
+}
+
+float quality_governor::get_budget() const {
+	return budget;
+}
+
+void quality_governor::reset() {
+	load = 0;
+	level = 0;
+	time_at_level = 0;
+	time_relaxed = 0;
+}
+
+unsigned int quality_governor::update(gendy_ticks_t render_time,
+		gendy_ticks_t block_time) {
+	if(block_time == 0)
+		return level;
+	load += load_smoothing * ((float)render_time / block_time - load);
+	time_at_level += block_time;
+
+	if(load > budget) {
+		time_relaxed = 0;
+		if(level < max_level && time_at_level >= settle_time) {
+			++level;
+			time_at_level = 0;
+		}
+	}
+	else if(load < budget * recover_ratio) {
+		time_relaxed += block_time;
+		if(level > 0 && time_relaxed >= recover_time) {
+			--level;
+			time_at_level = 0;
+			time_relaxed = 0;
+		}
+	}
+	else
+		time_relaxed = 0;
+	return level;
+}
+
+unsigned int quality_governor::get_level() const {
+	return level;
+}
+
+float quality_governor::get_load() const {
+	return load;
+}
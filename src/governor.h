@@ -0,0 +1,65 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include "stats.h"
+
+// Picks a quality level (see gendy_waveform::set_quality_level()) from how
+// long each block took to render, against how long the block lasts.
+//
+// The load is the render time over the block's duration, smoothed over a
+// few blocks so a single spike doesn't count. Above the budget the level
+// goes down a step, once the last step has had time to show. It only comes
+// back up after the load has stayed below half the budget for a second,
+// so it doesn't flap between two levels.
+class quality_governor
+{
+	// share of the block's duration the renders may take
+	float budget;
+	float load;
+	unsigned int level;
+	unsigned int max_level;
+	// time spent at the current level, and below the budget
+	gendy_ticks_t time_at_level;
+	gendy_ticks_t time_relaxed;
+
+	public:
+	quality_governor(unsigned int max_level, float budget = 0.25);
+	void set_budget(float new_budget);
+	float get_budget() const;
+	// back to full quality
+	void reset();
+	// takes the measurement of one block and returns the level for the next
+	unsigned int update(gendy_ticks_t render_time, gendy_ticks_t block_time);
+	unsigned int get_level() const;
+	// the smoothed load, as a share of the block duration
+	float get_load() const;
+};
+
+#endif /* GOVERNOR_H */
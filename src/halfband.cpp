@@ -0,0 +1,130 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#include "halfband.h"
+#include "log.h"
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+// stopband attenuation the Kaiser window is designed for, in dB
+static const double stopband_attenuation = 90;
+
+// zeroth order modified Bessel function, for the Kaiser window
+static double bessel_i0(double x) {
+	double sum = 1;
+	double term = 1;
+	for(int k = 1; k < 50; ++k) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if(term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+halfband_decimator::halfband_decimator() {
+	set_taps(max_taps);
+}
+
+void halfband_decimator::set_taps(unsigned int num_taps) {
+	if(num_taps > max_taps || num_taps % 4 != 3) {
+		print_log("gendy~: halfband filters need 4k+3 taps, up to %d",
+				(int)max_taps, LOG_ERROR);
+		num_taps = max_taps;
+	}
+	num_coefs = (num_taps + 1) / 4;
+	double center = (num_taps - 1) / 2.0;
+	double beta = 0.1102 * (stopband_attenuation - 8.7);
+	double sum = 0;
+	for(unsigned int j = 0; j < num_coefs; ++j) {
+		// the taps at odd distances d from the center are sinc(d/2)/2
+		double d = 2 * j + 1;
+		double sinc = sin(M_PI * d / 2) / (M_PI * d);
+		double r = d / center;
+		coefs[j] = sinc * bessel_i0(beta * sqrt(1 - r * r)) / bessel_i0(beta);
+		sum += coefs[j];
+	}
+	// unity gain at DC: the pairs have to add up to the other half
+	for(unsigned int j = 0; j < num_coefs; ++j)
+		coefs[j] *= 0.25 / sum;
+	reset();
+}
+
+unsigned int halfband_decimator::get_taps() const {
+	return 4 * num_coefs - 1;
+}
+
+void halfband_decimator::reset() {
+	memset(even, 0, sizeof(even));
+	memset(odd, 0, sizeof(odd));
+}
+
+void halfband_decimator::process(const gendysamp_t *in, gendysamp_t *out,
+		unsigned int n) {
+	const unsigned int even_history = num_coefs - 1;
+	const unsigned int odd_history = 2 * num_coefs - 1;
+	while(n) {
+		unsigned int block = n < block_size ? n : block_size;
+		for(unsigned int i = 0; i < block; ++i) {
+			even[even_history + i] = in[2 * i];
+			odd[odd_history + i] = in[2 * i + 1];
+		}
+		// the last input goes with the odd phase, so the center tap is k
+		// samples back in the even phase, and the pairs straddle the odd
+		// sample k back as well
+		for(unsigned int i = 0; i < block; ++i)
+			out[i] = 0.5f * even[i];
+		for(unsigned int j = 0; j < num_coefs; ++j) {
+			const float coef = coefs[j];
+			const float *newer = odd + num_coefs + j;
+			const float *older = odd + num_coefs - 1 - j;
+			for(unsigned int i = 0; i < block; ++i)
+				out[i] += coef * (newer[i] + older[i]);
+		}
+		memmove(even, even + block, even_history * sizeof(float));
+		memmove(odd, odd + block, odd_history * sizeof(float));
+		in += 2 * block;
+		out += block;
+		n -= block;
+	}
+}
+
+unsigned int halfband_decimator::history_size() const {
+	return 3 * num_coefs - 2;
+}
+
+void halfband_decimator::get_history(float *dest) const {
+	memcpy(dest, even, (num_coefs - 1) * sizeof(float));
+	memcpy(dest + num_coefs - 1, odd, (2 * num_coefs - 1) * sizeof(float));
+}
+
+void halfband_decimator::set_history(const float *src) {
+	memcpy(even, src, (num_coefs - 1) * sizeof(float));
+	memcpy(odd, src + num_coefs - 1, (2 * num_coefs - 1) * sizeof(float));
+}
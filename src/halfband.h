@@ -0,0 +1,77 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#ifndef HALFBAND_H
+#define HALFBAND_H
+
+#include "types.h"
+#include <cstddef>
+
+// Decimate-by-2 halfband lowpass, for bringing oversampled audio back down
+// to the output rate.
+//
+// A halfband FIR with 4k+3 taps has every other tap zero apart from the
+// center one, which is 1/2. Split into its even and odd input phases (the
+// polyphase form) that leaves k+1 distinct coefficients applied to the odd
+// samples, each to a symmetric pair, and the center tap on the even ones, so
+// an output sample costs about k+1 multiplies. The taps are a Kaiser
+// windowed sinc, designed in set_taps().
+//
+// The filter works through the input in blocks of block_size output samples
+// and is written as plain loops over each block, which compilers vectorize.
+// All of its storage is inline, so it can live in a waveform's arena.
+class halfband_decimator
+{
+	public:
+	static const unsigned int max_taps = 47;
+	static const unsigned int block_size = 64;
+
+	private:
+	static const unsigned int max_coefs = (max_taps + 1) / 4;
+	// coefficients of the even phase, from the center outwards
+	float coefs[max_coefs];
+	unsigned int num_coefs;
+	// the inputs of the current block, split by phase, after the last few
+	// of the previous block
+	float even[max_coefs - 1 + block_size];
+	float odd[2 * max_coefs - 1 + block_size];
+
+	public:
+	halfband_decimator();
+	// num_taps has to be 4k+3, up to max_taps. clears the history
+	void set_taps(unsigned int num_taps);
+	unsigned int get_taps() const;
+	void reset();
+	// filters 2n samples from in into n samples in out. out may be in
+	void process(const gendysamp_t *in, gendysamp_t *out, unsigned int n);
+	// the input history, for snapshots
+	unsigned int history_size() const;
+	void get_history(float *dest) const;
+	void set_history(const float *src);
+};
+
+#endif /* HALFBAND_H */
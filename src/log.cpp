@@ -28,35 +28,68 @@
 
 
 #include "log.h"
+
+// building with GENDY_STANDALONE defined drops the flext dependency so the
+// library can be embedded in other hosts. messages go to stderr instead
+#ifdef GENDY_STANDALONE
+#include <cstdio>
+#define post(...) (fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#else
 #include <flext.h>
+#endif
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+
+static std::atomic<log_function_t> log_function(NULL);
+
+void set_log_function(log_function_t function) {
+  log_function = function;
+}
+
+// formats msg on the stack and hands it to the log function if one is set,
+// so a host can take messages from its audio thread without us touching
+// stdio or the console there
+static void emit(int level, const char *msg, ...) {
+  char message[256];
+  va_list args;
+  va_start(args, msg);
+  vsnprintf(message, sizeof(message), msg, args);
+  va_end(args);
+  log_function_t function = log_function;
+  if (function)
+    function(level, message);
+  else
+    post("%s", message);
+}
 
 // shows msg if allowed by LOG_LEVEL
 void print_log(const char *msg, int level){
   if (LOG_LEVEL >= level) {
-    post(msg);
+    emit(level, "%s", msg);
   }
 }
 
 void print_log(const char *msg, int arg1, int level){
   if (LOG_LEVEL >= level) {
-    post(msg, arg1);
+    emit(level, msg, arg1);
   }
 }
 
 void print_log(const char *msg, int arg1, int arg2, int arg3, int level) {
   if (LOG_LEVEL >= level) {
-    post(msg, arg1, arg2, arg3);
+    emit(level, msg, arg1, arg2, arg3);
   }
 }
 
 void print_log(const char *msg, unsigned int arg1, int level){
   if (LOG_LEVEL >= level) {
-    post(msg, arg1);
+    emit(level, msg, arg1);
   }
 }
 
 void print_log(const char *msg, float arg1, int level){
   if (LOG_LEVEL >= level) {
-    post(msg, arg1);
+    emit(level, msg, arg1);
   }
 }
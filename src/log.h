@@ -44,4 +44,9 @@ void print_log(const char *msg, int arg1, int arg2, int arg3, int level);
 void print_log(const char *msg, unsigned int arg1, int level);
 void print_log(const char *msg, float arg1, int level);
 
+// where the messages go instead of the console, each one formatted with its
+// level. NULL goes back to the console
+typedef void (*log_function_t)(int level, const char *message);
+void set_log_function(log_function_t function);
+
 #endif /* LOG_H */
@@ -0,0 +1,277 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "modulation.h"
+#include <cmath>
+
+// how far the frequency can be modulated either way, in octaves
+static const float max_octaves = 8;
+
+modulation_matrix::modulation_matrix(gendy_waveform *voices,
+		unsigned int num_voices) {
+	this->voices = voices;
+	this->num_voices = num_voices;
+	listeners = new voice_listener[num_voices];
+	sources = new float[num_voices * num_sources];
+	bases = new float[num_voices * num_targets];
+	stale = new bool[num_voices * num_targets];
+	sums = new float[num_voices * num_targets];
+	for(unsigned int v = 0; v < num_voices; ++v) {
+		listeners[v].matrix = this;
+		listeners[v].voice = v;
+	}
+	for(unsigned int i = 0; i < num_voices * num_sources; ++i)
+		sources[i] = 0;
+	for(unsigned int i = 0; i < num_voices * num_targets; ++i) {
+		bases[i] = 0;
+		stale[i] = false;
+		sums[i] = 0;
+	}
+	num_routes = 0;
+}
+
+modulation_matrix::~modulation_matrix() {
+	clear();
+	delete[] listeners;
+	delete[] sources;
+	delete[] bases;
+	delete[] stale;
+	delete[] sums;
+}
+
+bool modulation_matrix::set_route(unsigned int from,
+		modulation_source_t source, unsigned int to,
+		modulation_target_t target, float depth) {
+	if(from >= num_voices || to >= num_voices)
+		return false;
+	unsigned int n;
+	for(n = 0; n < num_routes; ++n) {
+		const route &r = routes[n];
+		if(r.from == from && r.source == source && r.to == to &&
+				r.target == target)
+			break;
+	}
+	if(n < num_routes) {
+		if(depth != 0) {
+			routes[n].depth = depth;
+			return true;
+		}
+		// the last route from a voice stops listening to it, and the last
+		// one into a target puts it back as it was
+		routes[n] = routes[--num_routes];
+		if(!count_from(from))
+			voices[from].remove_cycle_listener(&listeners[from]);
+		if(!count_into(to, target))
+			set_target(to, target, bases[to * num_targets + target]);
+		return true;
+	}
+	if(depth == 0)
+		return true;
+	if(num_routes == max_routes)
+		return false;
+	if(!count_from(from) &&
+			!voices[from].add_cycle_listener(&listeners[from]))
+		return false;
+	if(!count_into(to, target))
+		bases[to * num_targets + target] = get_target(to, target);
+	// until from's next cycle, its sources are measured from where it is
+	measure(voices[from].cycle_begin(), voices[from].cycle_end(),
+			voices[from].get_avg_wavelength(), sources + from * num_sources);
+	route &r = routes[num_routes++];
+	r.from = from;
+	r.source = source;
+	r.to = to;
+	r.target = target;
+	r.depth = depth;
+	return true;
+}
+
+void modulation_matrix::clear() {
+	while(num_routes) {
+		const route &r = routes[num_routes - 1];
+		set_route(r.from, r.source, r.to, r.target, 0);
+	}
+}
+
+unsigned int modulation_matrix::get_num_routes() const {
+	return num_routes;
+}
+
+void modulation_matrix::set_base(unsigned int voice,
+		modulation_target_t target, float value) {
+	if(voice >= num_voices || !is_modulated(voice, target))
+		return;
+	bases[voice * num_targets + target] = value;
+}
+
+bool modulation_matrix::is_modulated(unsigned int voice,
+		modulation_target_t target) const {
+	return count_into(voice, target) > 0;
+}
+
+// the length and mean amplitude are of the cycle as drawn with straight
+// lines, which is what the walk moves
+void modulation_matrix::measure(breakpoint_list_t::const_iterator begin,
+		breakpoint_list_t::const_iterator end, float average_wavelength,
+		float *values) {
+	double length = 0;
+	double area = 0;
+	breakpoint_list_t::const_iterator i = begin;
+	while(i != end) {
+		breakpoint_list_t::const_iterator next = i;
+		++next;
+		length += i->get_duration();
+		area += i->get_duration() *
+			(i->get_amplitude() + next->get_amplitude()) / 2;
+		i = next;
+	}
+	values[SOURCE_CYCLE_LENGTH] = average_wavelength > 0 ?
+		length / average_wavelength - 1 : 0;
+	values[SOURCE_MEAN_AMPLITUDE] = length > 0 ? area / length : 0;
+	values[SOURCE_BREAKPOINT_AMPLITUDE] = begin->get_amplitude();
+}
+
+void modulation_matrix::voice_listener::cycle_moved(
+		gendy_waveform &waveform) {
+	matrix->cycle_moved(voice, waveform);
+}
+
+// each target the voice feeds is summed over all the routes into it, with
+// the other voices' sources as they were at their last cycles
+void modulation_matrix::cycle_moved(unsigned int voice,
+		gendy_waveform &waveform) {
+	measure(waveform.cycle_begin(), waveform.cycle_end(),
+			waveform.get_avg_wavelength(), sources + voice * num_sources);
+	for(unsigned int n = 0; n < num_routes; ++n) {
+		if(routes[n].from != voice)
+			continue;
+		unsigned int i = routes[n].to * num_targets + routes[n].target;
+		stale[i] = true;
+		sums[i] = 0;
+	}
+	for(unsigned int n = 0; n < num_routes; ++n) {
+		const route &r = routes[n];
+		unsigned int i = r.to * num_targets + r.target;
+		if(stale[i])
+			sums[i] += r.depth * sources[r.from * num_sources + r.source];
+	}
+	for(unsigned int n = 0; n < num_routes; ++n) {
+		const route &r = routes[n];
+		unsigned int i = r.to * num_targets + r.target;
+		if(!stale[i])
+			continue;
+		stale[i] = false;
+		float value = bases[i];
+		float sum = sums[i];
+		switch(r.target) {
+			case TARGET_STEP_WIDTH:
+			case TARGET_STEP_HEIGHT:
+				value += sum;
+				if(value < 0)
+					value = 0;
+				break;
+			case TARGET_DURATION_PULL:
+			case TARGET_AMPLITUDE_PULL:
+				value += sum;
+				if(value < 0)
+					value = 0;
+				else if(value > 1)
+					value = 1;
+				break;
+			case TARGET_FREQUENCY:
+				if(sum > max_octaves)
+					sum = max_octaves;
+				else if(sum < -max_octaves)
+					sum = -max_octaves;
+				value /= exp2f(sum);
+				break;
+		}
+		set_target(r.to, r.target, value);
+	}
+}
+
+unsigned int modulation_matrix::count_from(unsigned int voice) const {
+	unsigned int count = 0;
+	for(unsigned int n = 0; n < num_routes; ++n)
+		if(routes[n].from == voice)
+			++count;
+	return count;
+}
+
+unsigned int modulation_matrix::count_into(unsigned int voice,
+		modulation_target_t target) const {
+	unsigned int count = 0;
+	for(unsigned int n = 0; n < num_routes; ++n)
+		if(routes[n].to == voice && routes[n].target == target)
+			++count;
+	return count;
+}
+
+float modulation_matrix::get_target(unsigned int voice,
+		modulation_target_t target) const {
+	const gendy_waveform &waveform = voices[voice];
+	switch(target) {
+		case TARGET_STEP_WIDTH:
+			return waveform.get_step_width();
+		case TARGET_STEP_HEIGHT:
+			return waveform.get_step_height();
+		case TARGET_DURATION_PULL:
+			return waveform.get_duration_pull();
+		case TARGET_AMPLITUDE_PULL:
+			return waveform.get_amplitude_pull();
+		case TARGET_FREQUENCY:
+			return waveform.get_avg_wavelength();
+	}
+	return 0;
+}
+
+// a new wavelength recenters the breakpoints, so it's only set when it has
+// actually changed
+void modulation_matrix::set_target(unsigned int voice,
+		modulation_target_t target, float value) {
+	gendy_waveform &waveform = voices[voice];
+	switch(target) {
+		case TARGET_STEP_WIDTH:
+			waveform.set_step_width(value);
+			break;
+		case TARGET_STEP_HEIGHT:
+			waveform.set_step_height(value);
+			break;
+		case TARGET_DURATION_PULL:
+			waveform.set_duration_pull(value);
+			break;
+		case TARGET_AMPLITUDE_PULL:
+			waveform.set_amplitude_pull(value);
+			break;
+		case TARGET_FREQUENCY:
+			if(value != waveform.get_avg_wavelength())
+				waveform.set_avg_wavelength(value);
+			break;
+	}
+}
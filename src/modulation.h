@@ -0,0 +1,128 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef MODULATION_H
+#define MODULATION_H
+
+#include "gendy_waveform.h"
+
+// what a voice's cycles modulate with, measured once a cycle: the cycle's
+// length relative to the average wavelength (0 at the average, 1 at twice
+// it), its mean amplitude, and the amplitude of its first breakpoint
+enum modulation_source_t { SOURCE_CYCLE_LENGTH, SOURCE_MEAN_AMPLITUDE,
+	SOURCE_BREAKPOINT_AMPLITUDE };
+
+// what gets modulated. the frequency is modulated in octaves
+enum modulation_target_t { TARGET_STEP_WIDTH, TARGET_STEP_HEIGHT,
+	TARGET_DURATION_PULL, TARGET_AMPLITUDE_PULL, TARGET_FREQUENCY };
+
+// Couples voices to each other, as GENDYN pieces do: a sparse set of routes
+// from a source of one voice to a target of another (or the same one),
+// each scaled by a depth. Every target is its unmodulated base value plus
+// the sum of the routes into it. Whenever a voice finishes a cycle, the
+// matrix measures it and works out the targets it feeds, right there in
+// the render loop, so they take effect from those voices' next cycles.
+//
+// It listens to the voices it routes from, so like any listener it has to
+// be changed from the thread that renders, or between blocks.
+class modulation_matrix
+{
+	public:
+	static const unsigned int max_routes = 32;
+	static const unsigned int num_sources = 3;
+	static const unsigned int num_targets = 5;
+
+	private:
+	struct route {
+		unsigned int from;
+		modulation_source_t source;
+		unsigned int to;
+		modulation_target_t target;
+		float depth;
+	};
+	// tells the matrix which voice a cycle came from
+	class voice_listener : public cycle_listener
+	{
+		public:
+		modulation_matrix *matrix;
+		unsigned int voice;
+		void cycle_moved(gendy_waveform &waveform);
+	};
+
+	gendy_waveform *voices;
+	unsigned int num_voices;
+	voice_listener *listeners;
+	route routes[max_routes];
+	unsigned int num_routes;
+	// the latest measurement of each voice's sources, num_sources a voice
+	float *sources;
+	// the unmodulated value of each voice's targets, num_targets a voice.
+	// only kept while there's a route into the target
+	float *bases;
+	// targets due to be worked out again while handling a cycle, and
+	// their sums of routes
+	bool *stale;
+	float *sums;
+
+	public:
+	modulation_matrix(gendy_waveform *voices, unsigned int num_voices);
+	~modulation_matrix();
+	// routes source of voice from to target of voice to, replacing any
+	// route between the two. a depth of 0 removes the route, and the
+	// target goes back to its base. returns false if the voices don't
+	// exist, there are max_routes already, or from has too many listeners
+	bool set_route(unsigned int from, modulation_source_t source,
+			unsigned int to, modulation_target_t target, float depth);
+	// removes every route
+	void clear();
+	unsigned int get_num_routes() const;
+	// sets the value a modulated target is modulated around, which is what
+	// setting the target directly should do while it's modulated. the
+	// frequency is given as the average wavelength. does nothing to
+	// targets without routes
+	void set_base(unsigned int voice, modulation_target_t target,
+			float value);
+	bool is_modulated(unsigned int voice, modulation_target_t target) const;
+	// measures the cycle from begin to end, end being the first breakpoint
+	// of the next cycle, into num_sources values
+	static void measure(breakpoint_list_t::const_iterator begin,
+			breakpoint_list_t::const_iterator end, float average_wavelength,
+			float *values);
+
+	private:
+	void cycle_moved(unsigned int voice, gendy_waveform &waveform);
+	unsigned int count_from(unsigned int voice) const;
+	unsigned int count_into(unsigned int voice,
+			modulation_target_t target) const;
+	float get_target(unsigned int voice, modulation_target_t target) const;
+	void set_target(unsigned int voice, modulation_target_t target,
+			float value);
+};
+
+#endif /* MODULATION_H */
@@ -0,0 +1,96 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "pool.h"
+#include "log.h"
+#include <new>
+#include <cassert>
+
+breakpoint_pool::breakpoint_pool(unsigned int capacity, void *storage) {
+	this->capacity = capacity;
+	used = 0;
+	free_list = NULL;
+	owns_storage = false;
+	this->storage = static_cast<char *>(storage);
+	if(capacity == 0)
+		return;
+	if(!this->storage) {
+		this->storage = new char[storage_size(capacity)];
+		owns_storage = true;
+	}
+	// chain every slot into the free list, first slot at the head
+	for(unsigned int i = capacity; i > 0; --i) {
+		free_slot *slot =
+			reinterpret_cast<free_slot *>(this->storage + (i - 1) * slot_size);
+		slot->next = free_list;
+		free_list = slot;
+	}
+}
+
+breakpoint_pool::~breakpoint_pool() {
+	if(owns_storage)
+		delete[] storage;
+}
+
+void *breakpoint_pool::allocate(size_t size) {
+	if(capacity == 0)
+		return ::operator new(size);
+	assert(size <= slot_size);
+	if(!free_list || size > slot_size) {
+		print_log("gendy~: breakpoint pool exhausted", LOG_ERROR);
+		throw std::bad_alloc();
+	}
+	free_slot *slot = free_list;
+	free_list = slot->next;
+	++used;
+	return slot;
+}
+
+void breakpoint_pool::deallocate(void *p, size_t /* size */) {
+	if(capacity == 0) {
+		::operator delete(p);
+		return;
+	}
+	free_slot *slot = static_cast<free_slot *>(p);
+	slot->next = free_list;
+	free_list = slot;
+	--used;
+}
+
+unsigned int breakpoint_pool::get_capacity() const {
+	return capacity;
+}
+
+unsigned int breakpoint_pool::get_available() const {
+	return capacity - used;
+}
+
+size_t breakpoint_pool::storage_size(unsigned int capacity) {
+	return capacity * slot_size;
+}
@@ -0,0 +1,109 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "breakpoint.h"
+#include <list>
+#include <cstddef>
+
+// breakpoint_pool hands out fixed-size slots for the nodes of a
+// waveform's breakpoint list. The slots live in one block of memory that is
+// either supplied by the caller or allocated once when the pool is created,
+// so adding and removing breakpoints never touches the heap.
+//
+// A pool with a capacity of 0 has no block and passes every request through
+// to operator new/delete.
+class breakpoint_pool
+{
+	// free slots are chained together through their first bytes
+	struct free_slot {
+		free_slot *next;
+	};
+
+	char *storage;
+	bool owns_storage;
+	unsigned int capacity;
+	unsigned int used;
+	free_slot *free_list;
+
+	// not copyable, the list nodes point into storage
+	breakpoint_pool(const breakpoint_pool &);
+	breakpoint_pool &operator=(const breakpoint_pool &);
+
+	public:
+	// big enough for a list node holding a breakpoint, rounded up so every
+	// slot stays aligned for any type
+	static const size_t slot_size = (sizeof(breakpoint) + 4 * sizeof(void *) +
+			sizeof(long double) - 1) / sizeof(long double) * sizeof(long double);
+
+	breakpoint_pool(unsigned int capacity, void *storage);
+	~breakpoint_pool();
+	void *allocate(size_t size);
+	void deallocate(void *slot, size_t size);
+	unsigned int get_capacity() const;
+	unsigned int get_available() const;
+	// number of bytes of storage a pool of the given capacity needs
+	static size_t storage_size(unsigned int capacity);
+};
+
+// minimal standard allocator that draws from a breakpoint_pool, for use with
+// std::list
+template <class T>
+class pool_allocator
+{
+	public:
+	typedef T value_type;
+	breakpoint_pool *pool;
+
+	pool_allocator(breakpoint_pool *pool) : pool(pool) {}
+	template <class U>
+	pool_allocator(const pool_allocator<U> &other) : pool(other.pool) {}
+	T *allocate(size_t n) {
+		return static_cast<T *>(pool->allocate(n * sizeof(T)));
+	}
+	void deallocate(T *p, size_t n) {
+		pool->deallocate(p, n * sizeof(T));
+	}
+};
+
+template <class T, class U>
+bool operator==(const pool_allocator<T> &a, const pool_allocator<U> &b) {
+	return a.pool == b.pool;
+}
+
+template <class T, class U>
+bool operator!=(const pool_allocator<T> &a, const pool_allocator<U> &b) {
+	return a.pool != b.pool;
+}
+
+typedef std::list<breakpoint, pool_allocator<breakpoint> > breakpoint_list_t;
+
+#endif /* POOL_H */
@@ -0,0 +1,184 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "preset_bank.h"
+#include "log.h"
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char bank_magic[4] = { 'G', 'D', 'Y', 'B' };
+static const uint32_t bank_version = 1;
+
+struct preset_bank_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t num_slots;
+	// bytes per slot, including the length word
+	uint32_t slot_size;
+};
+
+preset_bank::preset_bank() {
+	map = NULL;
+	map_size = 0;
+	num_slots = 0;
+	slot_size = 0;
+}
+
+preset_bank::~preset_bank() {
+	close();
+}
+
+bool preset_bank::create(const char *path, unsigned int num_slots,
+		unsigned int max_breakpoints) {
+	close();
+	if(num_slots == 0 || max_breakpoints == 0)
+		return false;
+	preset_bank_header header;
+	memcpy(header.magic, bank_magic, sizeof(header.magic));
+	header.version = bank_version;
+	header.num_slots = num_slots;
+	// round slots up to 8 bytes so every snapshot starts aligned
+	header.slot_size = (sizeof(uint32_t) +
+			gendy_waveform::max_state_size(max_breakpoints) + 7) / 8 * 8;
+
+	int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0) {
+		print_log("gendy~: can't create preset bank", LOG_ERROR);
+		return false;
+	}
+	// the slots are left as a hole in the file, which reads back as zeros,
+	// i.e. empty
+	off_t file_size = sizeof(header) + (off_t)header.num_slots * header.slot_size;
+	bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+		ftruncate(fd, file_size) == 0;
+	::close(fd);
+	if(!ok) {
+		print_log("gendy~: can't write preset bank", LOG_ERROR);
+		return false;
+	}
+	return open(path);
+}
+
+bool preset_bank::open(const char *path) {
+	close();
+	int fd = ::open(path, O_RDWR);
+	if(fd < 0) {
+		print_log("gendy~: can't open preset bank", LOG_ERROR);
+		return false;
+	}
+	struct stat info;
+	preset_bank_header header;
+	if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(header) ||
+			read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+			memcmp(header.magic, bank_magic, sizeof(header.magic)) != 0 ||
+			header.version != bank_version ||
+			header.slot_size <= sizeof(uint32_t) ||
+			(size_t)info.st_size < sizeof(header) +
+				(size_t)header.num_slots * header.slot_size) {
+		print_log("gendy~: not a valid preset bank", LOG_ERROR);
+		::close(fd);
+		return false;
+	}
+	map_size = info.st_size;
+	void *mapping = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+	::close(fd);
+	if(mapping == MAP_FAILED) {
+		print_log("gendy~: can't map preset bank", LOG_ERROR);
+		map_size = 0;
+		return false;
+	}
+	map = static_cast<char *>(mapping);
+	num_slots = header.num_slots;
+	slot_size = header.slot_size;
+	return true;
+}
+
+void preset_bank::close() {
+	if(map)
+		munmap(map, map_size);
+	map = NULL;
+	map_size = 0;
+	num_slots = 0;
+	slot_size = 0;
+}
+
+bool preset_bank::is_open() const {
+	return map != NULL;
+}
+
+unsigned int preset_bank::get_num_slots() const {
+	return num_slots;
+}
+
+char *preset_bank::slot(unsigned int index) const {
+	return map + sizeof(preset_bank_header) + (size_t)index * slot_size;
+}
+
+bool preset_bank::store(unsigned int index, const gendy_waveform &waveform) {
+	if(!map || index >= num_slots)
+		return false;
+	char *dest = slot(index);
+	uint32_t length = waveform.save_state(dest + sizeof(length),
+			slot_size - sizeof(length));
+	if(length == 0) {
+		print_log("gendy~: waveform too big for preset bank slot", LOG_ERROR);
+		return false;
+	}
+	memcpy(dest, &length, sizeof(length));
+	return true;
+}
+
+bool preset_bank::recall(unsigned int index, gendy_waveform &waveform) const {
+	if(!map || index >= num_slots)
+		return false;
+	const char *src = slot(index);
+	uint32_t length;
+	memcpy(&length, src, sizeof(length));
+	if(length == 0 || length > slot_size - sizeof(length))
+		return false;
+	return waveform.load_state(src + sizeof(length), length);
+}
+
+size_t preset_bank::read_snapshot(unsigned int index, void *dest,
+		size_t size) const {
+	if(!map || index >= num_slots)
+		return 0;
+	const char *src = slot(index);
+	uint32_t length;
+	memcpy(&length, src, sizeof(length));
+	if(length == 0 || length > slot_size - sizeof(length) || length > size)
+		return 0;
+	memcpy(dest, src + sizeof(length), length);
+	return length;
+}
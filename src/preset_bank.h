@@ -0,0 +1,79 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef PRESET_BANK_H
+#define PRESET_BANK_H
+
+#include "gendy_waveform.h"
+#include <cstddef>
+
+// A preset bank is a file of fixed-size slots, each holding one waveform
+// snapshot (see gendy_waveform::save_state()). The file is memory mapped,
+// so recalling a preset is a copy out of the page cache and a bank can
+// hold thousands of them without being read in up front.
+//
+// file layout: a preset_bank_header, then num_slots slots of slot_size
+// bytes. each slot starts with a 32 bit length (0 for an empty slot)
+// followed by the snapshot itself. native byte order, like the snapshots.
+class preset_bank
+{
+	char *map;
+	size_t map_size;
+	unsigned int num_slots;
+	unsigned int slot_size;
+
+	char *slot(unsigned int index) const;
+
+	// not copyable, we own the mapping
+	preset_bank(const preset_bank &);
+	preset_bank &operator=(const preset_bank &);
+
+	public:
+	preset_bank();
+	~preset_bank();
+	// creates a new, empty bank file with room for num_slots snapshots of
+	// waveforms with up to max_breakpoints breakpoints, and opens it
+	bool create(const char *path, unsigned int num_slots,
+			unsigned int max_breakpoints);
+	// opens an existing bank file
+	bool open(const char *path);
+	void close();
+	bool is_open() const;
+	unsigned int get_num_slots() const;
+	// saves waveform's state in slot index, replacing what was there
+	bool store(unsigned int index, const gendy_waveform &waveform);
+	// restores waveform from slot index. fails for an empty slot
+	bool recall(unsigned int index, gendy_waveform &waveform) const;
+	// copies the snapshot in slot index into dest, to be loaded later by
+	// the thread that renders the waveform. returns its length, or 0 for
+	// an empty slot or one that doesn't fit in size
+	size_t read_snapshot(unsigned int index, void *dest, size_t size) const;
+};
+
+#endif /* PRESET_BANK_H */
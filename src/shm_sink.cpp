@@ -0,0 +1,183 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "shm_sink.h"
+#include "log.h"
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint32_t power_of_two(size_t n) {
+	uint32_t capacity = 1;
+	while(capacity < n)
+		capacity <<= 1;
+	return capacity;
+}
+
+shm_sink::shm_sink() {
+	name[0] = '\0';
+	memory = NULL;
+	size = 0;
+	header = NULL;
+	audio = NULL;
+	cycles = NULL;
+	samples_seen = 0;
+}
+
+shm_sink::~shm_sink() {
+	close();
+}
+
+bool shm_sink::open(const char *new_name, float samplerate,
+		unsigned int max_breakpoints, size_t audio_capacity,
+		size_t cycle_capacity) {
+	close();
+	if(!shm_stream_name(new_name, name, sizeof(name))) {
+		print_log("gendy~: invalid shared memory name", LOG_ERROR);
+		name[0] = '\0';
+		return false;
+	}
+	uint32_t audio_slots = power_of_two(audio_capacity);
+	uint32_t cycle_slots = power_of_two(cycle_capacity);
+	size = shm_stream_size(audio_slots, cycle_slots, max_breakpoints);
+	// a fresh segment, so a reader still attached to an old one isn't
+	// pulled out from under it
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if(fd < 0) {
+		print_log("gendy~: can't create shared memory", LOG_ERROR);
+		name[0] = '\0';
+		return false;
+	}
+	if(ftruncate(fd, size) != 0) {
+		print_log("gendy~: can't size shared memory", LOG_ERROR);
+		::close(fd);
+		shm_unlink(name);
+		name[0] = '\0';
+		return false;
+	}
+	memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(memory == MAP_FAILED) {
+		print_log("gendy~: can't map shared memory", LOG_ERROR);
+		memory = NULL;
+		shm_unlink(name);
+		name[0] = '\0';
+		return false;
+	}
+
+	// the segment comes zeroed, so only the atomics need constructing
+	header = new(memory) shm_stream_header();
+	header->version = shm_stream_version;
+	header->header_size = sizeof(shm_stream_header);
+	header->samplerate = samplerate;
+	header->audio_capacity = audio_slots;
+	header->cycle_capacity = cycle_slots;
+	header->max_breakpoints = max_breakpoints;
+	header->cycle_slot_size = sizeof(shm_cycle) +
+		max_breakpoints * sizeof(shm_cycle_point);
+	audio = reinterpret_cast<float *>(static_cast<char *>(memory) +
+			sizeof(shm_stream_header));
+	cycles = reinterpret_cast<char *>(audio + audio_slots);
+	samples_seen = 0;
+	// readers take the magic to mean the rest is there
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(header->magic, shm_stream_magic, sizeof(header->magic));
+	return true;
+}
+
+void shm_sink::close() {
+	if(!memory)
+		return;
+	header->closed.store(1, std::memory_order_release);
+	munmap(memory, size);
+	shm_unlink(name);
+	memory = NULL;
+	header = NULL;
+	audio = NULL;
+	cycles = NULL;
+	name[0] = '\0';
+}
+
+bool shm_sink::is_open() const {
+	return memory != NULL;
+}
+
+unsigned long long shm_sink::get_dropped_samples() const {
+	return header ? header->dropped_samples.load(std::memory_order_relaxed) : 0;
+}
+
+unsigned long long shm_sink::get_dropped_cycles() const {
+	return header ? header->dropped_cycles.load(std::memory_order_relaxed) : 0;
+}
+
+// blocks go in whole or not at all, so the reader only ever sees gaps
+// between blocks
+void shm_sink::write_block(const gendysamp_t *block, unsigned int n) {
+	uint64_t write = header->audio_write.load(std::memory_order_relaxed);
+	uint64_t used = write - header->audio_read.load(std::memory_order_acquire);
+	samples_seen += n;
+	if(header->audio_capacity - used < n) {
+		header->dropped_samples.fetch_add(n, std::memory_order_relaxed);
+		return;
+	}
+	size_t offset = write & (header->audio_capacity - 1);
+	size_t first = header->audio_capacity - offset;
+	if(first > n)
+		first = n;
+	memcpy(audio + offset, block, first * sizeof(float));
+	memcpy(audio, block + first, (n - first) * sizeof(float));
+	header->audio_write.store(write + n, std::memory_order_release);
+}
+
+void shm_sink::cycle_moved(gendy_waveform &waveform) {
+	uint64_t write = header->cycle_write.load(std::memory_order_relaxed);
+	if(write - header->cycle_read.load(std::memory_order_acquire) ==
+			header->cycle_capacity) {
+		header->dropped_cycles.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	shm_cycle *cycle = reinterpret_cast<shm_cycle *>(cycles +
+			(write & (header->cycle_capacity - 1)) * header->cycle_slot_size);
+	shm_cycle_point *points = reinterpret_cast<shm_cycle_point *>(cycle + 1);
+	uint32_t n = 0;
+	breakpoint_list_t::const_iterator i;
+	for(i = waveform.cycle_begin();
+			i != waveform.cycle_end() && n < header->max_breakpoints; ++i, ++n) {
+		points[n].duration = i->get_duration();
+		points[n].amplitude = i->get_amplitude();
+	}
+	cycle->cycle_count = waveform.get_cycle_count();
+	cycle->sample_position = samples_seen;
+	cycle->num_breakpoints = n;
+	header->cycle_write.store(write + 1, std::memory_order_release);
+}
@@ -0,0 +1,75 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef SHM_SINK_H
+#define SHM_SINK_H
+
+#include "gendy_waveform.h"
+#include "shm_stream.h"
+
+// publishes a waveform's output as a shared-memory stream, see
+// shm_stream.h for the layout and the reader. set it as the waveform's
+// output sink and add it as a cycle listener after open(), and take it
+// away again before close(). writing never blocks, allocates or makes a
+// system call; what the reader hasn't made room for is dropped
+class shm_sink : public output_sink, public cycle_listener
+{
+	char name[256];
+	void *memory;
+	size_t size;
+	shm_stream_header *header;
+	float *audio;
+	char *cycles;
+	// samples given to write_block() so far, written or not
+	uint64_t samples_seen;
+
+	// not copyable, we own the segment
+	shm_sink(const shm_sink &);
+	shm_sink &operator=(const shm_sink &);
+
+	public:
+	shm_sink();
+	~shm_sink();
+	// creates the segment, replacing any stream of the same name. the
+	// capacities are rounded up to powers of two. cycles with more than
+	// max_breakpoints breakpoints are cut short
+	bool open(const char *name, float samplerate, unsigned int max_breakpoints,
+			size_t audio_capacity = 1 << 16, size_t cycle_capacity = 256);
+	// marks the stream closed for the reader and removes the name. a
+	// reader that's attached keeps its mapping until it lets go
+	void close();
+	bool is_open() const;
+	unsigned long long get_dropped_samples() const;
+	unsigned long long get_dropped_cycles() const;
+
+	void write_block(const gendysamp_t *block, unsigned int n);
+	void cycle_moved(gendy_waveform &waveform);
+};
+
+#endif /* SHM_SINK_H */
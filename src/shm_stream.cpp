@@ -0,0 +1,163 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "shm_stream.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+size_t shm_stream_size(uint32_t audio_capacity, uint32_t cycle_capacity,
+		uint32_t max_breakpoints) {
+	size_t slot_size = sizeof(shm_cycle) +
+		max_breakpoints * sizeof(shm_cycle_point);
+	return sizeof(shm_stream_header) + audio_capacity * sizeof(float) +
+		cycle_capacity * slot_size;
+}
+
+bool shm_stream_name(const char *name, char *dest, size_t size) {
+	size_t length = strlen(name);
+	bool slash = name[0] == '/';
+	if(length == 0 || length + (slash ? 1 : 2) > size)
+		return false;
+	if(!slash)
+		*(dest++) = '/';
+	memcpy(dest, name, length + 1);
+	return true;
+}
+
+shm_stream_reader::shm_stream_reader() {
+	memory = NULL;
+	size = 0;
+	header = NULL;
+	audio = NULL;
+	cycles = NULL;
+}
+
+shm_stream_reader::~shm_stream_reader() {
+	close();
+}
+
+bool shm_stream_reader::open(const char *name) {
+	close();
+	char path[256];
+	if(!shm_stream_name(name, path, sizeof(path)))
+		return false;
+	int fd = shm_open(path, O_RDWR, 0);
+	if(fd < 0)
+		return false;
+	struct stat info;
+	if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(shm_stream_header)) {
+		::close(fd);
+		return false;
+	}
+	size = info.st_size;
+	memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(memory == MAP_FAILED) {
+		memory = NULL;
+		return false;
+	}
+	header = static_cast<shm_stream_header *>(memory);
+	// the writer fills the magic in last
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(memcmp(header->magic, shm_stream_magic, sizeof(header->magic)) != 0 ||
+			header->version != shm_stream_version ||
+			header->header_size != sizeof(shm_stream_header) ||
+			(header->audio_capacity & (header->audio_capacity - 1)) ||
+			(header->cycle_capacity & (header->cycle_capacity - 1)) ||
+			header->cycle_slot_size != sizeof(shm_cycle) +
+				header->max_breakpoints * sizeof(shm_cycle_point) ||
+			size < shm_stream_size(header->audio_capacity,
+				header->cycle_capacity, header->max_breakpoints)) {
+		close();
+		return false;
+	}
+	audio = reinterpret_cast<float *>(static_cast<char *>(memory) +
+			sizeof(shm_stream_header));
+	cycles = reinterpret_cast<char *>(audio + header->audio_capacity);
+	return true;
+}
+
+void shm_stream_reader::close() {
+	if(memory)
+		munmap(memory, size);
+	memory = NULL;
+	header = NULL;
+	audio = NULL;
+	cycles = NULL;
+}
+
+bool shm_stream_reader::is_open() const {
+	return memory != NULL;
+}
+
+const shm_stream_header *shm_stream_reader::get_header() const {
+	return header;
+}
+
+bool shm_stream_reader::writer_closed() const {
+	return header->closed.load(std::memory_order_acquire) != 0;
+}
+
+size_t shm_stream_reader::peek_audio(const float *&samples) const {
+	uint64_t read = header->audio_read.load(std::memory_order_relaxed);
+	uint64_t available =
+		header->audio_write.load(std::memory_order_acquire) - read;
+	size_t offset = read & (header->audio_capacity - 1);
+	samples = audio + offset;
+	if(available > header->audio_capacity - offset)
+		available = header->audio_capacity - offset;
+	return available;
+}
+
+void shm_stream_reader::consume_audio(size_t n) {
+	header->audio_read.store(
+			header->audio_read.load(std::memory_order_relaxed) + n,
+			std::memory_order_release);
+}
+
+const shm_cycle *shm_stream_reader::peek_cycle() const {
+	uint64_t read = header->cycle_read.load(std::memory_order_relaxed);
+	if(header->cycle_write.load(std::memory_order_acquire) == read)
+		return NULL;
+	return reinterpret_cast<const shm_cycle *>(cycles +
+			(read & (header->cycle_capacity - 1)) * header->cycle_slot_size);
+}
+
+const shm_cycle_point *shm_stream_reader::cycle_points(const shm_cycle *cycle) {
+	return reinterpret_cast<const shm_cycle_point *>(cycle + 1);
+}
+
+void shm_stream_reader::consume_cycle() {
+	header->cycle_read.store(
+			header->cycle_read.load(std::memory_order_relaxed) + 1,
+			std::memory_order_release);
+}
@@ -0,0 +1,139 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef SHM_STREAM_H
+#define SHM_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+// Shared-memory streams: the audio of a voice and the breakpoints of each
+// of its cycles, published in a named POSIX shared memory segment for other
+// processes on the same machine (a scope, a recorder) to read as it's
+// rendered. shm_sink.h has the writing side. This file has the layout and
+// the reading side, and doesn't need the rest of libgendy, so a reader
+// only has to compile shm_stream.cpp.
+//
+// Segment layout: a shm_stream_header, then the audio ring of
+// audio_capacity floats, then the cycle ring of cycle_capacity slots of
+// cycle_slot_size bytes, each a shm_cycle followed by up to max_breakpoints
+// shm_cycle_points. Everything is in native byte order.
+//
+// Both rings have a single producer and a single consumer. The write
+// positions belong to the writer and the read positions to the reader;
+// they count up forever and wrap into the ring with a mask. When a ring is
+// full the writer drops what doesn't fit and counts it, it never waits for
+// the reader, and neither side makes a system call per block.
+
+static const char shm_stream_magic[4] = { 'G', 'D', 'Y', 'M' };
+static const uint16_t shm_stream_version = 1;
+
+struct shm_stream_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t header_size;
+	float samplerate;
+	// both powers of two
+	uint32_t audio_capacity;
+	uint32_t cycle_capacity;
+	uint32_t max_breakpoints;
+	uint32_t cycle_slot_size;
+	// set once the writer has gone
+	std::atomic<uint32_t> closed;
+	// the writer's and the reader's positions on separate cache lines, so
+	// they don't bounce between the two processes' cores
+	alignas(64) std::atomic<uint64_t> audio_write;
+	std::atomic<uint64_t> cycle_write;
+	std::atomic<uint64_t> dropped_samples;
+	std::atomic<uint64_t> dropped_cycles;
+	alignas(64) std::atomic<uint64_t> audio_read;
+	std::atomic<uint64_t> cycle_read;
+};
+
+struct shm_cycle {
+	// the waveform's cycle count once this cycle's breakpoints were set
+	uint64_t cycle_count;
+	// samples the writer had been given (written or dropped) before the
+	// block the cycle started in
+	uint64_t sample_position;
+	uint32_t num_breakpoints;
+	uint32_t reserved;
+};
+
+struct shm_cycle_point {
+	float duration;
+	float amplitude;
+};
+
+// bytes of segment for the given capacities
+size_t shm_stream_size(uint32_t audio_capacity, uint32_t cycle_capacity,
+		uint32_t max_breakpoints);
+// POSIX wants shared memory names to start with a slash. copies name into
+// dest, adding one if it's missing. returns false if it doesn't fit
+bool shm_stream_name(const char *name, char *dest, size_t size);
+
+// attaches to a stream another process is writing
+class shm_stream_reader
+{
+	void *memory;
+	size_t size;
+	shm_stream_header *header;
+	float *audio;
+	char *cycles;
+
+	// not copyable, we own the mapping
+	shm_stream_reader(const shm_stream_reader &);
+	shm_stream_reader &operator=(const shm_stream_reader &);
+
+	public:
+	shm_stream_reader();
+	~shm_stream_reader();
+	// returns false if there's no stream of that name or it isn't one
+	bool open(const char *name);
+	void close();
+	bool is_open() const;
+	const shm_stream_header *get_header() const;
+	// true once the writer has closed the stream. what's still in the
+	// rings can be read to the end
+	bool writer_closed() const;
+
+	// points samples at the oldest unread audio and returns how much of it
+	// there is in one piece, up to the end of the ring. the samples stay
+	// valid until they're consumed
+	size_t peek_audio(const float *&samples) const;
+	void consume_audio(size_t n);
+	// the oldest unread cycle, or NULL if there's none. its breakpoints
+	// follow it, see cycle_points(). valid until it's consumed
+	const shm_cycle *peek_cycle() const;
+	static const shm_cycle_point *cycle_points(const shm_cycle *cycle);
+	void consume_cycle();
+};
+
+#endif /* SHM_STREAM_H */
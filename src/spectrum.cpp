@@ -0,0 +1,87 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "spectrum.h"
+#include <cmath>
+
+cycle_spectrum::cycle_spectrum(unsigned int num_harmonics) {
+	set_harmonics(num_harmonics);
+	updated = false;
+}
+
+void cycle_spectrum::set_harmonics(unsigned int n) {
+	num_harmonics = n < max_harmonics ? n : max_harmonics;
+	for(unsigned int k = 0; k < max_harmonics; ++k)
+		magnitudes[k] = 0;
+}
+
+unsigned int cycle_spectrum::get_harmonics() const {
+	return num_harmonics;
+}
+
+bool cycle_spectrum::take_update() {
+	bool was_updated = updated;
+	updated = false;
+	return was_updated;
+}
+
+const float *cycle_spectrum::get_magnitudes() const {
+	return magnitudes;
+}
+
+void cycle_spectrum::cycle_moved(gendy_waveform &waveform) {
+	compute(waveform.cycle_begin(), waveform.cycle_end(), magnitudes,
+			num_harmonics);
+	updated = true;
+}
+
+void cycle_spectrum::compute(breakpoint_list_t::const_iterator begin,
+		breakpoint_list_t::const_iterator end, float *magnitudes,
+		unsigned int n) {
+	if(n > max_harmonics)
+		n = max_harmonics;
+	float real[max_harmonics];
+	float imag[max_harmonics];
+	double length;
+	linear_cycle_series(begin, end, real, imag, n, length);
+	if(length <= 0) {
+		for(unsigned int k = 0; k < n; ++k)
+			magnitudes[k] = 0;
+		return;
+	}
+	// the series leaves out the line from the first breakpoint to end,
+	// which repeated is a sawtooth. its harmonics go back in here
+	double rise = end->get_amplitude() - begin->get_amplitude();
+	for(unsigned int k = 0; k < n; ++k) {
+		double w = 2 * M_PI * (k + 1) / length;
+		double r = real[k];
+		double q = imag[k] + rise / (length * w);
+		magnitudes[k] = 2 * sqrt(r * r + q * q);
+	}
+}
@@ -0,0 +1,71 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "gendy_waveform.h"
+
+// Harmonic magnitudes of a cycle, worked out from its breakpoints instead
+// of by an FFT of the audio. They're exact for linear interpolation, from
+// the series in additive.h with the jump at the ends put back in. With
+// cubic interpolation they're those of the straight-line version of the
+// cycle, which is close as long as the segments are long against the
+// harmonics' periods.
+class cycle_spectrum : public cycle_listener
+{
+	public:
+	static const unsigned int max_harmonics = max_series_harmonics;
+
+	private:
+	unsigned int num_harmonics;
+	float magnitudes[max_harmonics];
+	// set by every cycle, cleared by take_update()
+	bool updated;
+
+	public:
+	cycle_spectrum(unsigned int num_harmonics = 32);
+	// up to max_harmonics
+	void set_harmonics(unsigned int n);
+	unsigned int get_harmonics() const;
+	// whether there's been a cycle since the last call
+	bool take_update();
+	// the magnitudes of the fundamental and the harmonics above it, as
+	// amplitudes. a full scale sine has a fundamental of 1
+	const float *get_magnitudes() const;
+
+	void cycle_moved(gendy_waveform &waveform);
+	// works out n magnitudes of the cycle from begin to end. end is the
+	// first breakpoint of the next cycle, which the last segment runs to
+	static void compute(breakpoint_list_t::const_iterator begin,
+			breakpoint_list_t::const_iterator end, float *magnitudes,
+			unsigned int n);
+};
+
+#endif /* SPECTRUM_H */
@@ -0,0 +1,118 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free ring buffer for one producer thread and one consumer thread,
+// for handing data between the audio thread and a helper thread without
+// locks or allocation. The storage is allocated once, when the ring is
+// made, or handed in by its owner. Neither side ever blocks: push() fails
+// when the ring is full and pop() when it's empty.
+template <class T>
+class spsc_ring
+{
+	T *slots;
+	// a power of two, so positions wrap with a mask
+	size_t capacity;
+	size_t mask;
+	bool owns_slots;
+	// free-running positions; written only by the consumer and producer
+	// respectively
+	std::atomic<size_t> read_position;
+	std::atomic<size_t> write_position;
+
+	// not copyable, we own the slots
+	spsc_ring(const spsc_ring &);
+	spsc_ring &operator=(const spsc_ring &);
+
+	public:
+	// room for at least min_capacity items
+	spsc_ring(size_t min_capacity) : read_position(0), write_position(0) {
+		capacity = 1;
+		while(capacity < min_capacity)
+			capacity <<= 1;
+		mask = capacity - 1;
+		slots = new T[capacity];
+		owns_slots = true;
+	}
+
+	// uses storage, which has to hold a power of two items, and outlive us
+	spsc_ring(T *storage, size_t capacity) :
+			read_position(0), write_position(0) {
+		slots = storage;
+		this->capacity = capacity;
+		mask = capacity - 1;
+		owns_slots = false;
+	}
+
+	~spsc_ring() {
+		if(owns_slots)
+			delete[] slots;
+	}
+
+	size_t get_capacity() const {
+		return capacity;
+	}
+
+	// producer side
+	size_t space() const {
+		return capacity - (write_position.load(std::memory_order_relaxed) -
+				read_position.load(std::memory_order_acquire));
+	}
+
+	bool push(const T &item) {
+		size_t write = write_position.load(std::memory_order_relaxed);
+		if(write - read_position.load(std::memory_order_acquire) == capacity)
+			return false;
+		slots[write & mask] = item;
+		write_position.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side
+	size_t available() const {
+		return write_position.load(std::memory_order_acquire) -
+			read_position.load(std::memory_order_relaxed);
+	}
+
+	bool pop(T &item) {
+		size_t read = read_position.load(std::memory_order_relaxed);
+		if(write_position.load(std::memory_order_acquire) == read)
+			return false;
+		item = slots[read & mask];
+		read_position.store(read + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,104 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef STATS_H
+#define STATS_H
+
+// DSP instrumentation. Build with -DGENDY_STATS=1 to compile it in. When
+// it's 0 the GENDY_STATS_* macros expand to nothing, so the counters cost
+// nothing in a normal build.
+#ifndef GENDY_STATS
+#define GENDY_STATS 0
+#endif
+
+#include <chrono>
+
+typedef unsigned long long gendy_ticks_t;
+
+// returns a monotonic timestamp in nanoseconds
+inline gendy_ticks_t gendy_clock() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// counters collected per instance. times are in nanoseconds
+struct gendy_stats {
+	// blocks rendered, their total and worst-case render time
+	unsigned long blocks;
+	gendy_ticks_t block_time;
+	gendy_ticks_t worst_block_time;
+	// how many segment boundaries and full cycles were crossed
+	unsigned long segments;
+	unsigned long cycles;
+	// time spent in move_breakpoints() and center_breakpoints()
+	gendy_ticks_t move_time;
+	unsigned long centers;
+	gendy_ticks_t center_time;
+	// breakpoints added or removed by set_num_breakpoints()
+	unsigned long resizes;
+
+	gendy_stats() { reset(); }
+	// accumulate another instance's counters into this one
+	void add(const gendy_stats &other) {
+		blocks += other.blocks;
+		block_time += other.block_time;
+		if(other.worst_block_time > worst_block_time)
+			worst_block_time = other.worst_block_time;
+		segments += other.segments;
+		cycles += other.cycles;
+		move_time += other.move_time;
+		centers += other.centers;
+		center_time += other.center_time;
+		resizes += other.resizes;
+	}
+	void reset() {
+		blocks = 0;
+		block_time = 0;
+		worst_block_time = 0;
+		segments = 0;
+		cycles = 0;
+		move_time = 0;
+		centers = 0;
+		center_time = 0;
+		resizes = 0;
+	}
+};
+
+#if GENDY_STATS
+#define GENDY_STATS_COUNT(stats, field) (++(stats).field)
+#define GENDY_STATS_START(start) gendy_ticks_t start = gendy_clock()
+#define GENDY_STATS_ADD_TIME(stats, field, start) \
+	((stats).field += gendy_clock() - (start))
+#else
+#define GENDY_STATS_COUNT(stats, field)
+#define GENDY_STATS_START(start)
+#define GENDY_STATS_ADD_TIME(stats, field, start)
+#endif
+
+#endif /* STATS_H */
@@ -0,0 +1,201 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#include "trace.h"
+#include "spsc_ring.h"
+#include "log.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// events a thread can have waiting for the collector
+static const size_t thread_ring_size = 1 << 14;
+// events kept per trace, about 32 MB worth. the rest are counted as lost
+static const size_t max_events = 1 << 20;
+// how often the collector empties the rings, in ms
+static const int collect_interval = 5;
+
+struct trace_record {
+	const char *name;
+	gendy_ticks_t start;
+	gendy_ticks_t end;
+	long arg;
+};
+
+// a thread's ring. made the first time the thread records an event and
+// never freed, as the thread may still be holding on to it
+struct trace_thread {
+	spsc_ring<trace_record> ring;
+	unsigned int id;
+	atomic<unsigned long> dropped;
+
+	trace_thread(unsigned int id) : ring(thread_ring_size), id(id),
+			dropped(0) {}
+};
+
+struct collected_event {
+	trace_record record;
+	unsigned int thread;
+};
+
+atomic<bool> gendy_trace_enabled(false);
+
+static thread_local trace_thread *local_thread = NULL;
+// every thread that has recorded anything
+static mutex threads_mutex;
+static vector<trace_thread *> threads;
+// start and stop may come from any instance
+static mutex control_mutex;
+static thread collector;
+static atomic<bool> collecting(false);
+static gendy_ticks_t trace_start_time;
+// only touched by the collector while it runs
+static vector<collected_event> events;
+static unsigned long lost_events;
+
+// moves everything in the rings into events. the collector is the only
+// consumer while it runs, and the control thread after it's been joined
+static void collect(bool keep) {
+	lock_guard<mutex> lock(threads_mutex);
+	for(size_t i = 0; i < threads.size(); ++i) {
+		collected_event event;
+		event.thread = threads[i]->id;
+		while(threads[i]->ring.pop(event.record)) {
+			if(!keep)
+				continue;
+			if(events.size() < max_events)
+				events.push_back(event);
+			else
+				++lost_events;
+		}
+	}
+}
+
+static void register_thread() {
+	lock_guard<mutex> lock(threads_mutex);
+	local_thread = new trace_thread(threads.size());
+	threads.push_back(local_thread);
+}
+
+static void run_collector() {
+	while(collecting.load(memory_order_acquire)) {
+		collect(true);
+		this_thread::sleep_for(chrono::milliseconds(collect_interval));
+	}
+}
+
+bool gendy_trace_start() {
+	lock_guard<mutex> lock(control_mutex);
+	if(gendy_trace_enabled)
+		return false;
+	// in Pd the messages and the audio come from the same thread, so that
+	// one doesn't have to allocate its ring on its first event
+	if(!local_thread)
+		register_thread();
+	// leftovers of events that were still open when the last trace stopped
+	collect(false);
+	{
+		lock_guard<mutex> threads_lock(threads_mutex);
+		for(size_t i = 0; i < threads.size(); ++i)
+			threads[i]->dropped = 0;
+	}
+	events.clear();
+	lost_events = 0;
+	trace_start_time = gendy_clock();
+	collecting = true;
+	collector = thread(run_collector);
+	gendy_trace_enabled = true;
+	return true;
+}
+
+bool gendy_trace_stop(const char *path) {
+	lock_guard<mutex> lock(control_mutex);
+	if(!gendy_trace_enabled)
+		return false;
+	gendy_trace_enabled = false;
+	collecting = false;
+	collector.join();
+	collect(true);
+
+	unsigned long dropped = lost_events;
+	unsigned int num_threads;
+	{
+		lock_guard<mutex> threads_lock(threads_mutex);
+		for(size_t i = 0; i < threads.size(); ++i)
+			dropped += threads[i]->dropped;
+		num_threads = threads.size();
+	}
+
+	FILE *file = fopen(path, "w");
+	if(!file) {
+		print_log("gendy~: can't create trace file", LOG_ERROR);
+		events.clear();
+		return false;
+	}
+	// complete ("X") events, in microseconds from the start of the trace
+	fprintf(file, "{\"traceEvents\":[\n");
+	for(unsigned int i = 0; i < num_threads; ++i)
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"tid\":%u,\"args\":{\"name\":\"gendy thread %u\"}},\n", i, i);
+	for(size_t i = 0; i < events.size(); ++i) {
+		const trace_record &record = events[i].record;
+		fprintf(file, "{\"name\":\"%s\",\"cat\":\"gendy\",\"ph\":\"X\","
+				"\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+				"\"args\":{\"n\":%ld}},\n", record.name,
+				((double)record.start - (double)trace_start_time) / 1000.0,
+				(record.end - record.start) / 1000.0, events[i].thread,
+				record.arg);
+	}
+	fprintf(file, "{\"name\":\"dropped events\",\"ph\":\"C\",\"ts\":0,"
+			"\"pid\":1,\"tid\":0,\"args\":{\"dropped\":%lu}}\n", dropped);
+	fprintf(file, "],\"displayTimeUnit\":\"ns\"}\n");
+	bool ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+	events.clear();
+	if(!ok)
+		print_log("gendy~: can't write trace file", LOG_ERROR);
+	if(dropped)
+		print_log("gendy~: the trace lost %d events", (int)dropped, LOG_ERROR);
+	return ok;
+}
+
+void gendy_trace_event(const char *name, gendy_ticks_t start,
+		gendy_ticks_t end, long arg) {
+	if(!local_thread)
+		register_thread();
+	trace_record record;
+	record.name = name;
+	record.start = start;
+	record.end = end;
+	record.arg = arg;
+	if(!local_thread->ring.push(record))
+		++local_thread->dropped;
+}
@@ -0,0 +1,87 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Event tracing, for finding out what was going on when the audio dropped
+// out. Build with -DGENDY_TRACE=1 to compile the trace points in; when it's
+// 0 the GENDY_TRACE_* macros expand to nothing, like the GENDY_STATS ones.
+//
+// Each thread that hits a trace point gets a lock-free ring of its own, so
+// recording an event is a couple of clock reads and a push. While a trace
+// is running a helper thread empties the rings, and gendy_trace_stop()
+// writes everything out as Chrome trace-event JSON, which chrome://tracing
+// and Perfetto open. Tracing is process wide, shared by all instances.
+#ifndef GENDY_TRACE
+#define GENDY_TRACE 0
+#endif
+
+#include "stats.h"
+#include <atomic>
+
+// starts collecting events. returns false if a trace is already running
+bool gendy_trace_start();
+// stops collecting and writes the events to path. returns false if there
+// was no trace running or the file couldn't be written
+bool gendy_trace_stop(const char *path);
+
+extern std::atomic<bool> gendy_trace_enabled;
+
+inline bool gendy_trace_running() {
+	return gendy_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// records an event that ran from start to end. name has to be a string
+// constant, only the pointer is kept. arg is shown with the event
+void gendy_trace_event(const char *name, gendy_ticks_t start,
+		gendy_ticks_t end, long arg);
+
+// records the span of the scope it's declared in, if a trace is running
+class gendy_trace_scope
+{
+	const char *name;
+	long arg;
+	gendy_ticks_t start;
+
+	public:
+	gendy_trace_scope(const char *name, long arg) : name(name), arg(arg) {
+		start = gendy_trace_running() ? gendy_clock() : 0;
+	}
+	~gendy_trace_scope() {
+		if(start)
+			gendy_trace_event(name, start, gendy_clock(), arg);
+	}
+};
+
+#if GENDY_TRACE
+#define GENDY_TRACE_SCOPE(name, arg) gendy_trace_scope trace_scope(name, arg)
+#else
+#define GENDY_TRACE_SCOPE(name, arg)
+#endif
+
+#endif /* TRACE_H */
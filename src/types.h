@@ -31,11 +31,14 @@
 #define TYPES_H
 
 // define interpolation types
-enum interpolation_t{ LINEAR, CUBIC, SPLINE, SINC };
+enum interpolation_t{ LINEAR, CUBIC, SPLINE, SINC, ADDITIVE };
 
 // define center waveform shapes
 enum waveshape_t { FLAT, SINE, SQUARE, TRIANGLE, SAWTOOTH };
 
+// define distributions the random steps are drawn from
+enum distribution_t { GAUSSIAN, CAUCHY, LOGISTIC, ARCSINE, HYPERBOLIC_COSINE };
+
 // define data types
 typedef float gendydur_t;
 typedef float gendyamp_t;
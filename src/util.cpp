@@ -29,22 +29,90 @@
 
 #include "util.h"
 #include <math.h>
-#include <cstdlib>
+#include <stdint.h>
+
+gendy_rng::gendy_rng(unsigned long long seed, unsigned long long voice) {
+	this->seed(seed, voice);
+}
+
+// splitmix64 finalizer, so that nearby seeds (0, 1, 2...) give unrelated keys
+static unsigned long long mix(unsigned long long z) {
+	z += 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+void gendy_rng::seed(unsigned long long seed, unsigned long long voice) {
+	key = mix(mix(seed) + voice);
+	stream = 0;
+	counter = 0;
+}
+
+unsigned long long gendy_rng::get_key() const {
+	return key;
+}
+
+void gendy_rng::set_key(unsigned long long new_key) {
+	key = new_key;
+}
+
+void gendy_rng::set_stream(unsigned long long new_stream) {
+	stream = new_stream;
+	counter = 0;
+}
+
+unsigned long long gendy_rng::get_stream() const {
+	return stream;
+}
+
+unsigned long long gendy_rng::get_counter() const {
+	return counter;
+}
+
+void gendy_rng::set_position(unsigned long long new_stream,
+		unsigned long long new_counter) {
+	stream = new_stream;
+	counter = new_counter;
+}
+
+// one Philox4x32 block of (counter, stream) under key, ten rounds. we only
+// use half of the 128 bit output, which keeps the state to three words
+unsigned long long gendy_rng::next() {
+	uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32);
+	uint32_t c2 = (uint32_t)stream, c3 = (uint32_t)(stream >> 32);
+	uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+	for(int round = 0; round < 10; ++round) {
+		uint64_t p0 = (uint64_t)0xD2511F53 * c0;
+		uint64_t p1 = (uint64_t)0xCD9E8D57 * c2;
+		uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c1 = (uint32_t)p1;
+		c3 = (uint32_t)p0;
+		c0 = n0;
+		c2 = n2;
+		k0 += 0x9E3779B9;
+		k1 += 0xBB67AE85;
+	}
+	++counter;
+	return ((unsigned long long)c1 << 32) | c0;
+}
 
 // return a uniformly distributed double-precision float between 0 and 1
-double randf() {
-	return rand() / (double)RAND_MAX;
+double randf(gendy_rng &rng) {
+	// top 53 bits, so the result fits a double exactly
+	return (rng.next() >> 11) * (1.0 / 9007199254740991.0);
 }
 
 // returns gaussian random variable with mu 0 and sigma 1
 // From the GNU Scientific Library, src/randist/gauss.c
 
-double gauss() {
+double gauss(gendy_rng &rng) {
 	double x, y, r2;
 	do {
 		/* choose x,y in uniform square (-1,-1) to (+1,+1) */
-		x = -1 + 2 * randf();
-		y = -1 + 2 * randf();
+		x = -1 + 2 * randf(rng);
+		y = -1 + 2 * randf(rng);
 
 		/* see if it is in the unit circle */
 		r2 = x * x + y * y;
@@ -54,6 +122,6 @@ double gauss() {
 	return y * sqrt (-2.0 * log(r2) / r2);
 }
 
-int round(float num) {
+int round_int(float num) {
 	return int(floor(num + 0.5));
 }
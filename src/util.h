@@ -32,14 +32,40 @@
 
 // misc utility functions
 
+// per-instance random number generator. It's counter based (Philox4x32-10):
+// every number is a function of the key, a stream index and a counter, with
+// no hidden history, so any point in a sequence can be reached directly by
+// setting the stream and counter. Waveforms key it per voice and use the
+// cycle index as the stream, which makes each cycle's random walk depend
+// only on the seed, the voice and the cycle.
+class gendy_rng
+{
+	unsigned long long key;
+	unsigned long long stream;
+	unsigned long long counter;
+
+	public:
+	gendy_rng(unsigned long long seed = 1, unsigned long long voice = 0);
+	void seed(unsigned long long seed, unsigned long long voice = 0);
+	unsigned long long get_key() const;
+	void set_key(unsigned long long new_key);
+	// starts drawing from the beginning of stream
+	void set_stream(unsigned long long new_stream);
+	unsigned long long get_stream() const;
+	unsigned long long get_counter() const;
+	void set_position(unsigned long long new_stream,
+			unsigned long long new_counter);
+	unsigned long long next();
+};
+
 // return a uniformly distributed double-precision float between 0 and 1
-double randf();
+double randf(gendy_rng &rng);
 
 // returns gaussian random variable with mu 0 and sigma 1
 // From the GNU Scientific Library, src/randist/gauss.c, released under GPL
-double gauss();
+double gauss(gendy_rng &rng);
 
 // returns nearest integer. X.5 always rounded to X+1, so it's non-symmetrical
-int round(float num);
+int round_int(float num);
 
 #endif /* UTIL_H */
@@ -0,0 +1,155 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#include "voice_allocator.h"
+
+voice_allocator::voice_allocator(unsigned int num_voices,
+		steal_policy_t policy) {
+	this->num_voices = num_voices ? num_voices : 1;
+	this->policy = policy;
+	slots = new voice_slot[this->num_voices];
+	notes = 0;
+	for(unsigned int v = 0; v < this->num_voices; ++v) {
+		slots[v].id = -1;
+		slots[v].active = false;
+		slots[v].held = false;
+		slots[v].starting = false;
+		slots[v].started = 0;
+		slots[v].level = 0;
+	}
+}
+
+voice_allocator::~voice_allocator() {
+	delete[] slots;
+}
+
+void voice_allocator::set_policy(steal_policy_t new_policy) {
+	policy = new_policy;
+}
+
+steal_policy_t voice_allocator::get_policy() const {
+	return policy;
+}
+
+unsigned int voice_allocator::note_on(int id, float level, bool &was_idle) {
+	int found = find(id);
+	unsigned int voice = found >= 0 ? found : pick_voice();
+	voice_slot &slot = slots[voice];
+	was_idle = !slot.active;
+	if(was_idle)
+		slot.starting = true;
+	slot.id = id;
+	slot.active = true;
+	slot.held = true;
+	slot.started = ++notes;
+	slot.level = level;
+	return voice;
+}
+
+int voice_allocator::note_off(int id) {
+	for(unsigned int v = 0; v < num_voices; ++v) {
+		if(slots[v].held && slots[v].id == id) {
+			slots[v].held = false;
+			return v;
+		}
+	}
+	return -1;
+}
+
+int voice_allocator::find(int id) const {
+	for(unsigned int v = 0; v < num_voices; ++v)
+		if(slots[v].active && slots[v].id == id)
+			return v;
+	return -1;
+}
+
+void voice_allocator::release_all() {
+	for(unsigned int v = 0; v < num_voices; ++v)
+		slots[v].held = false;
+}
+
+void voice_allocator::set_idle(unsigned int voice) {
+	if(voice >= num_voices)
+		return;
+	slots[voice].id = -1;
+	slots[voice].active = false;
+	slots[voice].held = false;
+	slots[voice].starting = false;
+}
+
+bool voice_allocator::is_active(unsigned int voice) const {
+	return voice < num_voices && slots[voice].active;
+}
+
+bool voice_allocator::is_releasing(unsigned int voice) const {
+	return voice < num_voices && slots[voice].active && !slots[voice].held;
+}
+
+bool voice_allocator::take_start(unsigned int voice) {
+	if(voice >= num_voices || !slots[voice].starting)
+		return false;
+	slots[voice].starting = false;
+	return true;
+}
+
+unsigned int voice_allocator::get_num_active() const {
+	unsigned int active = 0;
+	for(unsigned int v = 0; v < num_voices; ++v)
+		if(slots[v].active)
+			++active;
+	return active;
+}
+
+// an idle voice, or the best one to steal: releasing voices before held
+// ones, then by the policy
+unsigned int voice_allocator::pick_voice() const {
+	unsigned int best = 0;
+	for(unsigned int v = 0; v < num_voices; ++v) {
+		const voice_slot &slot = slots[v];
+		if(!slot.active)
+			return v;
+		const voice_slot &other = slots[best];
+		if(slot.held != other.held) {
+			if(!slot.held)
+				best = v;
+		}
+		else if(policy == STEAL_QUIETEST ? quieter(slot, other) :
+				slot.started < other.started)
+			best = v;
+	}
+	return best;
+}
+
+// ties go to the older note
+bool voice_allocator::quieter(const voice_slot &a,
+		const voice_slot &b) const {
+	if(a.level != b.level)
+		return a.level < b.level;
+	return a.started < b.started;
+}
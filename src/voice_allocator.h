@@ -0,0 +1,97 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+#ifndef VOICE_ALLOCATOR_H
+#define VOICE_ALLOCATOR_H
+
+// which voice goes when a note needs one and they're all busy: the one
+// that started longest ago, or the one playing at the lowest level
+enum steal_policy_t { STEAL_OLDEST, STEAL_QUIETEST };
+
+// Hands out a fixed number of voices to notes, by the note ids they're
+// started and released with. A voice is idle, held by its note, or
+// releasing, i.e. fading out after its note was released; whoever renders
+// the voices says when that's done with set_idle(). Only held and releasing
+// voices need rendering.
+//
+// A new note takes an idle voice if there is one, otherwise it steals a
+// releasing voice, and only failing that a held one, by the policy in both
+// cases. Everything is allocated by the constructor, and the rest takes
+// time in proportion to the number of voices, so it's fit for the thread
+// that renders.
+class voice_allocator
+{
+	struct voice_slot {
+		int id;
+		bool active;
+		bool held;
+		// given a note while idle, and not rendered since
+		bool starting;
+		// when the note started, in notes since construction
+		unsigned long long started;
+		float level;
+	};
+	voice_slot *slots;
+	unsigned int num_voices;
+	unsigned long long notes;
+	steal_policy_t policy;
+
+	public:
+	voice_allocator(unsigned int num_voices,
+			steal_policy_t policy = STEAL_OLDEST);
+	~voice_allocator();
+	void set_policy(steal_policy_t new_policy);
+	steal_policy_t get_policy() const;
+	// the voice note id plays on at level. a note that's already playing,
+	// or still releasing, keeps its voice. was_idle says whether the voice
+	// wasn't playing anything, otherwise it's either the note's own or was
+	// stolen from another note
+	unsigned int note_on(int id, float level, bool &was_idle);
+	// starts releasing note id's voice and returns it, or -1 if the note
+	// isn't held
+	int note_off(int id);
+	// the voice playing note id, held or releasing, or -1
+	int find(int id) const;
+	// releases every held note
+	void release_all();
+	// the voice has faded out and is free again
+	void set_idle(unsigned int voice);
+	bool is_active(unsigned int voice) const;
+	bool is_releasing(unsigned int voice) const;
+	// whether the voice was idle when it got its note and hasn't been
+	// asked since, so it can be started afresh before rendering it
+	bool take_start(unsigned int voice);
+	unsigned int get_num_active() const;
+
+	private:
+	unsigned int pick_voice() const;
+	bool quieter(const voice_slot &a, const voice_slot &b) const;
+};
+
+#endif /* VOICE_ALLOCATOR_H */
@@ -0,0 +1,417 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+// gendy-latency - measures how long each DSP tick of a gendy~ takes while
+// it's hammered with control messages, to tell whether a build and a
+// configuration can be trusted not to glitch. gendy~.cpp is built against
+// the host shim in tools/shim instead of flext, and driven the way Pd's
+// scheduler drives it: the messages due before a block, then the block,
+// all on one thread.
+//
+// The control traffic is chosen to hit the expensive paths: frequency
+// sweeps (recentering), breakpoint counts jumping between 1 and the
+// maximum (resizing), interpolation switches (guard points) and bursts of
+// redraws. Each tick's time is recorded, and the distribution is written
+// out as JSON: percentiles, the worst tick, how many ticks missed the
+// block's deadline, a log2 histogram and the number of heap allocations
+// made inside the DSP method, which should be 0.
+//
+// see the README for how to build it.
+//
+// e.g. 20 seconds of 4 voices at 64 samples per block:
+//
+//   ./gendy-latency -voices 4 -seconds 20 -o latency.json
+//
+// run with -help for the full list of options.
+
+#include <flext.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <new>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+
+using namespace std;
+
+// heap allocations, counted only while counting is on. thread local, so
+// the helper threads gendy~ may start don't count
+static thread_local bool counting_allocations = false;
+static thread_local unsigned long allocations = 0;
+
+// the replacements get their memory from malloc() and give it back to
+// free() through these two, so the compiler never sees a pointer from new
+// going straight to free()
+static void *allocate(size_t size) {
+	if(counting_allocations)
+		++allocations;
+	void *p = malloc(size ? size : 1);
+	if(!p)
+		throw bad_alloc();
+	return p;
+}
+
+static void release(void *p) {
+	free(p);
+}
+
+void *operator new(size_t size) {
+	return allocate(size);
+}
+
+void *operator new[](size_t size) {
+	return allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+	release(p);
+}
+
+void operator delete[](void *p) noexcept {
+	release(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	release(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	release(p);
+}
+
+enum traffic_kind { SWEEP = 1, JUMPS = 2, SWITCHES = 4, REDRAWS = 8 };
+
+struct latency_options {
+	float samplerate;
+	unsigned int blocksize;
+	double seconds;
+	unsigned int voices;
+	unsigned int max_breakpoints;
+	unsigned int traffic;
+	unsigned long long seed;
+	const char *output;
+};
+
+// per-tick times in nanoseconds, and what's reported about them
+struct latency_summary {
+	double p50;
+	double p99;
+	double p999;
+	double max;
+	double mean;
+	double stddev;
+	unsigned long overruns;
+	// ticks per power of two of nanoseconds
+	vector<unsigned long> histogram;
+};
+
+static uint64_t clock_ns() {
+	return chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift, so the traffic is the same for the same seed everywhere
+static uint64_t next_random(uint64_t &state) {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static double uniform(uint64_t &state) {
+	return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void send(flext_base *object, const char *selector,
+		const vector<t_atom> &args) {
+	if(!object->CbMethodHandler(0, flext::MakeSymbol(selector), args.size(),
+				args.data()))
+		fprintf(stderr, "gendy-latency: gendy~ didn't take '%s'\n", selector);
+}
+
+static t_atom float_atom(float value) {
+	t_atom atom;
+	flext::SetFloat(atom, value);
+	return atom;
+}
+
+static t_atom symbol_atom(const char *value) {
+	t_atom atom;
+	flext::SetSymbol(atom, flext::MakeSymbol(value));
+	return atom;
+}
+
+// sends the messages due before the given block. returns how many
+static unsigned int send_traffic(flext_base *object,
+		const latency_options &options, unsigned long block,
+		uint64_t &random) {
+	unsigned int sent = 0;
+	// a new frequency every block, log uniform over 20 Hz to 10 kHz
+	if(options.traffic & SWEEP) {
+		float frequency = 20 * pow(500.0, uniform(random));
+		send(object, "freq", vector<t_atom>(1, float_atom(frequency)));
+		++sent;
+	}
+	// from 1 breakpoint to all of them and back, about 20 times a second
+	if((options.traffic & JUMPS) && block % 32 == 0) {
+		float count = (block / 32) % 2 ? options.max_breakpoints : 1;
+		send(object, "breakpoints", vector<t_atom>(1, float_atom(count)));
+		++sent;
+	}
+	if((options.traffic & SWITCHES) && block % 8 == 0) {
+		send(object, (block / 8) % 2 ? "linear" : "cubic", vector<t_atom>());
+		++sent;
+	}
+	// a burst of redraws, as from a GUI that's fallen behind
+	if((options.traffic & REDRAWS) && block % 16 == 0) {
+		for(int i = 0; i < 16; ++i)
+			send(object, "redraw", vector<t_atom>());
+		sent += 16;
+	}
+	return sent;
+}
+
+static latency_summary summarize(vector<uint64_t> &times, double deadline) {
+	latency_summary summary;
+	sort(times.begin(), times.end());
+	size_t n = times.size();
+	summary.p50 = times[(n - 1) * 50 / 100];
+	summary.p99 = times[(n - 1) * 99 / 100];
+	summary.p999 = times[(n - 1) * 999 / 1000];
+	summary.max = times[n - 1];
+	double sum = 0, squares = 0;
+	summary.overruns = 0;
+	for(size_t i = 0; i < n; ++i) {
+		sum += times[i];
+		squares += (double)times[i] * times[i];
+		if(times[i] > deadline)
+			++summary.overruns;
+		unsigned int bucket = 0;
+		while(bucket < 63 && (1ull << (bucket + 1)) <= times[i])
+			++bucket;
+		if(summary.histogram.size() <= bucket)
+			summary.histogram.resize(bucket + 1, 0);
+		++summary.histogram[bucket];
+	}
+	summary.mean = sum / n;
+	summary.stddev = sqrt(max(0.0, squares / n - summary.mean * summary.mean));
+	return summary;
+}
+
+static void write_summary(FILE *out, const char *name,
+		const latency_summary &summary) {
+	fprintf(out, "  \"%s\": {\n", name);
+	fprintf(out, "    \"p50_ns\": %.0f,\n", summary.p50);
+	fprintf(out, "    \"p99_ns\": %.0f,\n", summary.p99);
+	fprintf(out, "    \"p99.9_ns\": %.0f,\n", summary.p999);
+	fprintf(out, "    \"max_ns\": %.0f,\n", summary.max);
+	fprintf(out, "    \"mean_ns\": %.1f,\n", summary.mean);
+	fprintf(out, "    \"jitter_ns\": %.1f,\n", summary.stddev);
+	fprintf(out, "    \"overruns\": %lu,\n", summary.overruns);
+	// [lowest time in the bucket, ticks], the bucket runs to twice that
+	fprintf(out, "    \"histogram\": [");
+	bool first = true;
+	for(size_t bucket = 0; bucket < summary.histogram.size(); ++bucket) {
+		if(!summary.histogram[bucket])
+			continue;
+		fprintf(out, "%s[%llu, %lu]", first ? "" : ", ", 1ull << bucket,
+				summary.histogram[bucket]);
+		first = false;
+	}
+	fprintf(out, "]\n  }");
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: gendy-latency [options]\n"
+		"  -seconds S         length of the run (default 10)\n"
+		"  -samplerate R      (default 44100)\n"
+		"  -blocksize N       samples per tick (default 64)\n"
+		"  -voices N          voices of the gendy~ (default 1)\n"
+		"  -maxbreakpoints N  and the top of the breakpoint jumps (default 4096)\n"
+		"  -traffic LIST      comma separated: sweep, jumps, switches,\n"
+		"                     redraws, all or none (default all)\n"
+		"  -seed N            traffic and random walk seed (default 1)\n"
+		"  -o FILE            JSON output (default stdout)\n");
+}
+
+static bool parse_traffic(const char *text, unsigned int &traffic) {
+	traffic = 0;
+	string list = text;
+	size_t start = 0;
+	while(start <= list.size()) {
+		size_t end = list.find(',', start);
+		if(end == string::npos)
+			end = list.size();
+		string kind = list.substr(start, end - start);
+		if(kind == "sweep")
+			traffic |= SWEEP;
+		else if(kind == "jumps")
+			traffic |= JUMPS;
+		else if(kind == "switches")
+			traffic |= SWITCHES;
+		else if(kind == "redraws")
+			traffic |= REDRAWS;
+		else if(kind == "all")
+			traffic |= SWEEP | JUMPS | SWITCHES | REDRAWS;
+		else if(kind != "none")
+			return false;
+		start = end + 1;
+	}
+	return true;
+}
+
+static bool parse_options(int argc, char **argv, latency_options &options) {
+	options.samplerate = 44100;
+	options.blocksize = 64;
+	options.seconds = 10;
+	options.voices = 1;
+	options.max_breakpoints = 4096;
+	options.traffic = SWEEP | JUMPS | SWITCHES | REDRAWS;
+	options.seed = 1;
+	options.output = NULL;
+
+	for(int i = 1; i < argc; ++i) {
+		string option = argv[i];
+		if(i + 1 >= argc)
+			return false;
+		const char *value = argv[++i];
+		if(option == "-seconds")
+			options.seconds = atof(value);
+		else if(option == "-samplerate")
+			options.samplerate = atof(value);
+		else if(option == "-blocksize")
+			options.blocksize = atoi(value);
+		else if(option == "-voices")
+			options.voices = atoi(value);
+		else if(option == "-maxbreakpoints")
+			options.max_breakpoints = atoi(value);
+		else if(option == "-traffic") {
+			if(!parse_traffic(value, options.traffic))
+				return false;
+		}
+		else if(option == "-seed")
+			options.seed = strtoull(value, NULL, 10);
+		else if(option == "-o")
+			options.output = value;
+		else
+			return false;
+	}
+	return options.seconds > 0 && options.samplerate > 0 &&
+		options.blocksize > 0 && options.voices > 0 &&
+		options.max_breakpoints > 0;
+}
+
+int main(int argc, char **argv) {
+	latency_options options;
+	if(!parse_options(argc, argv, options)) {
+		usage();
+		return 1;
+	}
+
+	vector<t_atom> args;
+	args.push_back(symbol_atom("-voices"));
+	args.push_back(float_atom(options.voices));
+	args.push_back(symbol_atom("-maxbreakpoints"));
+	args.push_back(float_atom(options.max_breakpoints));
+	args.push_back(symbol_atom("seed"));
+	args.push_back(float_atom(options.seed));
+	flext_base *object = shim_factory::create("gendy~", args.size(), args.data());
+	if(!object) {
+		fprintf(stderr, "gendy-latency: couldn't make a gendy~\n");
+		return 1;
+	}
+	flext_dsp *dsp = static_cast<flext_dsp *>(object);
+	dsp->shim_sr = options.samplerate;
+	dsp->shim_bs = options.blocksize;
+	send(object, "table", vector<t_atom>(1, symbol_atom("gendy-latency")));
+
+	vector<vector<float> > buffers(options.voices,
+			vector<float>(options.blocksize));
+	vector<float *> outputs;
+	for(unsigned int v = 0; v < options.voices; ++v)
+		outputs.push_back(&buffers[v][0]);
+
+	unsigned long blocks = (unsigned long)
+		(options.seconds * options.samplerate / options.blocksize);
+	if(blocks == 0)
+		blocks = 1;
+	// all the memory the run needs is taken up front
+	vector<uint64_t> dsp_times(blocks);
+	vector<uint64_t> tick_times(blocks);
+	uint64_t random = options.seed * 2654435761u + 1;
+	unsigned long messages = 0;
+	unsigned long dsp_allocations = 0;
+
+	for(unsigned long block = 0; block < blocks; ++block) {
+		uint64_t tick_start = clock_ns();
+		messages += send_traffic(object, options, block, random);
+		uint64_t dsp_start = clock_ns();
+		counting_allocations = true;
+		dsp->shim_dsp(options.blocksize, NULL, &outputs[0]);
+		counting_allocations = false;
+		uint64_t end = clock_ns();
+		dsp_times[block] = end - dsp_start;
+		tick_times[block] = end - tick_start;
+		flext::shim_time() += options.blocksize / options.samplerate;
+	}
+	dsp_allocations = allocations;
+	delete object;
+
+	double deadline = 1e9 * options.blocksize / options.samplerate;
+	latency_summary dsp_summary = summarize(dsp_times, deadline);
+	latency_summary tick_summary = summarize(tick_times, deadline);
+
+	FILE *out = options.output ? fopen(options.output, "w") : stdout;
+	if(!out) {
+		fprintf(stderr, "gendy-latency: can't open %s\n", options.output);
+		return 1;
+	}
+	fprintf(out, "{\n");
+	fprintf(out, "  \"samplerate\": %g,\n", options.samplerate);
+	fprintf(out, "  \"blocksize\": %u,\n", options.blocksize);
+	fprintf(out, "  \"voices\": %u,\n", options.voices);
+	fprintf(out, "  \"max_breakpoints\": %u,\n", options.max_breakpoints);
+	fprintf(out, "  \"blocks\": %lu,\n", blocks);
+	fprintf(out, "  \"control_messages\": %lu,\n", messages);
+	fprintf(out, "  \"deadline_ns\": %.0f,\n", deadline);
+	fprintf(out, "  \"dsp_allocations\": %lu,\n", dsp_allocations);
+	// the DSP method alone, and the whole tick with the messages before it
+	write_summary(out, "dsp", dsp_summary);
+	fprintf(out, ",\n");
+	write_summary(out, "tick", tick_summary);
+	fprintf(out, "\n}\n");
+	if(out != stdout)
+		fclose(out);
+	return 0;
+}
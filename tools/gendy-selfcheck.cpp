@@ -0,0 +1,359 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+// gendy-selfcheck - checks that every way of getting to a point of a render
+// gets there exactly: that the random walk's counter based generator can
+// be jumped to any draw, that seeking with checkpoint_renderer plays the
+// same samples as rendering straight through, and that a snapshot saved
+// and loaded and advance_samples(), across scheduled changes and ramps,
+// leave the waveform where rendering would have. Each is run with the cycle
+// cache off and on, and with oversampling, and the samples are compared
+// bit for bit. Additive rendering is the exception: wherever it's picked
+// up in the middle of a cycle its oscillators start from the cycle's
+// series rather than from where they'd have turned to, which is only the
+// same to within rounding. It prints a line per check and exits with 1 if
+// any of them failed.
+//
+// see the README for how to build it.
+//
+// e.g. with a longer render and another seed:
+//
+//   ./gendy-selfcheck -samples 200000 -seed 7
+//
+// run with -help for the full list of options.
+
+#include "gendy_waveform.h"
+#include "checkpoint_renderer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+struct selfcheck_options {
+	unsigned long samples;
+	unsigned int blocksize;
+	unsigned long long seed;
+};
+
+// the waveform settings each check is run with
+struct selfcheck_config {
+	const char *name;
+	interpolation_t interpolation;
+	unsigned int oversampling;
+	unsigned int cache_interval;
+	float cache_threshold;
+	// how far samples may differ, 0 for not in any bit
+	float tolerance;
+};
+
+static const selfcheck_config configs[] = {
+	{ "cubic", CUBIC, 1, 0, 0, 0 },
+	{ "cubic, cache 3", CUBIC, 1, 3, 0, 0 },
+	{ "linear, cache 16 threshold 0.05", LINEAR, 1, 16, 0.05f, 0 },
+	{ "cubic, oversampling 4", CUBIC, 4, 0, 0, 0 },
+	{ "additive", ADDITIVE, 1, 0, 0, 1e-5f },
+};
+static const unsigned int num_configs = sizeof(configs) / sizeof(configs[0]);
+
+static const unsigned int max_breakpoints = 64;
+static const unsigned long long checkpoint_interval = 4410;
+// samples compared after each seek, advance or load
+static const unsigned int compared_samples = 4096;
+
+static unsigned int failures = 0;
+
+static void report(const char *check, const char *config, bool passed,
+		const string &detail) {
+	printf("%s  %s (%s)%s%s\n", passed ? "ok  " : "FAIL", check, config,
+			detail.empty() ? "" : ": ", detail.c_str());
+	if(!passed)
+		++failures;
+}
+
+// the first sample where a and b differ by more than tolerance, or in any
+// bit if it's 0, or n if they don't
+static unsigned int first_difference(const gendysamp_t *a,
+		const gendysamp_t *b, unsigned int n, float tolerance) {
+	for(unsigned int i = 0; i < n; ++i) {
+		if(tolerance ? fabs(a[i] - b[i]) > tolerance :
+				memcmp(&a[i], &b[i], sizeof(gendysamp_t)) != 0)
+			return i;
+	}
+	return n;
+}
+
+static string difference_detail(unsigned long long position,
+		unsigned int at, unsigned int n) {
+	if(at == n)
+		return "";
+	char detail[80];
+	snprintf(detail, sizeof(detail), "differs at sample %llu",
+			position + at);
+	return detail;
+}
+
+static void configure(gendy_waveform &waveform, const selfcheck_config &config,
+		unsigned long long seed) {
+	waveform.set_seed(seed);
+	waveform.set_num_breakpoints(12);
+	waveform.set_avg_wavelength(157.3f);
+	waveform.set_interpolation(config.interpolation);
+	waveform.set_oversampling(config.oversampling);
+	waveform.set_cache_interval(config.cache_interval);
+	waveform.set_cache_threshold(config.cache_threshold);
+	waveform.set_duration_distribution(CAUCHY);
+	// from the very start, as checkpoint_renderer has them
+	waveform.commit_changes();
+}
+
+// the same changes on every waveform of a check, with and without ramps, so
+// they land in the middle of blocks, cycles and each other's ramps
+static void schedule_changes(gendy_waveform &waveform, unsigned long samples) {
+	waveform.schedule(samples / 8 + 37, SCHEDULE_FREQUENCY, 100, 0);
+	waveform.schedule(samples / 5 + 11, SCHEDULE_GAIN, 0.5f, 1000);
+	waveform.schedule(samples / 4 + 3, SCHEDULE_STEP_WIDTH, 0.3f, 5000);
+	waveform.schedule(samples / 3 + 29, SCHEDULE_FREQUENCY, 180.5f, 3000);
+	waveform.schedule(samples / 2 + 5, SCHEDULE_STEP_HEIGHT, 0.2f, 0);
+	waveform.schedule(samples / 2 + 300, SCHEDULE_GAIN, 1, 0);
+}
+
+// renders n samples in blocks, as a host would
+static void render(gendy_waveform &waveform, gendysamp_t *dest,
+		unsigned long n, unsigned int blocksize) {
+	for(unsigned long done = 0; done < n; done += blocksize) {
+		unsigned int length = n - done < blocksize ? n - done : blocksize;
+		waveform.get_block(dest + done, length);
+	}
+}
+
+// jumping the generator to a stream and counter gives the draw that
+// drawing through to it did
+static void check_rng(const selfcheck_options &options) {
+	static const unsigned int streams = 16;
+	static const unsigned int draws = 256;
+	vector<unsigned long long> drawn(streams * draws);
+	gendy_rng rng(options.seed, 3);
+	for(unsigned int s = 0; s < streams; ++s) {
+		rng.set_stream(s);
+		for(unsigned int c = 0; c < draws; ++c)
+			drawn[s * draws + c] = rng.next();
+	}
+	gendy_rng jumping(options.seed, 3);
+	unsigned long long random = options.seed * 2654435761u + 1;
+	unsigned int bad = 0;
+	for(unsigned int i = 0; i < 10000; ++i) {
+		random = random * 6364136223846793005ull + 1442695040888963407ull;
+		unsigned int s = (random >> 33) % streams;
+		unsigned int c = (random >> 17) % draws;
+		jumping.set_position(s, c);
+		if(jumping.next() != drawn[s * draws + c])
+			++bad;
+	}
+	char detail[80];
+	snprintf(detail, sizeof(detail), "%u of 10000 jumps drew another number",
+			bad);
+	report("counter rng", "jumps", bad == 0, bad ? detail : "");
+}
+
+// seeking back and forth plays the samples of the straight render
+static void check_seek(const selfcheck_config &config,
+		const selfcheck_options &options, const vector<gendysamp_t> &linear) {
+	gendy_waveform waveform(max_breakpoints);
+	configure(waveform, config, options.seed);
+	checkpoint_renderer renderer(waveform, checkpoint_interval);
+	vector<gendysamp_t> rendered(options.samples);
+	for(unsigned long done = 0; done < options.samples;
+			done += options.blocksize) {
+		unsigned int length = options.samples - done < options.blocksize ?
+			options.samples - done : options.blocksize;
+		renderer.render(&rendered[done], length);
+	}
+	unsigned int at = first_difference(&rendered[0], &linear[0],
+			options.samples, config.tolerance);
+	report("checkpoint render == render", config.name,
+			at == options.samples, difference_detail(0, at, options.samples));
+
+	// around the checkpoints, between them, and backwards
+	unsigned long long positions[] = {
+		options.samples / 2, 0, 1, checkpoint_interval - 1,
+		checkpoint_interval, checkpoint_interval + 1, options.samples / 3,
+		options.samples - compared_samples, 12345, options.samples / 7
+	};
+	vector<gendysamp_t> seeked(compared_samples);
+	for(unsigned int p = 0; p < sizeof(positions) / sizeof(positions[0]);
+			++p) {
+		unsigned long long position = positions[p];
+		if(position >= options.samples)
+			continue;
+		unsigned int n = options.samples - position < compared_samples ?
+			options.samples - position : compared_samples;
+		char check[80];
+		snprintf(check, sizeof(check), "seek to %llu == render", position);
+		if(!renderer.seek(position)) {
+			report(check, config.name, false, "seek failed");
+			continue;
+		}
+		renderer.render(&seeked[0], n);
+		at = first_difference(&seeked[0], &linear[position], n,
+				config.tolerance);
+		report(check, config.name, at == n,
+				difference_detail(position, at, n));
+	}
+}
+
+// a snapshot taken part way and loaded into another waveform carries on as
+// the straight render does
+static void check_snapshot(const selfcheck_config &config,
+		const selfcheck_options &options, const vector<gendysamp_t> &linear) {
+	unsigned long long positions[] = {
+		1, 1000, options.samples / 3 + 17, options.samples - compared_samples
+	};
+	vector<gendysamp_t> rendered(options.samples);
+	vector<gendysamp_t> continued(compared_samples);
+	vector<char> state(gendy_waveform::max_state_size(max_breakpoints));
+	for(unsigned int p = 0; p < sizeof(positions) / sizeof(positions[0]);
+			++p) {
+		unsigned long long position = positions[p];
+		char check[80];
+		snprintf(check, sizeof(check), "snapshot at %llu == render", position);
+		gendy_waveform saved(max_breakpoints);
+		configure(saved, config, options.seed);
+		render(saved, &rendered[0], position, options.blocksize);
+		size_t size = saved.save_state(&state[0], state.size());
+		gendy_waveform loaded(max_breakpoints);
+		if(size == 0 || !loaded.load_state(&state[0], size)) {
+			report(check, config.name, false, "snapshot didn't load");
+			continue;
+		}
+		render(loaded, &continued[0], compared_samples, options.blocksize);
+		unsigned int at = first_difference(&continued[0], &linear[position],
+				compared_samples, config.tolerance);
+		report(check, config.name, at == compared_samples,
+				difference_detail(position, at, compared_samples));
+	}
+}
+
+// advance_samples() to a point carries on as rendering there does, with
+// changes scheduled before, after and across it. the render stops at the
+// same point, as the output stage's ramps of the gain follow the blocks
+// to within rounding
+static void check_advance(const selfcheck_config &config,
+		const selfcheck_options &options) {
+	unsigned long long positions[] = {
+		1, 63, 1000, options.samples / 5 + 500, options.samples / 3 + 17,
+		options.samples - compared_samples
+	};
+	vector<gendysamp_t> rendered(options.samples);
+	vector<gendysamp_t> continued(compared_samples);
+	for(unsigned int p = 0; p < sizeof(positions) / sizeof(positions[0]);
+			++p) {
+		unsigned long long position = positions[p];
+		char check[80];
+		snprintf(check, sizeof(check), "advance_samples(%llu) == render",
+				position);
+		gendy_waveform reference(max_breakpoints);
+		configure(reference, config, options.seed);
+		schedule_changes(reference, options.samples);
+		render(reference, &rendered[0], position, options.blocksize);
+		render(reference, &rendered[position], compared_samples,
+				options.blocksize);
+		gendy_waveform advanced(max_breakpoints);
+		configure(advanced, config, options.seed);
+		schedule_changes(advanced, options.samples);
+		advanced.advance_samples(position);
+		render(advanced, &continued[0], compared_samples, options.blocksize);
+		unsigned int at = first_difference(&continued[0], &rendered[position],
+				compared_samples, config.tolerance);
+		report(check, config.name, at == compared_samples,
+				difference_detail(position, at, compared_samples));
+	}
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: gendy-selfcheck [options]\n"
+		"  -samples N     length of the reference render (default 100000)\n"
+		"  -blocksize N   samples per block (default 64)\n"
+		"  -seed N        random walk seed (default 1)\n");
+}
+
+static bool parse_options(int argc, char **argv, selfcheck_options &options) {
+	options.samples = 100000;
+	options.blocksize = 64;
+	options.seed = 1;
+
+	for(int i = 1; i < argc; ++i) {
+		string option = argv[i];
+		if(i + 1 >= argc)
+			return false;
+		const char *value = argv[++i];
+		if(option == "-samples")
+			options.samples = strtoul(value, NULL, 10);
+		else if(option == "-blocksize")
+			options.blocksize = atoi(value);
+		else if(option == "-seed")
+			options.seed = strtoull(value, NULL, 10);
+		else
+			return false;
+	}
+	// room for the seeks past the second checkpoint
+	return options.samples >= 4 * checkpoint_interval &&
+		options.blocksize > 0;
+}
+
+int main(int argc, char **argv) {
+	selfcheck_options options;
+	if(!parse_options(argc, argv, options)) {
+		usage();
+		return 1;
+	}
+
+	check_rng(options);
+	// checkpoints and snapshots don't hold scheduled changes, so they're
+	// checked against a render without any
+	vector<gendysamp_t> linear(options.samples);
+	for(unsigned int c = 0; c < num_configs; ++c) {
+		gendy_waveform waveform(max_breakpoints);
+		configure(waveform, configs[c], options.seed);
+		render(waveform, &linear[0], options.samples, options.blocksize);
+		check_seek(configs[c], options, linear);
+		check_snapshot(configs[c], options, linear);
+		check_advance(configs[c], options);
+	}
+
+	if(failures)
+		printf("%u checks failed\n", failures);
+	else
+		printf("all checks passed\n");
+	return failures ? 1 : 0;
+}
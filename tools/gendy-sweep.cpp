@@ -0,0 +1,548 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+// gendy-sweep - renders a grid or a Latin hypercube sample of the DSS
+// parameter space on every core and writes a CSV row of audio features per
+// render: RMS, DC offset, zero crossing rate, spectral centroid and
+// flatness, and an estimate of the pitch and how steady it is.
+//
+// Features are computed as the audio is rendered, a frame at a time, so no
+// render is ever held in memory.
+//
+// see the README for how to build it.
+//
+// e.g. 4 values of each parameter, 2 seconds per render:
+//
+//   ./gendy-sweep -grid 4 -seconds 2 > sweep.csv
+//
+// run without arguments for the full list of options.
+
+#include "gendy_api.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+// the swept parameters, in CSV column order
+enum sweep_axis { H_STEP, V_STEP, H_PULL, V_PULL, BREAKPOINTS, FREQUENCY,
+	NUM_AXES };
+
+static const char *axis_names[NUM_AXES] =
+	{ "h_step", "v_step", "h_pull", "v_pull", "breakpoints", "frequency" };
+
+static const gendy_param axis_params[NUM_AXES] = {
+	GENDY_PARAM_STEP_WIDTH, GENDY_PARAM_STEP_HEIGHT,
+	GENDY_PARAM_DURATION_PULL, GENDY_PARAM_AMPLITUDE_PULL,
+	GENDY_PARAM_BREAKPOINTS, GENDY_PARAM_FREQUENCY
+};
+
+struct sweep_range {
+	double low;
+	double high;
+};
+
+struct sweep_options {
+	sweep_range ranges[NUM_AXES];
+	// points per axis for a grid, or 0
+	unsigned int grid;
+	// number of samples for a Latin hypercube, or 0
+	unsigned int lhs;
+	double seconds;
+	double samplerate;
+	unsigned int warmup;
+	unsigned int threads;
+	unsigned long long seed;
+	int interpolation;
+	const char *output;
+};
+
+struct sweep_features {
+	double rms;
+	double dc;
+	double zcr;
+	double centroid;
+	double flatness;
+	double pitch;
+	double pitch_deviation;
+	double voiced;
+};
+
+struct sweep_job {
+	double values[NUM_AXES];
+	sweep_features features;
+};
+
+// the analysis frame, and the FFT size, which is twice that so the
+// autocorrelation for the pitch doesn't wrap around
+static const unsigned int frame_size = 2048;
+static const unsigned int fft_size = 2 * frame_size;
+// pitch search range, Hz
+static const double min_pitch = 30;
+static const double max_pitch = 4000;
+// autocorrelation peak (relative to lag 0) needed to call a frame voiced
+static const double voicing_threshold = 0.5;
+
+// in-place iterative radix-2 FFT. inverse without the 1/n scaling
+static void fft(double *re, double *im, unsigned int n, bool inverse) {
+	for(unsigned int i = 1, j = 0; i < n; ++i) {
+		unsigned int bit = n >> 1;
+		for(; j & bit; bit >>= 1)
+			j ^= bit;
+		j |= bit;
+		if(i < j) {
+			swap(re[i], re[j]);
+			swap(im[i], im[j]);
+		}
+	}
+	for(unsigned int length = 2; length <= n; length <<= 1) {
+		double angle = (inverse ? 2 : -2) * M_PI / length;
+		double step_re = cos(angle);
+		double step_im = sin(angle);
+		for(unsigned int i = 0; i < n; i += length) {
+			double w_re = 1;
+			double w_im = 0;
+			for(unsigned int k = 0; k < length / 2; ++k) {
+				unsigned int a = i + k;
+				unsigned int b = a + length / 2;
+				double t_re = re[b] * w_re - im[b] * w_im;
+				double t_im = re[b] * w_im + im[b] * w_re;
+				re[b] = re[a] - t_re;
+				im[b] = im[a] - t_im;
+				re[a] += t_re;
+				im[a] += t_im;
+				double next_re = w_re * step_re - w_im * step_im;
+				w_im = w_re * step_im + w_im * step_re;
+				w_re = next_re;
+			}
+		}
+	}
+}
+
+// accumulates features over a render, fed one block at a time
+class feature_extractor
+{
+	double samplerate;
+	unsigned long long samples;
+	double sum;
+	double sum_squares;
+	unsigned long long crossings;
+	float last_sample;
+
+	vector<double> frame;
+	unsigned int frame_fill;
+	vector<double> window;
+	vector<double> re;
+	vector<double> im;
+	unsigned int frames;
+	double centroid_sum;
+	double flatness_sum;
+	unsigned int spectral_frames;
+	// running mean and variance of the pitch in octaves (Welford)
+	unsigned int voiced_frames;
+	double pitch_mean;
+	double pitch_m2;
+
+	void analyze_frame();
+
+	public:
+	feature_extractor(double samplerate);
+	void add(const float *block, unsigned int n);
+	sweep_features result() const;
+};
+
+feature_extractor::feature_extractor(double samplerate) :
+		frame(frame_size), window(frame_size), re(fft_size), im(fft_size) {
+	this->samplerate = samplerate;
+	samples = 0;
+	sum = 0;
+	sum_squares = 0;
+	crossings = 0;
+	last_sample = 0;
+	frame_fill = 0;
+	frames = 0;
+	centroid_sum = 0;
+	flatness_sum = 0;
+	spectral_frames = 0;
+	voiced_frames = 0;
+	pitch_mean = 0;
+	pitch_m2 = 0;
+	for(unsigned int i = 0; i < frame_size; ++i)
+		window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / frame_size);
+}
+
+void feature_extractor::add(const float *block, unsigned int n) {
+	for(unsigned int i = 0; i < n; ++i) {
+		float sample = block[i];
+		sum += sample;
+		sum_squares += (double)sample * sample;
+		if((sample >= 0) != (last_sample >= 0) && samples > 0)
+			++crossings;
+		last_sample = sample;
+		++samples;
+		frame[frame_fill++] = sample;
+		if(frame_fill == frame_size) {
+			analyze_frame();
+			frame_fill = 0;
+		}
+	}
+}
+
+void feature_extractor::analyze_frame() {
+	++frames;
+	for(unsigned int i = 0; i < frame_size; ++i) {
+		re[i] = frame[i] * window[i];
+		im[i] = 0;
+	}
+	fill(re.begin() + frame_size, re.end(), 0.0);
+	fill(im.begin() + frame_size, im.end(), 0.0);
+	fft(&re[0], &im[0], fft_size, false);
+
+	// power spectrum, without DC
+	double power_sum = 0;
+	double weighted_sum = 0;
+	double log_sum = 0;
+	unsigned int bins = fft_size / 2;
+	for(unsigned int k = 0; k <= bins; ++k) {
+		double power = re[k] * re[k] + im[k] * im[k];
+		if(k > 0) {
+			power_sum += power;
+			weighted_sum += power * k * samplerate / fft_size;
+			log_sum += log(power + 1e-20);
+		}
+		// keep the power spectrum for the autocorrelation
+		re[k] = power;
+		im[k] = 0;
+	}
+	if(power_sum > 1e-12) {
+		centroid_sum += weighted_sum / power_sum;
+		flatness_sum += exp(log_sum / bins) / (power_sum / bins);
+		++spectral_frames;
+	}
+
+	// the inverse transform of the power spectrum is the autocorrelation
+	for(unsigned int k = 1; k < bins; ++k) {
+		re[fft_size - k] = re[k];
+		im[fft_size - k] = 0;
+	}
+	fft(&re[0], &im[0], fft_size, true);
+	if(re[0] <= 1e-12)
+		return;
+	unsigned int min_lag = (unsigned int)(samplerate / max_pitch);
+	unsigned int max_lag = (unsigned int)(samplerate / min_pitch);
+	if(max_lag > frame_size / 2)
+		max_lag = frame_size / 2;
+	if(min_lag < 2)
+		min_lag = 2;
+	// the first lag past the lag 0 lobe with the highest correlation
+	unsigned int best = 0;
+	double best_value = 0;
+	bool left_lobe = false;
+	for(unsigned int lag = min_lag; lag < max_lag; ++lag) {
+		double value = re[lag] / re[0];
+		if(value < 0)
+			left_lobe = true;
+		if(left_lobe && value > best_value && value >= re[lag - 1] / re[0] &&
+				value >= re[lag + 1] / re[0]) {
+			best = lag;
+			best_value = value;
+		}
+	}
+	if(best == 0 || best_value < voicing_threshold)
+		return;
+	// parabolic interpolation around the peak
+	double a = re[best - 1], b = re[best], c = re[best + 1];
+	double offset = 0;
+	if(a - 2 * b + c != 0)
+		offset = 0.5 * (a - c) / (a - 2 * b + c);
+	double octaves = log2(samplerate / (best + offset));
+	++voiced_frames;
+	double delta = octaves - pitch_mean;
+	pitch_mean += delta / voiced_frames;
+	pitch_m2 += delta * (octaves - pitch_mean);
+}
+
+sweep_features feature_extractor::result() const {
+	sweep_features features;
+	double n = samples ? samples : 1;
+	features.rms = sqrt(sum_squares / n);
+	features.dc = sum / n;
+	features.zcr = crossings * samplerate / n;
+	features.centroid = spectral_frames ? centroid_sum / spectral_frames : 0;
+	features.flatness = spectral_frames ? flatness_sum / spectral_frames : 0;
+	features.pitch = voiced_frames ? pow(2.0, pitch_mean) : 0;
+	// standard deviation in semitones
+	features.pitch_deviation = voiced_frames > 1 ?
+		12 * sqrt(pitch_m2 / (voiced_frames - 1)) : 0;
+	features.voiced = frames ? (double)voiced_frames / frames : 0;
+	return features;
+}
+
+// splitmix64, for the Latin hypercube
+static unsigned long long next_random(unsigned long long &state) {
+	unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static double uniform(unsigned long long &state) {
+	return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// maps t in [0,1] onto an axis. frequency is spread evenly in octaves,
+// breakpoints are whole numbers
+static double axis_value(const sweep_options &options, int axis, double t) {
+	const sweep_range &range = options.ranges[axis];
+	if(axis == FREQUENCY)
+		return range.low * pow(range.high / range.low, t);
+	double value = range.low + t * (range.high - range.low);
+	if(axis == BREAKPOINTS)
+		value = floor(value + 0.5);
+	return value;
+}
+
+static void make_grid(const sweep_options &options, vector<sweep_job> &jobs) {
+	unsigned long long total = 1;
+	for(int axis = 0; axis < NUM_AXES; ++axis)
+		total *= options.grid;
+	jobs.resize(total);
+	for(unsigned long long n = 0; n < total; ++n) {
+		unsigned long long rest = n;
+		for(int axis = NUM_AXES - 1; axis >= 0; --axis) {
+			unsigned int i = rest % options.grid;
+			rest /= options.grid;
+			double t = options.grid > 1 ? (double)i / (options.grid - 1) : 0.5;
+			jobs[n].values[axis] = axis_value(options, axis, t);
+		}
+	}
+}
+
+// one sample in each of lhs strata along every axis, strata paired up at
+// random
+static void make_hypercube(const sweep_options &options,
+		vector<sweep_job> &jobs) {
+	unsigned long long state = options.seed;
+	jobs.resize(options.lhs);
+	vector<unsigned int> strata(options.lhs);
+	for(int axis = 0; axis < NUM_AXES; ++axis) {
+		for(unsigned int i = 0; i < options.lhs; ++i)
+			strata[i] = i;
+		for(unsigned int i = options.lhs - 1; i > 0; --i)
+			swap(strata[i], strata[next_random(state) % (i + 1)]);
+		for(unsigned int n = 0; n < options.lhs; ++n) {
+			double t = (strata[n] + uniform(state)) / options.lhs;
+			jobs[n].values[axis] = axis_value(options, axis, t);
+		}
+	}
+}
+
+static bool render_job(const sweep_options &options, sweep_job &job,
+		vector<char> &arena) {
+	unsigned int max_breakpoints = (unsigned int)options.ranges[BREAKPOINTS].high;
+	gendy_handle *handle = gendy_create(&arena[0], arena.size(),
+			max_breakpoints, options.samplerate);
+	if(!handle)
+		return false;
+	gendy_set_param(handle, GENDY_PARAM_INTERPOLATION, options.interpolation);
+	for(int axis = 0; axis < NUM_AXES; ++axis)
+		gendy_set_param(handle, axis_params[axis], job.values[axis]);
+	// the parameters take effect at the next cycle. seeding then restarts
+	// the walk from the reset shape for them, which warming up evolves away
+	gendy_advance_cycles(handle, 1);
+	gendy_set_seed(handle, options.seed);
+	gendy_advance_cycles(handle, options.warmup);
+
+	feature_extractor features(options.samplerate);
+	float block[1024];
+	unsigned long long remaining =
+		(unsigned long long)(options.seconds * options.samplerate);
+	while(remaining) {
+		unsigned int n = remaining < 1024 ? remaining : 1024;
+		gendy_render(handle, block, n);
+		features.add(block, n);
+		remaining -= n;
+	}
+	gendy_destroy(handle);
+	job.features = features.result();
+	return true;
+}
+
+static void worker(const sweep_options &options, vector<sweep_job> &jobs,
+		atomic<size_t> &next_job, atomic<size_t> &finished) {
+	unsigned int max_breakpoints = (unsigned int)options.ranges[BREAKPOINTS].high;
+	vector<char> arena(gendy_arena_size(max_breakpoints));
+	size_t n;
+	while((n = next_job++) < jobs.size()) {
+		if(!render_job(options, jobs[n], arena))
+			fprintf(stderr, "gendy-sweep: render %lu failed\n", (unsigned long)n);
+		size_t done = ++finished;
+		if(done % 100 == 0 || done == jobs.size())
+			fprintf(stderr, "\r%lu/%lu", (unsigned long)done,
+					(unsigned long)jobs.size());
+	}
+}
+
+static void usage() {
+	fprintf(stderr,
+		"usage: gendy-sweep (-grid N | -lhs N) [options]\n"
+		"  -grid N            N evenly spaced values of every parameter\n"
+		"  -lhs N             N renders, a Latin hypercube sample\n"
+		"  -h_step LOW:HIGH   range of a parameter (also v_step, h_pull,\n"
+		"                     v_pull, breakpoints, frequency)\n"
+		"  -seconds S         length of each render (default 1)\n"
+		"  -samplerate R      (default 44100)\n"
+		"  -warmup N          cycles to evolve before rendering (default 100)\n"
+		"  -interpolation linear|cubic|additive (default cubic)\n"
+		"  -threads N         (default: all cores)\n"
+		"  -seed N            random walk and sampling seed (default 1)\n"
+		"  -o FILE            CSV output (default stdout)\n");
+}
+
+static bool parse_range(const char *text, sweep_range &range) {
+	char *end;
+	range.low = strtod(text, &end);
+	if(*end != ':')
+		return false;
+	range.high = strtod(end + 1, &end);
+	return *end == '\0' && range.high >= range.low;
+}
+
+static bool parse_options(int argc, char **argv, sweep_options &options) {
+	static const sweep_range defaults[NUM_AXES] =
+		{ {0, 1}, {0, 1}, {0, 1}, {0, 1}, {2, 32}, {50, 2000} };
+	memcpy(options.ranges, defaults, sizeof(defaults));
+	options.grid = 0;
+	options.lhs = 0;
+	options.seconds = 1;
+	options.samplerate = 44100;
+	options.warmup = 100;
+	options.threads = thread::hardware_concurrency();
+	options.seed = 1;
+	options.interpolation = GENDY_INTERPOLATION_CUBIC;
+	options.output = NULL;
+
+	for(int i = 1; i < argc; ++i) {
+		string option = argv[i];
+		if(i + 1 >= argc)
+			return false;
+		const char *value = argv[++i];
+		int axis;
+		for(axis = 0; axis < NUM_AXES; ++axis)
+			if(option == string("-") + axis_names[axis])
+				break;
+		if(axis < NUM_AXES) {
+			if(!parse_range(value, options.ranges[axis]))
+				return false;
+		}
+		else if(option == "-grid")
+			options.grid = atoi(value);
+		else if(option == "-lhs")
+			options.lhs = atoi(value);
+		else if(option == "-seconds")
+			options.seconds = atof(value);
+		else if(option == "-samplerate")
+			options.samplerate = atof(value);
+		else if(option == "-warmup")
+			options.warmup = atoi(value);
+		else if(option == "-threads")
+			options.threads = atoi(value);
+		else if(option == "-seed")
+			options.seed = strtoull(value, NULL, 10);
+		else if(option == "-interpolation") {
+			if(strcmp(value, "linear") == 0)
+				options.interpolation = GENDY_INTERPOLATION_LINEAR;
+			else if(strcmp(value, "cubic") == 0)
+				options.interpolation = GENDY_INTERPOLATION_CUBIC;
+			else if(strcmp(value, "additive") == 0)
+				options.interpolation = GENDY_INTERPOLATION_ADDITIVE;
+			else
+				return false;
+		}
+		else if(option == "-o")
+			options.output = value;
+		else
+			return false;
+	}
+	if(options.threads == 0)
+		options.threads = 1;
+	return (options.grid > 0) != (options.lhs > 0) &&
+		options.seconds > 0 && options.samplerate > 0 &&
+		options.ranges[BREAKPOINTS].low >= 1 &&
+		options.ranges[FREQUENCY].low > 0;
+}
+
+int main(int argc, char **argv) {
+	sweep_options options;
+	if(!parse_options(argc, argv, options)) {
+		usage();
+		return 1;
+	}
+	vector<sweep_job> jobs;
+	if(options.grid)
+		make_grid(options, jobs);
+	else
+		make_hypercube(options, jobs);
+
+	atomic<size_t> next_job(0);
+	atomic<size_t> finished(0);
+	vector<thread> threads;
+	for(unsigned int t = 0; t < options.threads; ++t)
+		threads.push_back(thread(worker, cref(options), ref(jobs),
+					ref(next_job), ref(finished)));
+	for(unsigned int t = 0; t < threads.size(); ++t)
+		threads[t].join();
+	fprintf(stderr, "\n");
+
+	FILE *out = options.output ? fopen(options.output, "w") : stdout;
+	if(!out) {
+		fprintf(stderr, "gendy-sweep: can't open %s\n", options.output);
+		return 1;
+	}
+	for(int axis = 0; axis < NUM_AXES; ++axis)
+		fprintf(out, "%s,", axis_names[axis]);
+	fprintf(out, "rms,dc,zcr,centroid,flatness,pitch,pitch_deviation,voiced\n");
+	for(size_t n = 0; n < jobs.size(); ++n) {
+		const sweep_job &job = jobs[n];
+		for(int axis = 0; axis < NUM_AXES; ++axis)
+			fprintf(out, "%g,", job.values[axis]);
+		const sweep_features &f = job.features;
+		fprintf(out, "%g,%g,%g,%g,%g,%g,%g,%g\n", f.rms, f.dc, f.zcr,
+				f.centroid, f.flatness, f.pitch, f.pitch_deviation, f.voiced);
+	}
+	if(out != stdout)
+		fclose(out);
+	return 0;
+}
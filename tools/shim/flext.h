@@ -0,0 +1,285 @@
+/*********************************************
+ *
+ * libgendy
+ *
+ * a library implementing Iannis Xenakis's Dynamic Stochastic Synthesis
+ *
+ * Copyright 2009,2010 Spencer Russell
+ * Released under the GPLv3
+ *
+ * This file is part of libgendy.
+ *
+ * libgendy is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * libgendy is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libgendy.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ********************************************/
+
+
+
+
+// A stand-in for flext and Pd, with just enough of them to build gendy~.cpp
+// as a plain C++ object outside of Pd. gendy-latency uses it to drive the
+// external's message and DSP methods the way Pd's scheduler would, without
+// a running Pd. It is not a general flext replacement:
+//
+//   - objects are made with shim_factory::create() and their DSP method is
+//     called with flext_dsp::shim_dsp()
+//   - messages are dispatched by selector through CbMethodHandler(), with
+//     no inlets other than the first
+//   - outlet messages go to shim_out(), which only counts them
+//   - buffers are private vectors instead of Pd arrays
+//   - queued outlet messages are sent right away, the host is one thread
+
+#ifndef FLEXT_SHIM_H
+#define FLEXT_SHIM_H
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#define FLEXT_VERSION 502
+
+struct t_symbol { const char *s_name; };
+struct t_atom { int a_type; float f; const t_symbol *s; };
+enum { A_NULL, A_FLOAT, A_SYMBOL };
+
+class flext_base;
+typedef bool (*shim_method_t)(flext_base *c, int argc, t_atom *argv);
+struct shim_class { std::map<std::string, shim_method_t> methods; };
+typedef shim_class *t_classid;
+
+inline void post(const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+}
+
+class flext
+{
+	public:
+	// symbols are interned for good, like Pd's
+	static const t_symbol *MakeSymbol(const char *s) {
+		static std::map<std::string, t_symbol *> table;
+		t_symbol *&sym = table[s];
+		if(!sym) {
+			sym = new t_symbol;
+			sym->s_name = strdup(s);
+		}
+		return sym;
+	}
+	static const char *GetString(const t_symbol *s) { return s->s_name; }
+	static const char *GetString(const t_atom &a) {
+		return a.a_type == A_SYMBOL ? a.s->s_name : NULL;
+	}
+	static bool IsFloat(const t_atom &a) { return a.a_type == A_FLOAT; }
+	static bool IsSymbol(const t_atom &a) { return a.a_type == A_SYMBOL; }
+	static bool CanbeFloat(const t_atom &a) { return IsFloat(a); }
+	static bool CanbeInt(const t_atom &a) { return IsFloat(a); }
+	static float GetFloat(const t_atom &a) { return a.f; }
+	static int GetInt(const t_atom &a) { return (int)a.f; }
+	static float GetAFloat(const t_atom &a, float def = 0) {
+		return IsFloat(a) ? a.f : def;
+	}
+	static int GetAInt(const t_atom &a, int def = 0) {
+		return IsFloat(a) ? (int)a.f : def;
+	}
+	static const t_symbol *GetSymbol(const t_atom &a) { return a.s; }
+	static const t_symbol *GetASymbol(const t_atom &a,
+			const t_symbol *def = NULL) {
+		return IsSymbol(a) ? a.s : def;
+	}
+	static void SetFloat(t_atom &a, float f) {
+		a.a_type = A_FLOAT;
+		a.f = f;
+		a.s = NULL;
+	}
+	static void SetInt(t_atom &a, int i) { SetFloat(a, (float)i); }
+	static void SetSymbol(t_atom &a, const t_symbol *s) {
+		a.a_type = A_SYMBOL;
+		a.s = s;
+		a.f = 0;
+	}
+	// logical time in seconds, advanced by the host
+	static double &shim_time() {
+		static double time = 0;
+		return time;
+	}
+	static double GetTime() { return shim_time(); }
+
+	class buffer
+	{
+		std::vector<float> data;
+		public:
+		typedef int lock_t;
+		buffer(const t_symbol * /* name */) : data(1024, 0.f) {}
+		bool Ok() const { return true; }
+		lock_t Lock() { return 0; }
+		void Unlock(lock_t) {}
+		void Update() {}
+		int Frames() const { return (int)data.size(); }
+		void Frames(int n, bool /* keep */ = true, bool /* zero */ = true) {
+			data.resize(n);
+		}
+		float &operator[](int i) { return data[i]; }
+		void Dirty(bool) {}
+	};
+};
+
+class flext_base : public flext
+{
+	public:
+	shim_class *shim_cls;
+	int shim_outlets;
+	int shim_sigouts;
+	unsigned long shim_messages_out;
+
+	flext_base() : shim_cls(NULL), shim_outlets(0), shim_sigouts(0),
+		shim_messages_out(0) {}
+	virtual ~flext_base() {}
+	static void AddMethod(t_classid c, int /* inlet */, const char *sel,
+			shim_method_t m) {
+		c->methods[sel] = m;
+	}
+	void AddInAnything(const char * = NULL) {}
+	void AddOutAnything(const char * = NULL) { ++shim_outlets; }
+	void AddOutList(const char * = NULL) { ++shim_outlets; }
+	void AddOutFloat(const char * = NULL) { ++shim_outlets; }
+	void ToOutAnything(int o, const t_symbol *s, int argc, const t_atom *argv) {
+		shim_out(o, s, argc, argv);
+	}
+	void ToQueueAnything(int o, const t_symbol *s, int argc,
+			const t_atom *argv) {
+		shim_out(o, s, argc, argv);
+	}
+	void ToOutList(int o, int argc, const t_atom *argv) {
+		shim_out(o, MakeSymbol("list"), argc, argv);
+	}
+	void ToQueueList(int o, int argc, const t_atom *argv) {
+		shim_out(o, MakeSymbol("list"), argc, argv);
+	}
+	void ToOutFloat(int o, float f) {
+		t_atom a;
+		SetFloat(a, f);
+		shim_out(o, MakeSymbol("float"), 1, &a);
+	}
+	void ToQueueFloat(int o, float f) { ToOutFloat(o, f); }
+	virtual void shim_out(int /* o */, const t_symbol * /* s */,
+			int /* argc */, const t_atom * /* argv */) {
+		++shim_messages_out;
+	}
+	// sends a message to the object's first inlet. returns false if it
+	// has no method for the selector or the arguments don't fit
+	virtual bool CbMethodHandler(int /* inlet */, const t_symbol *s, int argc,
+			const t_atom *argv) {
+		std::map<std::string, shim_method_t>::iterator m =
+			shim_cls->methods.find(s->s_name);
+		if(m == shim_cls->methods.end())
+			return false;
+		return m->second(this, argc, const_cast<t_atom *>(argv));
+	}
+};
+
+class flext_dsp : public flext_base
+{
+	public:
+	float shim_sr;
+	int shim_bs;
+
+	flext_dsp() : shim_sr(44100), shim_bs(64) {}
+	float Samplerate() const { return shim_sr; }
+	int Blocksize() const { return shim_bs; }
+	void AddOutSignal(const char * = NULL) { ++shim_sigouts; }
+	void AddOutSignal(int n) { shim_sigouts += n; }
+	void AddInSignal(const char * = NULL) {}
+	// one DSP tick of n samples
+	void shim_dsp(int n, float *const *in, float *const *out) {
+		m_signal(n, in, out);
+	}
+
+	protected:
+	virtual void m_signal(int /* n */, float *const * /* in */,
+			float *const * /* out */) {}
+};
+
+#define FLEXT_HEADER_S(NEW_CLASS, PARENT, SETUPFUN) \
+	public: typedef NEW_CLASS thisType; typedef PARENT thisParent; \
+	static void shim_setup(t_classid c) { SETUPFUN(c); } private:
+
+#define FLEXT_CALLBACK(F) \
+	static bool cb_##F(flext_base *c, int, t_atom *) { \
+		static_cast<thisType *>(c)->F(); return true; }
+#define FLEXT_CALLBACK_F(F) \
+	static bool cb_##F(flext_base *c, int argc, t_atom *argv) { \
+		if(argc < 1 || !IsFloat(argv[0])) return false; \
+		static_cast<thisType *>(c)->F(GetFloat(argv[0])); return true; }
+#define FLEXT_CALLBACK_I(F) \
+	static bool cb_##F(flext_base *c, int argc, t_atom *argv) { \
+		if(argc < 1 || !IsFloat(argv[0])) return false; \
+		static_cast<thisType *>(c)->F(GetInt(argv[0])); return true; }
+#define FLEXT_CALLBACK_II(F) \
+	static bool cb_##F(flext_base *c, int argc, t_atom *argv) { \
+		if(argc < 2 || !IsFloat(argv[0]) || !IsFloat(argv[1])) return false; \
+		static_cast<thisType *>(c)->F(GetInt(argv[0]), GetInt(argv[1])); \
+		return true; }
+#define FLEXT_CALLBACK_S(F) \
+	static bool cb_##F(flext_base *c, int argc, t_atom *argv) { \
+		if(argc < 1 || !IsSymbol(argv[0])) return false; \
+		static_cast<thisType *>(c)->F(GetSymbol(argv[0])); return true; }
+#define FLEXT_CALLBACK_V(F) \
+	static bool cb_##F(flext_base *c, int argc, t_atom *argv) { \
+		static_cast<thisType *>(c)->F(argc, argv); return true; }
+#define FLEXT_CADDMETHOD_(CL, IX, M_TAG, M_FUN) \
+	flext_base::AddMethod(CL, IX, M_TAG, cb_##M_FUN)
+
+// stands in for Pd's class registry
+struct shim_factory {
+	typedef flext_base *(*create_t)(int argc, const t_atom *argv);
+	typedef std::map<std::string, std::pair<create_t, shim_class *> > registry_t;
+	static registry_t &registry() {
+		static registry_t classes;
+		return classes;
+	}
+	shim_factory(const char *name, create_t create, void (*setup)(t_classid)) {
+		shim_class *cls = new shim_class;
+		setup(cls);
+		registry()[name] = std::make_pair(create, cls);
+	}
+	// makes an object as [name args...] would. NULL if there's no such class
+	static flext_base *create(const char *name, int argc, const t_atom *argv) {
+		registry_t::iterator entry = registry().find(name);
+		if(entry == registry().end())
+			return NULL;
+		flext_base *object = entry->second.first(argc, argv);
+		if(object)
+			object->shim_cls = entry->second.second;
+		return object;
+	}
+};
+
+#define FLEXT_NEW_DSP(NAME, NEW_CLASS) \
+	static flext_base *shim_create_##NEW_CLASS(int, const t_atom *) { \
+		return new NEW_CLASS(); } \
+	static shim_factory shim_reg_##NEW_CLASS(NAME, shim_create_##NEW_CLASS, \
+			NEW_CLASS::shim_setup);
+#define FLEXT_NEW_DSP_V(NAME, NEW_CLASS) \
+	static flext_base *shim_create_##NEW_CLASS(int argc, const t_atom *argv) { \
+		return new NEW_CLASS(argc, const_cast<t_atom *>(argv)); } \
+	static shim_factory shim_reg_##NEW_CLASS(NAME, shim_create_##NEW_CLASS, \
+			NEW_CLASS::shim_setup);
+
+#endif /* FLEXT_SHIM_H */